@@ -22,12 +22,12 @@ CDNLFLAG = -c
 # Production C++ flags
 #CXXFLAGS = -Xp -Kexceptions
 #CXXFLAGS = -Caopt -Xp -Kexceptions
-CXXFLAGS = -Wall -O2 -g -ftree-vectorize -D__STDC_LIMIT_MACROS -march=native
+CXXFLAGS = -Wall -O2 -g -ftree-vectorize -D__STDC_LIMIT_MACROS -march=native -fopenmp
 
 # C compiler flags
 #CFLAGS = -Xa
 #CFLAGS = -Caopt -Xa
-CFLAGS = -Wall -O2 -g -ftree-vectorize -fomit-frame-pointer -funroll-loops -march=native
+CFLAGS = -Wall -O2 -g -ftree-vectorize -fomit-frame-pointer -funroll-loops -march=native -fopenmp
 
 # HDF path (optional)
 HDF_INC = ""
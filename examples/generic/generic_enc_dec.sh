@@ -14,6 +14,7 @@
 #   Enter file type (0: Fortran sequential w 4-byte recl; 1: Fortran sequential w 8-byte recl; 2: C/C++) [0]: 0
 #   Enter endian conversion (0: do not perform; 1: inversion) [0]: 0
 #   Enter the number of fields in the file, nf [1]: 3
+#   Enter entropy coding backend (0: range coder; 1: rANS; 2: none) [0]: 0
 #   Field number 0
 #   Enter input data type (1: float; 2: double) [2]: 2
 #   Enter the number of data points in the first dimension, nx [16]: 32
@@ -23,6 +24,8 @@
 #   Invert the order of the dimensions? (0: no; 1: yes) [0]: 0
 #   Enter compression flag (0: do not compress; 1: compress) [1]: 1
 #   Enter base cutoff relative tolerance [1e-16]: 1e-6
+#   Enter wavelet transform (0: none; 1: CDF 9/7; 2: reversible integer CDF 5/3) [1]: 1
+#   Enter transform depth, three depths (e.g. 6,5,1) or auto [4]: 4
 #   Field number 1
 #   Enter input data type (1: float; 2: double) [2]: 2
 #   Enter the number of data points in the first dimension, nx [16]: 64
@@ -32,6 +35,8 @@
 #   Invert the order of the dimensions? (0: no; 1: yes) [0]: 0
 #   Enter compression flag (0: do not compress; 1: compress) [1]: 1
 #   Enter base cutoff relative tolerance [1e-16]: 1e-3
+#   Enter wavelet transform (0: none; 1: CDF 9/7; 2: reversible integer CDF 5/3) [1]: 1
+#   Enter transform depth, three depths (e.g. 6,5,1) or auto [4]: 4
 #   Field number 2
 #   Enter input data type (1: float; 2: double) [2]: 1
 #   Enter the number of data points in the first dimension, nx [16]: 1
@@ -44,4 +44,38 @@ LIBWAVERANGE.decoding_wrap_float.argtypes = [
     ndpointer(ctypes.c_float, flags="C_CONTIGUOUS"),
     ndpointer(ctypes.c_float, flags="C_CONTIGUOUS"),
     ndpointer(ctypes.c_ulong, flags="C_CONTIGUOUS"),
-    ndpointer(ctypes.c_uint8, flags="C_CONTIGUOUS")]
\ No newline at end of file
+    ndpointer(ctypes.c_uint8, flags="C_CONTIGUOUS")]
+
+# sink receiving the encoded data of encoding_wrap_opt_float: (ctx, buf, len)
+WRITE_ENC_FUNC = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.POINTER(ctypes.c_uint8), ctypes.c_ulong)
+
+# options of encoding_wrap_opt_float, as struct enc_options in src/core/wrappers.h
+# ibackend: 0 range coder, 1 rANS, 2 none; write_enc: None to store the bit planes in data_enc
+class enc_options(ctypes.Structure):
+    _fields_ = [("ibackend", ctypes.c_int),
+                ("ctx_out", ctypes.c_void_p),
+                ("write_enc", WRITE_ENC_FUNC)]
+
+LIBWAVERANGE.encoding_wrap_opt_float.restype = None
+LIBWAVERANGE.encoding_wrap_opt_float.argtypes = [
+    ctypes.c_int,
+    ctypes.c_int,
+    ctypes.c_int,
+    ndpointer(ctypes.c_float, flags="C_CONTIGUOUS"),
+    ctypes.c_int,
+    ndpointer(ctypes.c_int, flags="C_CONTIGUOUS"),
+    ctypes.c_int,
+    ctypes.c_int,
+    ctypes.c_int,
+    ctypes.POINTER(ctypes.c_float),
+    ctypes.POINTER(ctypes.c_float),
+    ctypes.POINTER(ctypes.c_float),
+    ctypes.POINTER(ctypes.c_float),
+    ctypes.POINTER(ctypes.c_uint8),
+    ctypes.POINTER(ctypes.c_uint8),
+    ctypes.POINTER(ctypes.c_ulong),
+    ndpointer(ctypes.c_float, flags="C_CONTIGUOUS"),
+    ndpointer(ctypes.c_float, flags="C_CONTIGUOUS"),
+    ndpointer(ctypes.c_ulong, flags="C_CONTIGUOUS"),
+    ctypes.c_void_p,
+    ctypes.POINTER(enc_options)]
\ No newline at end of file
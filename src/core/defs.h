@@ -31,9 +31,15 @@
 
 /***** Constant parameters *****/
 /* Version of the coder. Format: XYYZZ, where X is MAJOR (backwards-incompatible), YY is MINOR (backwards-compatible), ZZ is PATCH */
-#define CODER_VERSION 31503
+#define CODER_VERSION 32400
 /* Range coder block size. Must be less than 1<<16 */
 #define BLOCKSIZE 60000
+/* Range coder frequency tables of every block are scaled to a total of 1<<RC_FREQ_BITS, such that symbols are coded 
+   with shifts instead of divisions; at most 15, since the counts are stored as 16-bit integers. The decoder takes the 
+   total from the stored counts. 0: exact counts with the total equal to the block size (coder version 31700 and older) */
+#define RC_FREQ_BITS 15
+/* Number of range coder blocks in a chunk. Chunks of a bit plane are coded independently and can be processed in parallel */
+#define RC_CHUNK_BLOCKS 16UL
 /* Maximum number of bit planes is 8 for 64-bit real type */
 #define NLAYMAX 8UL
 /* Uniform cutoff flag (0: false; 1: true) */
@@ -42,12 +48,89 @@
 #define LOC_CUTOFF_LVL 1
 /* Downscaling block size for non-uniform cutoff */
 #define DS_BLOCK 16
-/* Encoded array must be no larger than the input data size multiplied by this factor */
+/* Encoded arrays are allocated with this factor times the largest encoded length, in which every stream is stored raw */
 #define SAFETY_BUFFER_FACTOR 1UL
+/* Default brick size of the bricked encoding subroutine in every direction. Every brick has its own transform and 
+   bit planes, so small bricks compress less well. With the CDF 9/7 transform at 1e-4 to 1e-6, the encoded data of a 
+   256x256x128 field are 1.04-1.14 times those of the whole field encoded at once with 128^3 bricks, 1.1-1.25 times 
+   with 64^3, 1.1-1.6 times with 32^3 and 1.3-2.5 times with 16^3 bricks; 16^3 bricks of a 64x48x40 field take 3.7 
+   times the space */
+#define BRICK_SIZE 128
+/* Smallest brick size in every direction where the field is larger */
+#define BRICK_SIZE_MIN 16
+/* Additional tolerance correction of the bricks for the CDF 9/7 transform, whose reconstruction amplifies the 
+   quantization errors more on a small brick than on the whole field */
+#define BRICK_ACC_COEF 1.5
 /* Wavelet reconstruction roundoff error correction coefficient = Linf_error/Linf_tolerance */
 #define WAV_ACC_COEF 1.75
 /* Maximum depth of wavelet transform */
 #define WAV_LVL 4
+/* Automatic choice of the wavelet transform depth in a direction */
+#define WAV_LVL_AUTO -1
+/* Largest wavelet transform depth in a direction */
+#define WAV_LVL_MAX 16
+/* Automatic depth: smallest array extent that is transformed further */
+#define WAV_LVL_MINLEN 8
+/* Automatic depth: a level is admissible if the mean absolute detail coefficient does not exceed this fraction of the mean absolute deviation of the band */
+#define WAV_LVL_PROBE 0.9
+/* Automatic depth: largest total number of levels in the three directions */
+#define WAV_LVL_SUM (3*WAV_LVL)
+/* Wavelet transform types (wtflag): no transform, CDF9/7, reversible integer CDF5/3 */
+#define WAV_TYPE_NONE 0
+#define WAV_TYPE_CDF97 1
+#define WAV_TYPE_CDF53 2
+/* Order of the wavelet coefficients in the coded bit planes: as stored by the transform, or grouped by subband from 
+   the coarsest to the finest. WAV_ORDER is used for encoding */
+#define WAV_ORDER_MALLAT 0
+#define WAV_ORDER_SUBBAND 1
+#define WAV_ORDER WAV_ORDER_SUBBAND
+/* Dead zone: wavelet coefficients whose magnitude does not exceed DEAD_ZONE times half the tolerance are 
+   reconstructed as zero and not coded in any bit plane, their positions are coded in a significance map. Values 
+   above 1 exceed the tolerance, 0 disables the dead zone. Needs the subband order */
+#define DEAD_ZONE 1.0
+/* The dead zone is only applied if it removes at least this number of coefficients, since the significance map has a 
+   fixed cost */
+#define DEAD_ZONE_MIN 16384UL
+/* Estimated number of coded bits saved per insignificant coefficient over all bit planes. A subband is split by a 
+   bitmap only if the bitmap costs less than the saving, otherwise all of its coefficients are coded */
+#define SIG_SAVED_BITS 2.0
+/* Significance map flags of a subband: no significant coefficient, all coded, bitmap */
+#define SIG_NONE 0
+#define SIG_ALL 1
+#define SIG_MIXED 2
+/* Flag in the first byte of the first encoded bit plane, signals that a field descriptor precedes the range-coded data */
+#define ENC_FIELD_DESC 0x80
+/* First byte of a bit plane coded in several chunks, followed by the chunk table; a single range-coded stream starts with 0, or 1 after a carry */
+#define ENC_LAYER_CHUNKS 0x02
+/* First byte of a range-coded stream with scaled frequency tables (RC_FREQ_BITS), or 5 after a carry */
+#define ENC_LAYER_SHIFT 0x04
+/* First byte of an rANS-coded stream */
+#define ENC_LAYER_RANS 0x08
+/* First byte of a stream stored without entropy coding */
+#define ENC_LAYER_RAW 0x10
+/* Entropy coding backends: range coder, interleaved rANS coder (faster decoding), no entropy coding. ENC_BACKEND is 
+   the default for encoding, any backend is decoded */
+#define ENC_BACKEND_RANGE 0
+#define ENC_BACKEND_RANS 1
+#define ENC_BACKEND_RAW 2
+#define ENC_BACKEND_NUM 3
+#define ENC_BACKEND ENC_BACKEND_RANGE
+/* Streams with a zeroth-order entropy above this number of bits per symbol are stored raw (a value of 8 or more 
+   disables the bypass) */
+#define RAW_BYPASS_BITS 7.9
+/* First byte of a stream of packed symbols, followed by the symbol width in bits, the smallest symbol and the 
+   entropy-coded packed bytes */
+#define ENC_LAYER_PACK 0x20
+/* Pack streams whose symbols span fewer than 16 (4-bit) or 4 (2-bit) values before entropy coding, 0 to disable */
+#define PACK_SYMBOLS 1
+/* Integer mapping of the reversible transform input: exact bit pattern, uniform quantization */
+#define INT_MAP_EXACT 0
+#define INT_MAP_QUANT 1
+/* Estimated ratio of the error of the field to the error of the integer transform coefficients when the last byte 
+   planes are not decoded, used to choose the byte planes of a coarser reconstruction */
+#define INT_TRUNC_GAIN 8.0
+/* Number of lines lifted together in the wavelet transform, a multiple of the vector register width (16 for AVX-512 float) */
+#define WAV_PANEL 16
 /* Maximum number of datasets in a restart file */
 #define NDSMAX 50
 /* Number of digits in MSSG output file name extension */
@@ -34,6 +34,7 @@
 #include <ctype.h>
 #include <math.h>
 #include <float.h>
+#include <string.h>
 
 #include <iostream>
 #include <exception>
@@ -41,7 +42,9 @@
 
 #include "../rangecod/port.h"
 #include "../rangecod/rangecod.h"
+#include "../rans/rans.h"
 #include "../waveletcdf97_3d/waveletcdf97_3d.h"
+#include "../waveletcdf53_3d/waveletcdf53_3d.h"
 
 #include "../core/defs.h"
 #include "wrappers.h"
@@ -49,36 +52,22 @@
 using namespace std;
 
 
-/* Calculate local precision */
-template <typename T>
-static T lcl_prec(int nx, int ny, int nz, int jx, int jy, int jz, int mx, int my, int mz, T *cutoffvec)
-{
-    // Cartesian coordinates of the local precision cutoff block
-    int kx = int(T(jx)/T(nx)*T(mx));
-    int ky = int(T(jy)/T(ny)*T(my));
-    int kz = int(T(jz)/T(nz)*T(mz));
-
-    // Evaluate the local precision
-    return cutoffvec[kx+mx*ky+mx*my*kz];
-}
-
-
-/* Use the range encoder to code an array fld_q */ 
-static void range_encode(unsigned char *fld_q, unsigned long int ntot, unsigned char *enc_q, unsigned long int& len_out_q)
+/* Use the range encoder to code an array fld_q. The encoded data is written directly into enc_q, which has room 
+   for len_max bytes. Returns nonzero if the encoded data does not fit */ 
+static int range_encode(unsigned char *fld_q, unsigned long int ntot, unsigned char *enc_q, unsigned long int len_max, unsigned long int& len_out_q)
 {   freq counts[257], blocksize, i;
     int buffer[BLOCKSIZE];
-    unsigned long int j;
     unsigned long int pos_in = 0;
-    unsigned long int pos_out = 0;
 
     // Allocate a range coder object
     rangecoder *rc = (rangecoder*)malloc(sizeof(rangecoder));
 
-    // Initialize data buffer
-    init_databuf(rc,2*BLOCKSIZE+1000);
+    // The output vector is the data buffer
+    attach_databuf(rc,enc_q,len_max);
 
-    // Start up the range coder, first byte 0, no header
-    start_encoding(rc,0,0);
+    // Start up the range coder, the first byte flags the frequency table scaling, no header
+    freq shift = RC_FREQ_BITS;
+    start_encoding(rc,shift ? ENC_LAYER_SHIFT : 0,0);
 
     // Coding: loop for all blocks of the input vector
     while (1)
@@ -96,6 +85,13 @@ static void range_encode(unsigned char *fld_q, unsigned long int ntot, unsigned
         // Get the statistics 
         countblock(buffer,blocksize,counts);
 
+        // Scaled frequency tables: the block size is written first, the statistics are scaled to the total 1<<shift
+        if (shift) 
+          {
+            encode_short(rc,blocksize);
+            if (blocksize) scalecounts(counts,blocksize,shift);
+          }
+
         // Write the statistics.
         // Cant use putchar or other since we are after start of the rangecoder 
         // as you can see the rangecoder doesn't care where probabilities come 
@@ -104,23 +100,21 @@ static void range_encode(unsigned char *fld_q, unsigned long int ntot, unsigned
             encode_short(rc,counts[i]);
 
         // Store in counters[i] the number of all bytes < i, so sum up 
-        counts[256] = blocksize;
+        counts[256] = shift ? (freq)1 << shift : blocksize;
         for (i=256; i; i--)
             counts[i-1] = counts[i]-counts[i-1];
 
         // Output the encoded symbols 
-        for(i=0; i<blocksize; i++) {
+        if (shift)
+          for(i=0; i<blocksize; i++) {
+            int ch = buffer[i];
+            encode_shift(rc,counts[ch+1]-counts[ch],counts[ch],shift);
+          }
+        else
+          for(i=0; i<blocksize; i++) {
             int ch = buffer[i];
             encode_freq(rc,counts[ch+1]-counts[ch],counts[ch],counts[256]);
-        }
-
-        // Copy data from a buffer to the output vector
-        for (j = 0; j < rc->datapos; j++) {
-          enc_q[pos_out++] = rc->databuf[j];
-        }
-
-        // Reset the buffer    
-        rc->datapos = 0;
+          }
 
         // Terminate if no more data
         if (blocksize<BLOCKSIZE) break;
@@ -132,402 +126,2719 @@ static void range_encode(unsigned char *fld_q, unsigned long int ntot, unsigned
     // Finalize the encoder 
     done_encoding(rc);
 
-    // Copy data from a buffer to the output vector
-    for (j = 0; j < rc->datapos; j++) {
-      enc_q[pos_out++] = rc->databuf[j];
-    }
-
     // True length of the encoded array
-    len_out_q = pos_out;
-
-    // Deallocate data buffer
-    free_databuf(rc);
+    len_out_q = rc->datapos;
+    int overflow = rc->overflow;
 
     // Deallocate range coder object
     free(rc);
+
+    return overflow;
 }
 
 
-/* Decode the range-encoded data enc_q */
-static void range_decode(unsigned char *enc_q, unsigned long int len_out_q, unsigned char *dec_q, unsigned long int ntot)
-{   freq counts[257], blocksize, i, i1, cf, symbol, middle;
+/* Decode the range-encoded data enc_q, which is read in place. Returns nonzero if the encoded data is inconsistent 
+   with its length or with the ntot elements of dec_q */
+static int range_decode(unsigned char *enc_q, unsigned long int len_out_q, unsigned char *dec_q, unsigned long int ntot)
+{   freq counts[257], blocksize, tot_f, i, cf;
 
     // Allocate a range coder object
     rangecoder *rc = (rangecoder*)malloc(sizeof(rangecoder));
 
-    // Initialize data buffer
+    // The input vector is the data buffer
     rc->help = 0;
     unsigned long int pos_out = 0;
-    init_databuf(rc,len_out_q);
-    for(unsigned long int j = 0; j < len_out_q; j++) rc->databuf[j] = enc_q[j];
-    rc->datalen = len_out_q;
-    rc->datapos = 0;
-
-    // Start decoding
-    if (start_decoding(rc) != 0)
-    {   fprintf(stderr,"could not successfully open input data\n");
-        exit(1);
-    }
+    attach_databuf(rc,enc_q,len_out_q);
+
+    // Start decoding, the first byte tells if the frequency tables are scaled
+    int c = start_decoding(rc) | 1;
+    int scaled = (c == (ENC_LAYER_SHIFT|1));
+    if ((c != 1) && !scaled)
+      rc->overflow = 1;
 
     // Decoding: loop for all blocks of the input vector
-    while (cf = decode_culfreq(rc,2))
+    while ((!rc->overflow) && (cf = decode_culfreq(rc,2)))
     {   // Read the beginning of the block
         decode_update(rc,1,1,2);
 
+        // Read the block size of scaled frequency tables
+        if (scaled) blocksize = decode_short(rc);
+
         // Read frequencies
         readcounts(rc,counts);
 
-        // Figure out blocksize by summing counts; also use counts as in encoder 
-        blocksize = 0;
+        // Sum up counts, the total is the block size unless scaled; also use counts as in encoder 
+        tot_f = 0;
         for (i=0; i<256; i++)
         {   freq tmp = counts[i];
-            counts[i] = blocksize;
-            blocksize += tmp;
+            counts[i] = tot_f;
+            tot_f += tmp;
         }
-        counts[256] = blocksize;
-
-        // Allocate search table
-        freq *invcounts = new freq[blocksize+1];
-
-        // Fill values in the search table
-        for (i1=0; i1<256; i1++) 
-            for (i=counts[i1]; i<counts[i1+1]; i++) invcounts[i] = i1;
-        invcounts[blocksize] = 256;
-
-        // Loop for all decoding elements in the block
-        for (i=0; i<blocksize; i++)
-        {   // Decode frequency
-            cf = decode_culfreq(rc,blocksize);
-            // Symbol from the search table 
-            middle = invcounts[cf];
-            // If some symbols have zero frequency, skip them
-            for (symbol=middle; counts[symbol+1]<=cf; symbol++);
-            // Update the decoder
-            decode_update(rc, counts[symbol+1]-counts[symbol],counts[symbol],blocksize);
-            // Store the decoded element
-            dec_q[pos_out++] = symbol;
+        counts[256] = tot_f;
+        if (!scaled) blocksize = tot_f;
+
+        // Stop if the block is longer than written by the encoder, does not fit in the output vector, or the 
+        // scaled frequency total is not a power of two up to 1<<16
+        if ((rc->overflow) || (blocksize > BLOCKSIZE) || (blocksize > ntot-pos_out) || 
+            (scaled && blocksize && ((tot_f == 0) || (tot_f > (1<<16)) || (tot_f & (tot_f-1)))))
+        {   rc->overflow = 1;
+            break;
         }
 
-        // Delete search table
-        delete [] invcounts;
+        // Decode all elements of the block directly into the output vector
+        decode_block(rc,counts,dec_q+pos_out,blocksize);
+        pos_out += blocksize;
     }
 
     // Finalize decoding 
     done_decoding(rc);
-
-    // Deallocate data buffer
-    free_databuf(rc);
+    int overflow = rc->overflow || (pos_out != ntot);
 
     // Deallocate range coder object
     free(rc);
+
+    return overflow;
 }
 
-extern "C" void encoding_wrap_float(int nx, int ny, int nz, float *fld_1d, int wtflag, int mx, int my, int mz, float *cutoffvec, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+
+/* Use the interleaved rANS coder to code an array fld_q in blocks of BLOCKSIZE symbols with static frequencies. 
+   The encoded data [ENC_LAYER_RANS][encoded blocks] is written directly into enc_q, which has room for len_max 
+   bytes. Returns nonzero if the encoded data does not fit */
+static int rans_encode(unsigned char *fld_q, unsigned long int ntot, unsigned char *enc_q, unsigned long int len_max, unsigned long int& len_out_q)
 {
-    encoding_wrap<float>(nx, ny, nz, fld_1d, wtflag, mx, my, mz, cutoffvec, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+    len_out_q = 0;
+    if (len_max == 0) return 1;
+    enc_q[len_out_q++] = ENC_LAYER_RANS;
+    for (unsigned long int j0 = 0; j0 < ntot; j0 += BLOCKSIZE)
+      {
+        unsigned int n = (ntot-j0 < BLOCKSIZE) ? (unsigned int)(ntot-j0) : BLOCKSIZE;
+        unsigned long int len = rans_encode_block(fld_q+j0,n,enc_q+len_out_q,len_max-len_out_q);
+        if (len == 0) return 1;
+        len_out_q += len;
+      }
+    return 0;
 }
 
-extern "C" void encoding_wrap_double(int nx, int ny, int nz, double *fld_1d, int wtflag, int mx, int my, int mz, double *cutoffvec, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+/* Decode the rANS-coded data enc_q, which is read in place. Returns nonzero if the encoded data is inconsistent 
+   with its length or with the ntot elements of dec_q */
+static int rans_decode(unsigned char *enc_q, unsigned long int len_out_q, unsigned char *dec_q, unsigned long int ntot)
 {
-    encoding_wrap<double>(nx, ny, nz, fld_1d, wtflag, mx, my, mz, cutoffvec, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+    unsigned long int pos = 1;
+    if ((len_out_q == 0) || (enc_q[0] != ENC_LAYER_RANS)) return 1;
+    for (unsigned long int j0 = 0; j0 < ntot; j0 += BLOCKSIZE)
+      {
+        unsigned int n = (ntot-j0 < BLOCKSIZE) ? (unsigned int)(ntot-j0) : BLOCKSIZE;
+        unsigned long int len = rans_decode_block(enc_q+pos,len_out_q-pos,dec_q+j0,n);
+        if (len == 0) return 1;
+        pos += len;
+      }
+    return (pos != len_out_q);
 }
 
-extern "C" void decoding_wrap_float(int nx, int ny, int nz, float *fld_1d, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+
+/* Store an array fld_q without entropy coding as [ENC_LAYER_RAW][fld_q] in enc_q, which has room for len_max bytes. 
+   Returns nonzero if it does not fit */
+static int raw_encode(unsigned char *fld_q, unsigned long int ntot, unsigned char *enc_q, unsigned long int len_max, unsigned long int& len_out_q)
 {
-    decoding_wrap<float>(nx, ny, nz, fld_1d, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+    len_out_q = 0;
+    if (len_max < ntot+1UL) return 1;
+    enc_q[0] = ENC_LAYER_RAW;
+    memcpy(enc_q+1,fld_q,ntot);
+    len_out_q = ntot+1UL;
+    return 0;
 }
-extern "C" void decoding_wrap_double(int nx, int ny, int nz, double *fld_1d, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+
+/* Copy the stored array enc_q to dec_q. Returns nonzero if the length does not match */
+static int raw_decode(unsigned char *enc_q, unsigned long int len_out_q, unsigned char *dec_q, unsigned long int ntot)
 {
-    decoding_wrap<double>(nx, ny, nz, fld_1d, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+    if ((len_out_q != ntot+1UL) || (enc_q[0] != ENC_LAYER_RAW)) return 1;
+    memcpy(dec_q,enc_q+1,ntot);
+    return 0;
 }
 
-
-/* Encoding subroutine with wavelet transform and range coding */ 
-template <typename T>
-void encoding_wrap(int nx, int ny, int nz, T *fld_1d, int wtflag, int mx, int my, int mz, T *cutoffvec, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+/* Histogram of the symbols of fld_q */
+static void symbol_counts(const unsigned char *fld_q, unsigned long int ntot, unsigned long int *counts)
 {
-    /* Wavelet decomposition */
-
-    // Total number of elements in the input array
-    unsigned long int ntot = (unsigned long int)(nx)*(unsigned long int)(ny)*(unsigned long int)(nz);
+    // Four interleaved histograms avoid stalls on runs of equal symbols
+    unsigned long int c4[4][256];
+    memset(c4,0,sizeof(c4));
+    unsigned long int j = 0;
+    for (; j+4UL <= ntot; j += 4UL)
+      {
+        c4[0][fld_q[j]]++;
+        c4[1][fld_q[j+1]]++;
+        c4[2][fld_q[j+2]]++;
+        c4[3][fld_q[j+3]]++;
+      }
+    for (; j < ntot; j++) c4[0][fld_q[j]]++;
+    for (int s = 0; s < 256; s++) counts[s] = c4[0][s]+c4[1][s]+c4[2][s]+c4[3][s];
+}
 
-    // Number of elements in the local cutoff array
-    unsigned int mtot = mx*my*mz;
+/* Zeroth-order entropy of ntot symbols with the histogram counts, in bits per symbol */
+static double symbol_entropy(const unsigned long int *counts, unsigned long int ntot)
+{
+    double h = 0.0;
+    for (int s = 0; s < 256; s++)
+      if (counts[s]) h -= double(counts[s])*log2(double(counts[s])/double(ntot));
+    return (ntot > 0) ? h/double(ntot) : 0.0;
+}
 
-    // Wavelet transform depth, hardcoded, see header file; zero if no transform required
-    if (wtflag) wlev = WAV_LVL; else wlev = 0;
+/* Pack ntot symbols of nbit bits (2 or 4), offset by smin, into (ntot*nbit+7)/8 bytes, the first symbol in the 
+   lowest bits */
+static void pack_symbols(const unsigned char *fld_q, unsigned long int ntot, int nbit, unsigned char smin, unsigned char *pk)
+{
+    unsigned long int per = 8/nbit;
+    unsigned long int npk = ntot/per;
+    for (unsigned long int k = 0; k < npk; k++)
+      {
+        unsigned char b = 0;
+        for (unsigned long int i = 0; i < per; i++) b |= (unsigned char)((fld_q[k*per+i]-smin) << (i*nbit));
+        pk[k] = b;
+      }
+    if (npk*per < ntot)
+      {
+        unsigned char b = 0;
+        for (unsigned long int i = 0; npk*per+i < ntot; i++) b |= (unsigned char)((fld_q[npk*per+i]-smin) << (i*nbit));
+        pk[npk] = b;
+      }
+}
 
-    // Find the minimum and maximum values
-    T minval = fld_1d[0];
-    T maxval = fld_1d[0];
-    for (unsigned long int j = 0; j < ntot; j++) 
+/* Unpack ntot symbols packed by pack_symbols at the beginning of dec_q, in place. The bytes are expanded from the 
+   last one, every byte is read before the symbols that overwrite it are written */
+static void unpack_symbols(unsigned char *dec_q, unsigned long int ntot, int nbit, unsigned char smin)
+{
+    unsigned long int per = 8/nbit;
+    unsigned char mask = (unsigned char)((1 << nbit)-1);
+    unsigned long int npk = ntot/per;
+    if (npk*per < ntot)
+      {
+        unsigned char b = dec_q[npk];
+        for (unsigned long int i = 0; npk*per+i < ntot; i++) dec_q[npk*per+i] = (unsigned char)(smin + ((b >> (i*nbit)) & mask));
+      }
+    for (unsigned long int k = npk; k-- > 0; )
       {
-        minval = fmin(minval,fld_1d[j]);
-        maxval = fmax(maxval,fld_1d[j]);
+        unsigned char b = dec_q[k];
+        for (unsigned long int i = 0; i < per; i++) dec_q[k*per+i] = (unsigned char)(smin + ((b >> (i*nbit)) & mask));
       }
+}
 
-    // Find the middle value and the half-span of the data values
-    halfspanval = (maxval-minval)/2;
-    midval = minval+halfspanval;
 
-    // If the half-span is close to zero, encoding is impossible and unnecessary
-    if (halfspanval <= 2*DBL_MIN)
-      {
-        // Encoded data array is empty and not used
-        ntot_enc = 0;
-        nlay = 0;
-        tolabs = 0;
+/* Entropy coding backends, indexed by ENC_BACKEND_*. Every coded stream (a bit plane, or a chunk of it) is 
+   produced by one backend and starts with a byte that identifies it, so that streams of all backends can be 
+   decoded regardless of the backend selected for encoding */
+struct entropy_backend
+{
+    // Code ntot symbols into enc_q of length len_max, returns nonzero if they do not fit
+    int (*encode)(unsigned char *fld_q, unsigned long int ntot, unsigned char *enc_q, unsigned long int len_max, unsigned long int& len_out_q);
+    // Decode ntot symbols, returns nonzero if the data are inconsistent
+    int (*decode)(unsigned char *enc_q, unsigned long int len_out_q, unsigned char *dec_q, unsigned long int ntot);
+};
+static const entropy_backend backends[ENC_BACKEND_NUM] = 
+{
+    { range_encode, range_decode },
+    { rans_encode, rans_decode },
+    { raw_encode, raw_decode }
+};
 
-        // Exit from the subroutine
-        return;
+/* Check the entropy coding backend of an encoding subroutine */
+static void check_backend(int ibackend)
+{
+    if ((ibackend < 0) || (ibackend >= ENC_BACKEND_NUM))
+      {
+        cout << "Error: unknown entropy coding backend " << ibackend << endl;
+        throw std::exception();
       }
+}
 
-    // Apply wavelet transform
-    waveletcdf97_3d<T>(nx,ny,nz,int(wlev),fld_1d);
+/* Encode a stream with the backend ibackend, given the histogram of its symbols. A stream whose symbols are close 
+   to uniform noise is stored raw, since entropy coding would not make it shorter */
+static int backend_encode(unsigned char *fld_q, unsigned long int ntot, const unsigned long int *counts, unsigned char *enc_q, unsigned long int len_max, unsigned long int& len_out_q, int ibackend)
+{
+    int ib = ibackend;
+    if ((ib != ENC_BACKEND_RAW) && (symbol_entropy(counts,ntot) > RAW_BYPASS_BITS)) ib = ENC_BACKEND_RAW;
+    return backends[ib].encode(fld_q,ntot,enc_q,len_max,len_out_q);
+}
 
-    /* Range encoding */
+/* Decode a stream with the backend identified by its first byte */
+static int backend_decode(unsigned char *enc_q, unsigned long int len_out_q, unsigned char *dec_q, unsigned long int ntot)
+{
+    int ib = ENC_BACKEND_RANGE;
+    if ((len_out_q > 0) && (enc_q[0] == ENC_LAYER_RANS)) ib = ENC_BACKEND_RANS;
+    if ((len_out_q > 0) && (enc_q[0] == ENC_LAYER_RAW)) ib = ENC_BACKEND_RAW;
+    return backends[ib].decode(enc_q,len_out_q,dec_q,ntot);
+}
 
-    // Alphabet size
-    int q = 256;
+/* Code a stream. If its symbols span fewer than 16 values, as in the last bit planes of a field, they are packed 
+   as 4-bit or 2-bit symbols and the packed bytes are coded, which takes a half or a quarter of the coder 
+   operations. The stream is then [ENC_LAYER_PACK][bits][smallest symbol][coded packed bytes] */
+static int entropy_code(unsigned char *fld_q, unsigned long int ntot, unsigned char *enc_q, unsigned long int len_max, unsigned long int& len_out_q, int ibackend)
+{
+    unsigned long int counts[256];
+    symbol_counts(fld_q,ntot,counts);
+    int smin = 0, smax = 255;
+    while ((smin < 255) && (counts[smin] == 0)) smin++;
+    while ((smax > smin) && (counts[smax] == 0)) smax--;
+    int nbit = (smax-smin < 4) ? 2 : (smax-smin < 16) ? 4 : 8;
+    if ((!PACK_SYMBOLS) || (nbit == 8) || (ntot == 0))
+      return backend_encode(fld_q,ntot,counts,enc_q,len_max,len_out_q,ibackend);
+
+    len_out_q = 0;
+    if (len_max < 3UL) return 1;
+    unsigned long int npk = (ntot*nbit+7UL)/8UL;
+    // The range encoder reads one element past the end of its input
+    unsigned char *pk = new unsigned char[npk+1UL];
+    pk[npk] = 0;
+    pack_symbols(fld_q,ntot,nbit,(unsigned char)smin,pk);
+    symbol_counts(pk,npk,counts);
+    unsigned long int len_pk = 0;
+    int overflow = backend_encode(pk,npk,counts,enc_q+3,len_max-3UL,len_pk,ibackend);
+    delete [] pk;
+    enc_q[0] = ENC_LAYER_PACK;
+    enc_q[1] = (unsigned char)nbit;
+    enc_q[2] = (unsigned char)smin;
+    len_out_q = len_pk+3UL;
+    return overflow;
+}
 
-    // Allocate the quantized input and output vectors
-    unsigned char *fld_q = new unsigned char[ntot];
-    unsigned char *enc_q = new unsigned char[(SAFETY_BUFFER_FACTOR+1UL)*(ntot<1024UL?1024UL:ntot)]; // Encoded array may be longer than the original
+/* Encode a stream. A stream that does not fit or that the coder makes longer than its symbols is stored raw, so 
+   that it never takes more than ntot+1 bytes */
+static int entropy_encode(unsigned char *fld_q, unsigned long int ntot, unsigned char *enc_q, unsigned long int len_max, unsigned long int& len_out_q, int ibackend)
+{
+    int overflow = entropy_code(fld_q,ntot,enc_q,len_max,len_out_q,ibackend);
+    if ((overflow || (len_out_q > ntot+1UL)) && (len_max >= ntot+1UL)) overflow = raw_encode(fld_q,ntot,enc_q,len_max,len_out_q);
+    return overflow;
+}
 
-    // Output quantized data array length
-    unsigned long int len_out_q = 0;
+/* Decode a stream, packed or coded by any backend */
+static int entropy_decode(unsigned char *enc_q, unsigned long int len_out_q, unsigned char *dec_q, unsigned long int ntot)
+{
+    if ((len_out_q == 0) || (enc_q[0] != ENC_LAYER_PACK))
+      return backend_decode(enc_q,len_out_q,dec_q,ntot);
+
+    // The packed bytes are decoded into the beginning of dec_q and expanded in place
+    if ((len_out_q < 3UL) || ((enc_q[1] != 2) && (enc_q[1] != 4))) return 1;
+    int nbit = enc_q[1];
+    unsigned long int npk = (ntot*nbit+7UL)/8UL;
+    if (backend_decode(enc_q+3,len_out_q-3UL,dec_q,npk)) return 1;
+    unpack_symbols(dec_q,ntot,nbit,enc_q[2]);
+    return 0;
+}
 
-    // Output vector counter
-    unsigned long int jtot = 0;
+/* Value represented by a quantized element of a bit plane; shared by the encoder residual and the decoder accumulation */
+template <typename T>
+static inline T dequant(unsigned char q, T deps, T minval)
+{
+    return q*deps + minval;
+}
 
-    // Byte layer counter
-    unsigned char ilay = 0;
+/* Minimum and maximum values of an array. Plain comparisons are used instead of fmin/fmax, which do not vectorize */
+template <typename T>
+static void layer_bounds(const T *fld, unsigned long int ntot, T& minval, T& maxval)
+{
+    T vmin = fld[0];
+    T vmax = fld[0];
+    #pragma omp simd reduction(min:vmin) reduction(max:vmax)
+    for (unsigned long int j = 0; j < ntot; j++)
+      {
+        vmin = (fld[j] < vmin) ? fld[j] : vmin;
+        vmax = (fld[j] > vmax) ? fld[j] : vmax;
+      }
+    minval = vmin;
+    maxval = vmax;
+}
 
-    // Minimum cutoff
-    T tolrel = cutoffvec[0];
-    for (unsigned int k=1; k<mtot; k++) if (cutoffvec[k] < tolrel) tolrel = cutoffvec[k];
+/* Local precision of every wavelet coefficient prec_w, in the storage order of the transform, for the local cutoffs 
+   cutoffvec on an mx x my x mz block grid. The cutoffs apply to the points at level LOC_CUTOFF_LVL or below as 
+   returned by ind_p2w_3d, tolabs elsewhere; the indexes are converted with separable tables instead of a call of 
+   ind_p2w_3d per element */
+template <typename T>
+static void local_precision(int nx, int ny, int nz, const int *lvlvec, int wlev, int mx, int my, int mz, const T *cutoffvec, T tolrel, T tolabs, T *prec_w)
+{
+    // Index conversion tables and local cutoff block indexes in the three directions
+    int nn[3] = {nx, ny, nz};
+    int mm[3] = {mx, my, mz};
+    int *lext[3], *iw[3], *kb[3];
+    int ntr = 0;
+    for (int d = 0; d < 3; d++)
+      {
+        lext[d] = new int[nn[d]];
+        iw[d] = new int[(wlev+1)*nn[d]];
+        kb[d] = new int[nn[d]];
+        int ntrd = ind_p2w_tab(lvlvec[d], wlev, nn[d], lext[d], iw[d]);
+        if (ntrd > ntr) ntr = ntrd;
+        for (int i = 0; i < nn[d]; i++) kb[d][i] = int(T(i)/T(nn[d])*T(mm[d]));
+      }
 
-    // Absolute tolerance
-    tolabs = tolrel * fmax(fabs(minval),fabs(maxval));
+    // Level of all points as returned by ind_p2w_3d
+    int lvl = (ntr > 0) ? wlev : 0;
 
-    // Apply a correction for round-off errors in wavelet transform
-    tolabs /= WAV_ACC_COEF;
+    #pragma omp parallel for schedule(static)
+    for (int jz = 0; jz < nz; jz++)
+      for (int jy = 0; jy < ny; jy++)
+        {
+          int lyz = (lext[1][jy] < lext[2][jz]) ? lext[1][jy] : lext[2][jz];
+          if (ntr < lyz) lyz = ntr;
+          for (int jx = 0; jx < nx; jx++)
+            {
+              int l = (lext[0][jx] < lyz) ? lext[0][jx] : lyz;
+              unsigned long int jw = (unsigned long int)(iw[0][l*nx+jx]) + 
+                                     (unsigned long int)(nx)*(unsigned long int)(iw[1][l*ny+jy]) +
+                                     (unsigned long int)(nx)*(unsigned long int)(ny)*(unsigned long int)(iw[2][l*nz+jz]);
+              prec_w[jw] = (lvl <= LOC_CUTOFF_LVL) ? tolabs/tolrel * cutoffvec[kb[0][jx]+mx*kb[1][jy]+mx*my*kb[2][jz]] : tolabs;
+            }
+        }
 
-    // Iteration break flag set to false by default
-    unsigned char brflag = 0;
+    for (int d = 0; d < 3; d++)
+      {
+        delete [] lext[d];
+        delete [] iw[d];
+        delete [] kb[d];
+      }
+}
 
-    // Quantize and encode all byte layers
-    while (1)
-    {
-        // Calculate min and max
-        minval = fld_1d[0];
-        maxval = fld_1d[0];
-        for(unsigned long int j = 1; j < ntot; j++) 
+/* Quantize one bit plane into fld_q and replace fld with the quantization residual in a single sweep, also returning 
+   the bounds of the residual for the next bit plane. If the local precision mask prec_w is given, elements whose 
+   precision exceeds the full range of the bit plane are not coded */
+template <typename T>
+static void quantize_layer(T *fld, unsigned char *fld_q, const T *prec_w, unsigned long int ntot, T range, T aopt, T bopt, T deps, T minval, T& resmin, T& resmax)
+{
+    T vmin = T(HUGE_VAL);
+    T vmax = -T(HUGE_VAL);
+    if (prec_w)
+      {
+        #pragma omp simd reduction(min:vmin) reduction(max:vmax)
+        for (unsigned long int j = 0; j < ntot; j++)
+          {
+            // Set to zero if the full range is less than the local precision, otherwise to a value between 0 and 256
+            unsigned char lowrange = (range < prec_w[j]);
+            T x = lowrange ? minval : fld[j];
+            unsigned char fq = (unsigned char)(lowrange ? T(0) : aopt * x + bopt); // x-minval is always >= 0
+            T r = x - dequant(fq,deps,minval);
+            fld_q[j] = fq;
+            fld[j] = r;
+            vmin = (r < vmin) ? r : vmin;
+            vmax = (r > vmax) ? r : vmax;
+          }
+      }
+    else
+      {
+        #pragma omp simd reduction(min:vmin) reduction(max:vmax)
+        for (unsigned long int j = 0; j < ntot; j++)
           {
-            minval = fmin(minval,fld_1d[j]);
-            maxval = fmax(maxval,fld_1d[j]);
+            unsigned char fq = (unsigned char)(aopt * fld[j] + bopt); // fld[j]-minval is always >= 0
+            T r = fld[j] - dequant(fq,deps,minval);
+            fld_q[j] = fq;
+            fld[j] = r;
+            vmin = (r < vmin) ? r : vmin;
+            vmax = (r > vmax) ? r : vmax;
           }
+      }
+    resmin = vmin;
+    resmax = vmax;
+}
 
-        // Store the minimum value
-        minval_vec[ilay] = minval;
+/* Add a decoded bit plane to the cumulative field */
+template <typename T>
+static void accumulate_layer(T *fld, const unsigned char *fld_q, unsigned long int ntot, T deps, T minval)
+{
+    #pragma omp simd
+    for (unsigned long int j = 0; j < ntot; j++)
+      fld[j] = fld[j] + dequant(fld_q[j],deps,minval);
+}
 
+/* Copy the wavelet coefficients in wavelet space fld to fld_sb in subband order, each subband contiguous with its 
+   first direction fastest, or back from fld_sb to fld if inv is set. The bit planes are coded in subband order, 
+   such that the frequency table of every coded block is that of one subband or of a few small coarse subbands 
+   instead of a mixture of all subbands crossed by the rows of the array */
+template <typename T>
+static void subband_order(int nx, int ny, int nz, const int *lvlvec, T *fld, T *fld_sb, int inv)
+{
+    int box[6*(1+7*WAV_LVL_MAX)];
+    int nb = subband_boxes(lvlvec[0],lvlvec[1],lvlvec[2],nx,ny,nz,box);
+    unsigned long int pos = 0;
+    for (int ib = 0; ib < nb; ib++)
+      {
+        const int *b = box + 6*ib;
+        unsigned long int lx = (unsigned long int)(b[1]-b[0]);
+        unsigned long int ly = (unsigned long int)(b[3]-b[2]);
+        #pragma omp parallel for schedule(static)
+        for (int jz = b[4]; jz < b[5]; jz++)
+          for (int jy = b[2]; jy < b[3]; jy++)
+            {
+              T *row = fld + b[0] + (unsigned long int)(nx)*((unsigned long int)(jy) + (unsigned long int)(ny)*(unsigned long int)(jz));
+              T *row_sb = fld_sb + pos + lx*((unsigned long int)(jy-b[2]) + ly*(unsigned long int)(jz-b[4]));
+              if (inv) 
+                memcpy(row,row_sb,lx*sizeof(T));
+              else
+                memcpy(row_sb,row,lx*sizeof(T));
+            }
+        pos += lx*ly*(unsigned long int)(b[5]-b[4]);
+      }
+}
 
-        // Quantize for a q-letter alphabet
-        T deps = (maxval-minval)/(T)(q-1);
+/* Store and load a 64-bit integer as 8 little-endian bytes */
+static void put_u64(unsigned char *buf, unsigned long int u)
+{
+    for (int k = 0; k < 8; k++) buf[k] = (unsigned char)(u >> (8*k));
+}
+static unsigned long int get_u64(const unsigned char *buf)
+{
+    unsigned long int u = 0;
+    for (int k = 0; k < 8; k++) u |= (unsigned long int)(buf[k]) << (8*k);
+    return u;
+}
 
-        // Impose the desired accuracy of the least significant bit plane
-        if (deps < tolabs) 
-        {
-          deps = tolabs;
-          brflag = 1;
-        }
+/* Store a real number as its sizeof(T) little-endian bytes, and load one stored with size bytes (4 or 8) */
+template <typename T>
+static void put_real(unsigned char *buf, T x)
+{
+    unsigned long int u = 0;
+    memcpy(&u,&x,sizeof(T));
+    for (unsigned int k = 0; k < sizeof(T); k++) buf[k] = (unsigned char)(u >> (8*k));
+}
+template <typename T>
+static T get_real(const unsigned char *buf, int size)
+{
+    if (size == 8)
+      {
+        unsigned long int u = get_u64(buf);
+        double x;
+        memcpy(&x,&u,8);
+        return T(x);
+      }
+    unsigned int u = 0;
+    for (int k = 0; k < 4; k++) u |= (unsigned int)(buf[k]) << (8*k);
+    float x;
+    memcpy(&x,&u,4);
+    return T(x);
+}
 
-        // Termnate if maximum bit plane is reached
-        if (ilay >= NLAYMAX-1U) brflag = 1;
 
-        // Save the quantization interval size
-        deps_vec[ilay] = deps;
+/* A bit plane larger than one chunk is split in chunks of RC_CHUNK_BLOCKS range coder blocks, each coded as an 
+   independent stream. The encoded bit plane is then [ENC_LAYER_CHUNKS][chunk size][number of chunks][length of 
+   every chunk][chunk data], the integers stored as 8 bytes. A bit plane of one chunk is a single range-coded stream */
+static unsigned long int rc_nchunk(unsigned long int ntot)
+{
+    unsigned long int nsym = RC_CHUNK_BLOCKS*BLOCKSIZE;
+    return (ntot > nsym) ? (ntot-1UL)/nsym + 1UL : 1UL;
+}
 
-        // Combinations of minval and deps, for optimization
-        T aopt = 1.0/deps;
-        T bopt = -minval*aopt+0.5;
+/* Length of the chunk table */
+static unsigned long int rc_table_len(unsigned long int nchunk)
+{
+    return (nchunk > 1UL) ? 17UL + 8UL*nchunk : 0UL;
+}
 
-        // Two branches depending on the local precision mask activated or not
-        if (mtot > 1)
-          {
-          // Loop for all jp in physical space
-          for(unsigned long int jp = 0; jp < ntot; jp++)
-            {   
-              // Calculate 3D index in wavelet space
-              int l, jwx, jwy, jwz;
-              ind_p2w_3d( wlev, nx, ny, nz, jp%nx, (jp/nx)%ny, jp/nx/ny, &l, &jwx, &jwy, &jwz);
+/* Space for every encoded chunk but the last one when a bit plane of ntot symbols is encoded into len_max bytes. The 
+   chunks are encoded into equal slots after the chunk table and packed afterwards, the last chunk takes the 
+   remaining space, which holds at least its symbols stored raw */
+static unsigned long int rc_slot_len(unsigned long int ntot, unsigned long int len_max)
+{
+    unsigned long int nchunk = rc_nchunk(ntot);
+    if (nchunk == 1UL) return len_max;
+    unsigned long int nlast = ntot - (nchunk-1UL)*RC_CHUNK_BLOCKS*BLOCKSIZE;
+    unsigned long int lrest = rc_table_len(nchunk) + nlast + 1UL;
+    return (len_max > lrest) ? (len_max-lrest)/(nchunk-1UL) : 0UL;
+}
 
-              // Uniform cutoff by default
-              T precmask = tolabs;
+/* Size of an array that receives one encoded bit plane of ntot symbols */
+static unsigned long int rc_layer_len(unsigned long int ntot)
+{
+    unsigned long int nchunk = rc_nchunk(ntot);
+    unsigned long int nsym = (nchunk > 1UL) ? RC_CHUNK_BLOCKS*BLOCKSIZE : ntot;
+    return rc_table_len(nchunk) + nchunk*(SAFETY_BUFFER_FACTOR+1UL)*(nsym<1024UL?1024UL:nsym);
+}
 
-              // Load precision cutoff function in physical space, only applied on smallest detail coefficients
-              if (l <= LOC_CUTOFF_LVL) 
-                precmask = tolabs/tolrel * lcl_prec(nx, ny, nz, jp%nx, (jp/nx)%ny, jp/nx/ny, mx, my, mz, cutoffvec);
+/* Largest length of one encoded bit plane of ntot symbols, with every chunk stored raw */
+static unsigned long int rc_layer_max(unsigned long int ntot)
+{
+    unsigned long int nchunk = rc_nchunk(ntot);
+    return rc_table_len(nchunk) + ntot + nchunk;
+}
 
-              // 1D index in wavelet space
-              unsigned long int jw = (unsigned long int)(jwx) + 
-                                     (unsigned long int)(nx)*(unsigned long int)(jwy) +
-                                     (unsigned long int)(nx)*(unsigned long int)(ny)*(unsigned long int)(jwz);
-  
-              // For every element, quantize depending on the local precision mask 
-              if (maxval-minval < precmask) 
-                { 
-                  // Set to zero if the full range is less than the local precision
-                  // Note that fld_q is in wavelet space
-                  fld_q[jw] = 0;
-                  fld_1d[jw] = minval; 
-                } 
-              else 
-                { 
-                  // Set to a value between 0 and 256 if the full range is greater than the local precision
-                  T fq = aopt * fld_1d[jw] + bopt; // fld_1d[jp]-minval is always >= 0
-                  fld_q[jw] = fq;
-                }
-            }
-          }
-        // If the local precision mask is not activated, use faster loop
-        else
-          {
-          // Loop for all jp in physical space
-          for(unsigned long int jp = 0; jp < ntot; jp++)
-            {   
-              // Set to a value between 0 and 256 if the full range is greater than the local precision
-              T fq = aopt * fld_1d[jp] + bopt; // fld_1d[jp]-minval is always >= 0
-              fld_q[jp] = fq;
-            }
-          }   	 
-    
-        // The following only executes if all quantized data are non-zero
+/* Required size of the encoded data array of a field of ntot elements: the largest field descriptor, the 
+   significance map and NLAYMAX bit planes, all streams stored raw. Smaller fields have no significance map */
+static unsigned long int enc_len_max(unsigned long int ntot)
+{
+    unsigned long int lsmap = (ntot >= DEAD_ZONE_MIN) ? (unsigned long int)(1+7*WAV_LVL_MAX) + rc_layer_max(ntot/8UL+1UL) : 0UL;
+    return SAFETY_BUFFER_FACTOR*(24UL + lsmap + NLAYMAX*rc_layer_max(ntot));
+}
 
-        // Residual field
-        for(unsigned long int j = 0; j < ntot; j++)
-          fld_1d[j] = fld_1d[j] - ( fld_q[j]*deps + minval );
+/* Encode chunk ic of the bit plane fld_q into its slot of enc_q, which has room for len_max bytes; the encoded 
+   length is returned in clen[ic]. The chunks may be encoded in any order and concurrently. Returns nonzero if the 
+   chunk does not fit */
+static int range_encode_chunk(unsigned char *fld_q, unsigned long int ntot, unsigned long int ic, unsigned char *enc_q, unsigned long int len_max, unsigned long int *clen, int ibackend)
+{
+    unsigned long int nchunk = rc_nchunk(ntot);
+    if (nchunk == 1UL) return entropy_encode(fld_q,ntot,enc_q,len_max,clen[0],ibackend);
+    unsigned long int nsym = RC_CHUNK_BLOCKS*BLOCKSIZE;
+    unsigned long int j0 = ic*nsym;
+    unsigned long int nj = (ntot-j0 < nsym) ? ntot-j0 : nsym;
+    unsigned long int slot = rc_slot_len(ntot,len_max);
+    unsigned long int off = rc_table_len(nchunk)+ic*slot;
+    unsigned long int room = (ic+1UL < nchunk) ? slot : ((len_max > off) ? len_max-off : 0UL);
+    return entropy_encode(fld_q+j0,nj,enc_q+off,room,clen[ic],ibackend);
+}
 
-        // Check quantized data bounds
-        unsigned char iminval = fld_q[0];
-        unsigned char imaxval = fld_q[0];
-        for(unsigned long int j = 1; j < ntot; j++)
-          {
-             unsigned char fld1_q_tmp = fld_q[j];
-             if (fld1_q_tmp<iminval) iminval = fld1_q_tmp;
-             if (fld1_q_tmp>imaxval) imaxval = fld1_q_tmp;
-          }
+/* Write the chunk table in front of the encoded chunks and pack the chunks behind it */
+static void range_encode_pack(unsigned long int ntot, unsigned char *enc_q, unsigned long int len_max, const unsigned long int *clen, unsigned long int& len_out_q)
+{
+    unsigned long int nchunk = rc_nchunk(ntot);
+    if (nchunk == 1UL)
+      {
+        len_out_q = clen[0];
+        return;
+      }
+    unsigned long int slot = rc_slot_len(ntot,len_max);
+    enc_q[0] = ENC_LAYER_CHUNKS;
+    put_u64(enc_q+1,RC_CHUNK_BLOCKS*BLOCKSIZE);
+    put_u64(enc_q+9,nchunk);
+    len_out_q = rc_table_len(nchunk);
+    for (unsigned long int ic = 0; ic < nchunk; ic++)
+      {
+        put_u64(enc_q+17+8*ic,clen[ic]);
+        memmove(enc_q+len_out_q,enc_q+rc_table_len(nchunk)+ic*slot,clen[ic]);
+        len_out_q += clen[ic];
+      }
+}
 
-        // Encode
-        range_encode(fld_q,ntot,enc_q,len_out_q);
+/* Encode a bit plane into enc_q of length len_max, all chunks in parallel. Returns nonzero if it does not fit */
+static int range_encode_layer(unsigned char *fld_q, unsigned long int ntot, unsigned char *enc_q, unsigned long int len_max, unsigned long int& len_out_q, int ibackend)
+{
+    long int nchunk = long(rc_nchunk(ntot));
+    unsigned long int *clen = new unsigned long int[rc_nchunk(ntot)];
+    int overflow = (rc_slot_len(ntot,len_max) == 0);
+    #pragma omp parallel for schedule(dynamic,1) reduction(|:overflow) if(nchunk > 1)
+    for (long int ic = 0; ic < nchunk; ic++)
+      overflow |= range_encode_chunk(fld_q,ntot,ic,enc_q,len_max,clen,ibackend);
+    if (!overflow) range_encode_pack(ntot,enc_q,len_max,clen,len_out_q);
+    delete [] clen;
+    return overflow;
+}
 
-        // Store the encoded data
-        len_enc_vec[ilay] = len_out_q;
-        for(unsigned long int j = 0; j < len_out_q; j++) 
+/* Append encoded data to the caller's array data_enc, or pass it to the sink write_enc if one is given. Data that 
+   is already in place in data_enc is not copied */
+static void emit_enc(const unsigned char *buf, unsigned long int len, unsigned char *data_enc, unsigned long int& jtot, void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len))
+{
+    if (write_enc) 
+      write_enc(ctx_out,buf,len);
+    else if (buf != data_enc+jtot) 
+      memcpy(data_enc+jtot,buf,len);
+    jtot += len;
+}
+
+/* Locate the chunks of an encoded bit plane of ntot symbols. If the arrays are given, the position and length of 
+   every chunk in the encoded data and in the decoded bit plane are returned. Returns the number of chunks */
+static unsigned long int range_decode_table(const unsigned char *enc_q, unsigned long int len_out_q, unsigned long int ntot, unsigned long int *eoff, unsigned long int *elen, unsigned long int *doff, unsigned long int *dlen)
+{
+    // Single range-coded stream
+    if ((len_out_q == 0) || (enc_q[0] != ENC_LAYER_CHUNKS))
+      {
+        if (eoff) 
           {
-            // Store the encoded data element
-            data_enc[jtot++] = enc_q[j];
+            eoff[0] = 0; elen[0] = len_out_q;
+            doff[0] = 0; dlen[0] = ntot;
+          }
+        return 1UL;
+      }
 
-            // Check for overflow
-            if (jtot > SAFETY_BUFFER_FACTOR*NLAYMAX*(ntot<1024UL?1024UL:ntot))
+    // Chunk table
+    unsigned long int nsym = (len_out_q >= 17UL) ? get_u64(enc_q+1) : 0UL;
+    unsigned long int nchunk = (len_out_q >= 17UL) ? get_u64(enc_q+9) : 0UL;
+    if ((nsym == 0) || (nchunk == 0) || (nchunk != (ntot+nsym-1UL)/nsym) || (rc_table_len(nchunk) > len_out_q))
+      {
+        cout << "Error: invalid chunk table in the encoded data" << endl;
+        throw std::exception();
+      }
+    if (eoff)
+      {
+        unsigned long int pos = rc_table_len(nchunk);
+        for (unsigned long int ic = 0; ic < nchunk; ic++)
+          {
+            eoff[ic] = pos;
+            elen[ic] = get_u64(enc_q+17+8*ic);
+            doff[ic] = ic*nsym;
+            dlen[ic] = (ntot-doff[ic] < nsym) ? ntot-doff[ic] : nsym;
+            pos += elen[ic];
+            if (pos > len_out_q)
               {
-                cout << "Error: encoded array is too large. Use larger SAFETY_BUFFER_FACTOR" << endl;
+                cout << "Error: invalid chunk table in the encoded data" << endl;
                 throw std::exception();
               }
           }
+      }
+    return nchunk;
+}
 
+/* Decode a bit plane, all chunks in parallel. Only the chunks that hold the first nreq symbols are decoded */
+static void range_decode_layer(unsigned char *enc_q, unsigned long int len_out_q, unsigned char *dec_q, unsigned long int ntot, unsigned long int nreq)
+{
+    long int nchunk = long(range_decode_table(enc_q,len_out_q,ntot,NULL,NULL,NULL,NULL));
+    unsigned long int *eoff = new unsigned long int[4*nchunk];
+    unsigned long int *elen = eoff+nchunk, *doff = eoff+2*nchunk, *dlen = eoff+3*nchunk;
+    range_decode_table(enc_q,len_out_q,ntot,eoff,elen,doff,dlen);
+    int overflow = 0;
+    #pragma omp parallel for schedule(dynamic,1) reduction(|:overflow) if(nchunk > 1)
+    for (long int ic = 0; ic < nchunk; ic++)
+      if (doff[ic] < nreq) overflow |= entropy_decode(enc_q+eoff[ic],elen[ic],dec_q+doff[ic],dlen[ic]);
+    delete [] eoff;
+    if (overflow)
+      {
+        cout << "Error: corrupted range-coded data" << endl;
+        throw std::exception();
+      }
+}
 
-        // Update layer index
-        ilay ++;
-
-        // Stop when the required tolerance is reached for all samples
-        if ( brflag ) 
-          {
-             // Stop iterations
-             break;
-          }
-    }
-
-    // Number of byte layers
-    nlay = ilay;
 
-    // Total encoded data array length
-    ntot_enc = jtot;
+/* Start of every subband in subband order, soff[ib] to soff[ib+1] for subband ib. soff must have room for 
+   2+7*WAV_LVL_MAX entries. Returns the number of subbands */
+static int subband_offsets(int nx, int ny, int nz, const int *lvlvec, unsigned long int *soff)
+{
+    int box[6*(1+7*WAV_LVL_MAX)];
+    int nb = subband_boxes(lvlvec[0],lvlvec[1],lvlvec[2],nx,ny,nz,box);
+    soff[0] = 0;
+    for (int ib = 0; ib < nb; ib++)
+      {
+        const int *b = box + 6*ib;
+        soff[ib+1] = soff[ib] + (unsigned long int)(b[1]-b[0])*(unsigned long int)(b[3]-b[2])*(unsigned long int)(b[5]-b[4]);
+      }
+    return nb;
+}
 
-    // Deallocate memory
-    delete [] fld_q;
-    delete [] enc_q;
+/* Transform depth in each direction of an encoded field, wlev in all directions unless stored in the field descriptor */
+static void stored_levels(unsigned char wlev, unsigned long int ntot_enc, const unsigned char *data_enc, int *lvlvec)
+{
+    for (int d = 0; d < 3; d++) lvlvec[d] = int(wlev);
+    if ((ntot_enc == 0) || !(data_enc[0] & ENC_FIELD_DESC)) return;
+    if (data_enc[2] == WAV_TYPE_CDF97) 
+      for (int d = 0; d < 3; d++) lvlvec[d] = data_enc[3+d];
+    if ((data_enc[2] == WAV_TYPE_CDF53) && (data_enc[1] >= 21)) 
+      for (int d = 0; d < 3; d++) lvlvec[d] = data_enc[20+d];
 }
 
+/* Extents nred and remaining transform depths lred of the low-pass block left by the ired finest levels, at most the 
+   transform depth in each direction. The subbands of the remaining levels come first in subband order, and the 
+   inverse transform of the block with the depths lred is the same as the coarse levels of the full inverse transform. 
+   Returns the number of skipped levels that filtered a direction, each of them scales the 9/7 low-pass block by 
+   sqrt(2) */
+static int lowpass_extents(int nx, int ny, int nz, const int *lvlvec, int ired, int *nred, int *lred)
+{
+    int n[3] = {nx, ny, nz};
+    int nscl = 0;
+    for (int d = 0; d < 3; d++)
+      {
+        int r = (ired < lvlvec[d]) ? ired : lvlvec[d];
+        if (r < 0) r = 0;
+        nred[d] = n[d];
+        lred[d] = lvlvec[d]-r;
+        for (int k = 0; k < r; k++)
+          {
+            if (nred[d] > 1) nscl++;
+            nred[d] = nred[d]/2 + nred[d]%2;
+          }
+      }
+    return nscl;
+}
 
-/* Decoding subroutine with range decoding and inverse wavelet transform*/
+/* Copy the block of extents nred from the corner of a field of extents nx x ny x nz into fld_r */
 template <typename T>
-void decoding_wrap(int nx, int ny, int nz, T *fld_1d, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+static void lowpass_block(int nx, int ny, const int *nred, const T *fld, T *fld_r)
 {
-    // Total number of elements
-    unsigned long int ntot = (unsigned long int)(nx)*(unsigned long int)(ny)*(unsigned long int)(nz);
+    unsigned long int lx = (unsigned long int)(nred[0]);
+    #pragma omp parallel for schedule(static)
+    for (int jz = 0; jz < nred[2]; jz++)
+      for (int jy = 0; jy < nred[1]; jy++)
+        memcpy(fld_r + lx*((unsigned long int)(jy) + (unsigned long int)(nred[1])*(unsigned long int)(jz)),fld + (unsigned long int)(nx)*((unsigned long int)(jy) + (unsigned long int)(ny)*(unsigned long int)(jz)),lx*sizeof(T));
+}
 
-    // Case of trivial data
-    if (ntot_enc == 0)
+/* Significance pass of the dead-zone quantizer on the coefficients fld in subband order. Coefficients whose 
+   magnitude does not exceed DEAD_ZONE times half their precision (prec_w if given, otherwise tolabs) are 
+   reconstructed as zero, the others are moved to the beginning of fld and prec_w in the same order. The 
+   significance map smap of length lsmap is allocated: one byte per subband, SIG_NONE if all coefficients of the 
+   subband are insignificant, SIG_MIXED if the entropy of its bitmap is less than SIG_SAVED_BITS per insignificant 
+   coefficient, SIG_ALL otherwise, followed by a coded bitmap of the mixed subbands. All coefficients of a SIG_ALL 
+   subband are coded, since a bitmap would cost more than it saves. Runs of insignificant coefficients give runs of 
+   zero bytes in the bitmap, which cost almost nothing after entropy coding. Returns the number of coded 
+   coefficients. If there is none, or fewer than DEAD_ZONE_MIN coefficients are removed, smap is NULL and all 
+   coefficients are kept */
+template <typename T>
+static unsigned long int significance_pass(int nx, int ny, int nz, const int *lvlvec, T *fld, T *prec_w, T tolabs, unsigned char*& smap, unsigned long int& lsmap, int ibackend)
+{
+    unsigned long int soff[2+7*WAV_LVL_MAX];
+    int nb = subband_offsets(nx,ny,nz,lvlvec,soff);
+    unsigned long int ntot = soff[nb];
+    T thr = T(0.5*DEAD_ZONE)*tolabs;
+    T fac = T(0.5*DEAD_ZONE);
+
+    // Bitmap of all coefficients, the bits of every subband start at a byte boundary
+    unsigned long int nball = 0;
+    for (int ib = 0; ib < nb; ib++) nball += (soff[ib+1]-soff[ib]+7UL)/8UL;
+    unsigned char *bits = new unsigned char[nball+1UL];
+    memset(bits,0,nball+1UL);
+
+    // Significant coefficients of every subband, its flag is chosen from their number and the entropy of its bitmap
+    unsigned char flag[1+7*WAV_LVL_MAX];
+    unsigned long int nsig = 0, ncod = 0, nbit = 0, jb0 = 0;
+    for (int ib = 0; ib < nb; ib++)
       {
-        // Reconstruct
-        for(unsigned long int j = 0; j < ntot; j++) fld_1d[j] = midval;
-
-        // Exit 
-        return;
+        unsigned long int c = 0;
+        unsigned long int nsb = soff[ib+1]-soff[ib];
+        for (unsigned long int j = 0; j < nsb; j++)
+          {
+            int s = (prec_w ? fabs(fld[soff[ib]+j]) > fac*prec_w[soff[ib]+j] : fabs(fld[soff[ib]+j]) > thr);
+            bits[jb0+j/8UL] |= (unsigned char)(s << (j%8UL));
+            c += s;
+          }
+        unsigned long int counts[256];
+        symbol_counts(bits+jb0,(nsb+7UL)/8UL,counts);
+        double cost = symbol_entropy(counts,(nsb+7UL)/8UL)*double((nsb+7UL)/8UL);
+        flag[ib] = (c == 0) ? SIG_NONE : (cost < SIG_SAVED_BITS*double(nsb-c)) ? SIG_MIXED : SIG_ALL;
+        nsig += c;
+        ncod += (flag[ib] == SIG_ALL) ? nsb : c;
+        if (flag[ib] == SIG_MIXED) nbit += nsb;
+        jb0 += (nsb+7UL)/8UL;
       }
+    smap = NULL;
+    lsmap = 0;
+    if ((nsig == 0) || (ntot-ncod < DEAD_ZONE_MIN)) 
+      {
+        delete [] bits;
+        return ntot;
+      }
+
+    // Subband flags and bitmap of the mixed subbands, packed in place, compact the coded coefficients
+    unsigned long int nbm = (nbit+7UL)/8UL;
+    unsigned long int lmax = (unsigned long int)(nb) + rc_layer_len(nbm);
+    smap = new unsigned char[lmax];
+    unsigned long int jc = 0, jb = 0;
+    jb0 = 0;
+    for (int ib = 0; ib < nb; ib++)
+      {
+        unsigned long int nsb = soff[ib+1]-soff[ib];
+        smap[ib] = flag[ib];
+        if (flag[ib] == SIG_ALL)
+          {
+            memmove(fld+jc,fld+soff[ib],nsb*sizeof(T));
+            if (prec_w) memmove(prec_w+jc,prec_w+soff[ib],nsb*sizeof(T));
+            jc += nsb;
+          }
+        else if (flag[ib] == SIG_MIXED)
+          {
+            unsigned char b = 0;
+            for (unsigned long int j = 0; j < nsb; j++, jb++)
+            {
+              // The source byte is cached, the packed bitmap never runs ahead of it
+              if (j%8UL == 0) b = bits[jb0+j/8UL];
+              int s = (b >> (j%8UL)) & 1;
+              if (jb%8UL == 0) bits[jb/8UL] = 0;
+              bits[jb/8UL] |= (unsigned char)(s << (jb%8UL));
+              if (!s) continue;
+              fld[jc] = fld[soff[ib]+j];
+              if (prec_w) prec_w[jc] = prec_w[soff[ib]+j];
+              jc++;
+            }
+          }
+        jb0 += (nsb+7UL)/8UL;
+      }
+    lsmap = (unsigned long int)(nb);
+    if (nbm > 0)
+      {
+        unsigned long int len = 0;
+        if (entropy_encode(bits,nbm,smap+nb,lmax-nb,len,ibackend))
+          {
+            cout << "Error: encoded array is too large. Use larger SAFETY_BUFFER_FACTOR" << endl;
+            throw std::exception();
+          }
+        lsmap += len;
+      }
+    delete [] bits;
+    return ncod;
+}
+
+/* Decode the significance map smap of length lsmap. The bitmap of the mixed subbands is allocated and returned in 
+   bits, the coded coefficients of subband ib from coff[ib] to coff[ib+1]. Returns the number of coded coefficients */
+static unsigned long int significance_decode(int nx, int ny, int nz, const int *lvlvec, unsigned char *smap, unsigned long int lsmap, unsigned char*& bits, unsigned long int *coff)
+{
+    unsigned long int soff[2+7*WAV_LVL_MAX];
+    int nb = subband_offsets(nx,ny,nz,lvlvec,soff);
+    unsigned long int ncod = 0, nbit = 0;
+    int valid = (lsmap >= (unsigned long int)(nb));
+    for (int ib = 0; valid && (ib < nb); ib++)
+      {
+        valid = (smap[ib] <= SIG_MIXED);
+        if (smap[ib] == SIG_MIXED) nbit += soff[ib+1]-soff[ib];
+        if (smap[ib] == SIG_ALL) ncod += soff[ib+1]-soff[ib];
+      }
+    unsigned long int nbm = (nbit+7UL)/8UL;
+    bits = new unsigned char[nbm+1UL];
+    if (valid && (nbm > 0)) valid = !entropy_decode(smap+nb,lsmap-nb,bits,nbm);
+    if (!valid)
+      {
+        delete [] bits;
+        cout << "Error: corrupted significance map in the encoded data" << endl;
+        throw std::exception();
+      }
+    ncod = 0;
+    unsigned long int jb = 0;
+    for (int ib = 0; ib < nb; ib++)
+      {
+        coff[ib] = ncod;
+        if (smap[ib] == SIG_ALL) ncod += soff[ib+1]-soff[ib];
+        if (smap[ib] == SIG_MIXED)
+          for (unsigned long int j = soff[ib]; j < soff[ib+1]; j++, jb++) ncod += (bits[jb/8UL] >> (jb%8UL)) & 1;
+      }
+    coff[nb] = ncod;
+    return ncod;
+}
+
+/* Expand the significant coefficients fld_s to all coefficients fld in subband order, with zeros for the 
+   insignificant ones, following the subband flags smap and the bitmap bits */
+template <typename T>
+static void significance_expand(int nx, int ny, int nz, const int *lvlvec, const unsigned char *smap, const unsigned char *bits, const T *fld_s, T *fld)
+{
+    unsigned long int soff[2+7*WAV_LVL_MAX];
+    int nb = subband_offsets(nx,ny,nz,lvlvec,soff);
+    unsigned long int jc = 0, jb = 0;
+    for (int ib = 0; ib < nb; ib++)
+      {
+        unsigned long int nsb = soff[ib+1]-soff[ib];
+        if (smap[ib] == SIG_NONE)
+          for (unsigned long int j = soff[ib]; j < soff[ib+1]; j++) fld[j] = 0;
+        else if (smap[ib] == SIG_ALL)
+          {
+            memcpy(fld+soff[ib],fld_s+jc,nsb*sizeof(T));
+            jc += nsb;
+          }
+        else
+          for (unsigned long int j = soff[ib]; j < soff[ib+1]; j++, jb++)
+            {
+              int s = (bits[jb/8UL] >> (jb%8UL)) & 1;
+              fld[j] = s ? fld_s[jc] : T(0);
+              jc += s;
+            }
+      }
+}
+
+
+/* Map a floating-point value to a signed integer that preserves the ordering and the exact bit pattern */
+template <typename T>
+static inline unsigned long int real_to_ord(T x)
+{
+    long int c;
+    if (sizeof(T) == 8) 
+      {
+        long int b;
+        memcpy(&b,&x,8);
+        c = (b >= 0) ? b : -(b & 0x7fffffffffffffffL) - 1L;
+      }
+    else
+      {
+        int b;
+        memcpy(&b,&x,4);
+        c = (b >= 0) ? (long int)(b) : -(long int)(b & 0x7fffffff) - 1L;
+      }
+    return (unsigned long int)(c);
+}
+
+
+/* Inverse of real_to_ord */
+template <typename T>
+static inline T ord_to_real(unsigned long int u)
+{
+    T x;
+    long int c = (long int)(u);
+    if (sizeof(T) == 8) 
+      {
+        unsigned long int b = (c >= 0) ? (unsigned long int)(c) : (unsigned long int)(-(c+1L)) | 0x8000000000000000UL;
+        memcpy(&x,&b,8);
+      }
+    else
+      {
+        unsigned int b = (c >= 0) ? (unsigned int)(c) : (unsigned int)(-(c+1L)) | 0x80000000U;
+        memcpy(&x,&b,4);
+      }
+    return x;
+}
+
+
+/* Encoding with the reversible integer wavelet transform. The field is mapped to integers, exactly if tolrel is zero, 
+   otherwise by uniform quantization with the step 2*tolabs. The transform coefficients are coded by byte planes */ 
+template <typename T>
+static void encoding_cdf53(int nx, int ny, int nz, T *fld_1d, T tolrel, T minval, T maxval, T midval, T& tolabs, const int *lvlvec, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len), int ibackend)
+{
+    // Total number of elements in the input array
+    unsigned long int ntot = (unsigned long int)(nx)*(unsigned long int)(ny)*(unsigned long int)(nz);
+
+    // Integer field
+    unsigned long int *fld_i = new unsigned long int[ntot];
+
+    // Quantization step, the quantized values must be exact integers in floating-point arithmetic.
+    // Exact mapping if the tolerance is zero or the field is not finite
+    double step = 2.0*double(tolrel)*fmax(fabs(double(minval)),fabs(double(maxval)));
+    unsigned char imap = INT_MAP_QUANT;
+    if (!(step > 0) || !((double(maxval)-double(minval))/step <= 4503599627370496.0)) imap = INT_MAP_EXACT;
+
+    // Map the field to integers
+    if (imap == INT_MAP_QUANT)
+      {
+        for (unsigned long int j = 0; j < ntot; j++) fld_i[j] = (unsigned long int)((long int)(floor((double(fld_1d[j])-double(midval))/step+0.5)));
+        tolabs = step/2;
+      }
+    else
+      {
+        for (unsigned long int j = 0; j < ntot; j++) fld_i[j] = real_to_ord(fld_1d[j]);
+        step = 0;
+        tolabs = 0;
+      }
+
+    // Apply wavelet transform
+    waveletcdf53_3d(nx,ny,nz,lvlvec[0],lvlvec[1],lvlvec[2],fld_i);
+
+    // Arrange the coefficients in subband order
+    unsigned char order = ((lvlvec[0] > 0) || (lvlvec[1] > 0) || (lvlvec[2] > 0)) ? WAV_ORDER : WAV_ORDER_MALLAT;
+    if (order == WAV_ORDER_SUBBAND)
+      {
+        unsigned long int *fld_sb = new unsigned long int[ntot];
+        subband_order(nx,ny,nz,lvlvec,fld_i,fld_sb,0);
+        delete [] fld_i;
+        fld_i = fld_sb;
+      }
+
+    // Offset all coefficients by the minimum, the byte planes are formed from the non-negative differences
+    long int cmin = (long int)(fld_i[0]);
+    for (unsigned long int j = 1; j < ntot; j++) if ((long int)(fld_i[j]) < cmin) cmin = (long int)(fld_i[j]);
+    unsigned long int umax = 0;
+    for (unsigned long int j = 0; j < ntot; j++) 
+      {
+        fld_i[j] -= (unsigned long int)(cmin);
+        if (fld_i[j] > umax) umax = fld_i[j];
+      }
+
+    // Number of byte planes
+    nlay = 1;
+    while ((nlay < 8) && (umax >> (8*nlay))) nlay++;
+
+    // Allocate the byte plane, with one more element since the range encoder reads one element past the end. The 
+    // encoded byte planes are written directly into the output array, or into a scratch array passed to the sink
+    unsigned char *fld_q = new unsigned char[ntot+1UL];
+    fld_q[ntot] = 0;
+    unsigned long int len_out_q = 0;
+    unsigned long int jmax = write_enc ? rc_layer_len(ntot) : enc_len_max(ntot);
+    unsigned char *lay_enc = write_enc ? new unsigned char[jmax] : NULL;
+
+    // Field descriptor, stored in front of the first byte plane
+    unsigned char desc[24];
+    desc[0] = ENC_FIELD_DESC;
+    desc[1] = 22;
+    desc[2] = WAV_TYPE_CDF53;
+    desc[3] = imap;
+    put_u64(desc+4,(unsigned long int)(cmin));
+    unsigned long int step_bits;
+    memcpy(&step_bits,&step,8);
+    put_u64(desc+12,step_bits);
+    for (int d = 0; d < 3; d++) desc[20+d] = (unsigned char)(lvlvec[d]);
+    desc[23] = order;
+
+    // Output vector counter
+    unsigned long int jtot = 0;
+    emit_enc(desc,sizeof(desc),data_enc,jtot,ctx_out,write_enc);
+
+    // Encode all byte planes, starting from the most significant one
+    for (unsigned char ilay = 0; ilay < nlay; ilay++)
+    {
+        // Extract the byte plane
+        int shift = 8*(nlay-1-ilay);
+        for (unsigned long int j = 0; j < ntot; j++) fld_q[j] = (unsigned char)(fld_i[j] >> shift);
+
+        // The byte planes are weighted by powers of two, no offset
+        deps_vec[ilay] = ldexp(T(1),shift);
+        minval_vec[ilay] = 0;
+
+        // Encode, checking for overflow
+        unsigned char *enc_q = write_enc ? lay_enc : data_enc+jtot;
+        if (range_encode_layer(fld_q,ntot,enc_q,write_enc ? jmax : jmax-jtot,len_out_q,ibackend))
+          {
+            cout << "Error: encoded array is too large. Use larger SAFETY_BUFFER_FACTOR" << endl;
+            throw std::exception();
+          }
+
+        // Store the encoded data
+        len_enc_vec[ilay] = len_out_q + (ilay == 0 ? sizeof(desc) : 0);
+        emit_enc(enc_q,len_out_q,data_enc,jtot,ctx_out,write_enc);
+    }
+
+    // Total encoded data array length
+    ntot_enc = jtot;
+
+    // Deallocate memory
+    delete [] fld_i;
+    delete [] fld_q;
+    if (lay_enc) delete [] lay_enc;
+}
+
+
+/* Decoding with the reversible integer wavelet transform, desc is the field descriptor. Only the first nlay_dec of 
+   the nlay byte planes are decoded, and the field is reconstructed at the resolution reduced by the ired finest 
+   levels */ 
+template <typename T>
+static void decoding_cdf53(int nx, int ny, int nz, T *fld_1d, T midval, unsigned char wlev, unsigned char nlay, unsigned char nlay_dec, int ired, const unsigned char *desc, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    // Total number of elements
+    unsigned long int ntot = (unsigned long int)(nx)*(unsigned long int)(ny)*(unsigned long int)(nz);
+
+    // Integer mapping, coefficient offset and quantization step
+    unsigned char imap = desc[3];
+    unsigned long int cmin = get_u64(desc+4);
+    unsigned long int step_bits = get_u64(desc+12);
+    double step;
+    memcpy(&step,&step_bits,8);
+
+    // Transform depth in each direction, the same in all directions if not stored
+    int lvlvec[3] = {int(wlev), int(wlev), int(wlev)};
+    if (desc[1] >= 21) for (int d = 0; d < 3; d++) lvlvec[d] = desc[20+d];
+    for (int d = 0; d < 3; d++) if ((desc[1] >= 21) && (lvlvec[d] > WAV_LVL_MAX))
+      {
+        cout << "Error: corrupted transform depth in the encoded data" << endl;
+        throw std::exception();
+      }
+
+    // Order of the coded coefficients
+    unsigned char order = (desc[1] >= 22) ? desc[23] : WAV_ORDER_MALLAT;
+    if ((order != WAV_ORDER_MALLAT) && (order != WAV_ORDER_SUBBAND))
+      {
+        cout << "Error: unknown coefficient order in the encoded data" << endl;
+        throw std::exception();
+      }
+
+    // Low-pass block reconstructed at a reduced resolution. In subband order, its coefficients are the first nuse 
+    // ones of every byte plane, otherwise all coefficients are decoded and the block is taken from the wavelet space. 
+    // The lossless mapping orders the bit patterns of the values, which have no meaningful low-pass average, so the 
+    // field is then reconstructed at full resolution and subsampled
+    int nred[3], lred[3];
+    lowpass_extents(nx,ny,nz,lvlvec,ired,nred,lred);
+    unsigned long int ntot_r = (unsigned long int)(nred[0])*(unsigned long int)(nred[1])*(unsigned long int)(nred[2]);
+    int isub = (imap != INT_MAP_QUANT) && (ntot_r < ntot);
+    int nout[3] = {nred[0], nred[1], nred[2]};
+    if (isub)
+      {
+        nred[0] = nx; nred[1] = ny; nred[2] = nz;
+        for (int d = 0; d < 3; d++) lred[d] = lvlvec[d];
+        ntot_r = ntot;
+      }
+    unsigned long int nuse = (order == WAV_ORDER_SUBBAND) ? ntot_r : ntot;
+
+    // Allocate the integer field and the decoded byte plane
+    unsigned long int *fld_i = new unsigned long int[nuse];
+    unsigned char *dec_q = new unsigned char[ntot];
+    for (unsigned long int j = 0; j < nuse; j++) fld_i[j] = 0;
+
+    // Input vector counter, skip the descriptor
+    unsigned long int jtot = 2UL + desc[1];
+
+    // Assemble the coefficients from the byte planes
+    for (unsigned char ilay = 0; ilay < nlay_dec; ilay++)
+    {
+        unsigned long int len_out_q = len_enc_vec[ilay] - (ilay == 0 ? 2UL + desc[1] : 0UL);
+        range_decode_layer(data_enc+jtot,len_out_q,dec_q,ntot,nuse);
+        jtot += len_out_q;
+        for (unsigned long int j = 0; j < nuse; j++) fld_i[j] = (fld_i[j] << 8) | dec_q[j];
+    }
+
+    // Byte planes that are not decoded are replaced by the middle of their range
+    if (nlay_dec < nlay)
+      {
+        int shift = 8*(nlay-nlay_dec);
+        for (unsigned long int j = 0; j < nuse; j++) fld_i[j] = (fld_i[j] << shift) | (1UL << (shift-1));
+      }
+
+    // Put the coefficients back in wavelet space
+    if ((order == WAV_ORDER_SUBBAND) || (ntot_r < ntot))
+      {
+        unsigned long int *fld_w = new unsigned long int[ntot_r];
+        if (order == WAV_ORDER_SUBBAND)
+          subband_order(nred[0],nred[1],nred[2],lred,fld_w,fld_i,1);
+        else
+          lowpass_block(nx,ny,nred,fld_i,fld_w);
+        delete [] fld_i;
+        fld_i = fld_w;
+      }
+
+    // Restore the offset and apply inverse wavelet transform of the coarse levels, the low-pass filter of the 
+    // integer transform preserves the values
+    for (unsigned long int j = 0; j < ntot_r; j++) fld_i[j] += cmin;
+    waveletcdf53_3d(nred[0],nred[1],nred[2],-lred[0],-lred[1],-lred[2],fld_i);
+
+    // Map the integers back to floating-point values
+    if (imap == INT_MAP_QUANT)
+      for (unsigned long int j = 0; j < ntot_r; j++) fld_1d[j] = T(double(midval) + double((long int)(fld_i[j]))*step);
+    else if (!isub)
+      for (unsigned long int j = 0; j < ntot_r; j++) fld_1d[j] = ord_to_real<T>(fld_i[j]);
+    else
+      {
+        // Keep every (2^r)-th element in each direction reduced by r levels
+        int sh[3];
+        for (int d = 0; d < 3; d++) sh[d] = (ired < lvlvec[d]) ? ired : lvlvec[d];
+        unsigned long int j = 0;
+        for (int iz = 0; iz < nout[2]; iz++)
+          for (int iy = 0; iy < nout[1]; iy++)
+            for (int ix = 0; ix < nout[0]; ix++)
+              fld_1d[j++] = ord_to_real<T>(fld_i[((unsigned long int)(ix) << sh[0]) + (unsigned long int)(nx)*(((unsigned long int)(iy) << sh[1]) + (unsigned long int)(ny)*((unsigned long int)(iz) << sh[2]))]);
+      }
+
+    // Deallocate memory
+    delete [] fld_i;
+    delete [] dec_q;
+}
+
+extern "C" void encoding_wrap_float(int nx, int ny, int nz, float *fld_1d, int wtflag, int mx, int my, int mz, float *cutoffvec, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    encoding_wrap<float>(nx, ny, nz, fld_1d, wtflag, mx, my, mz, cutoffvec, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+}
+
+extern "C" void encoding_wrap_double(int nx, int ny, int nz, double *fld_1d, int wtflag, int mx, int my, int mz, double *cutoffvec, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    encoding_wrap<double>(nx, ny, nz, fld_1d, wtflag, mx, my, mz, cutoffvec, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+}
+
+extern "C" void encoding_wrap_lvl_float(int nx, int ny, int nz, float *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, float *cutoffvec, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    encoding_wrap<float>(nx, ny, nz, fld_1d, wtflag, lvlvec, mx, my, mz, cutoffvec, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+}
+
+extern "C" void encoding_wrap_lvl_double(int nx, int ny, int nz, double *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, double *cutoffvec, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    encoding_wrap<double>(nx, ny, nz, fld_1d, wtflag, lvlvec, mx, my, mz, cutoffvec, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+}
+
+extern "C" void encoding_wrap_opt_float(int nx, int ny, int nz, float *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, float *cutoffvec, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, const enc_options *opts)
+{
+    if (opts && opts->write_enc)
+      encoding_wrap<float>(nx, ny, nz, fld_1d, wtflag, lvlvec, mx, my, mz, cutoffvec, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, opts->ctx_out, opts->write_enc, opts->ibackend);
+    else
+      encoding_wrap<float>(nx, ny, nz, fld_1d, wtflag, lvlvec, mx, my, mz, cutoffvec, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc, opts ? opts->ibackend : ENC_BACKEND);
+}
+
+extern "C" void encoding_wrap_opt_double(int nx, int ny, int nz, double *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, double *cutoffvec, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, const enc_options *opts)
+{
+    if (opts && opts->write_enc)
+      encoding_wrap<double>(nx, ny, nz, fld_1d, wtflag, lvlvec, mx, my, mz, cutoffvec, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, opts->ctx_out, opts->write_enc, opts->ibackend);
+    else
+      encoding_wrap<double>(nx, ny, nz, fld_1d, wtflag, lvlvec, mx, my, mz, cutoffvec, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc, opts ? opts->ibackend : ENC_BACKEND);
+}
+
+extern "C" void decoding_wrap_float(int nx, int ny, int nz, float *fld_1d, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    decoding_wrap<float>(nx, ny, nz, fld_1d, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+}
+extern "C" void decoding_wrap_double(int nx, int ny, int nz, double *fld_1d, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    decoding_wrap<double>(nx, ny, nz, fld_1d, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+}
+
+extern "C" void decoding_layers_float(float tolreq, int nlayreq, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, unsigned char& nlay_dec, unsigned long int& ntot_dec)
+{
+    decoding_layers<float>(tolreq, nlayreq, nlay, ntot_enc, deps_vec, len_enc_vec, data_enc, nlay_dec, ntot_dec);
+}
+extern "C" void decoding_layers_double(double tolreq, int nlayreq, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, unsigned char& nlay_dec, unsigned long int& ntot_dec)
+{
+    decoding_layers<double>(tolreq, nlayreq, nlay, ntot_enc, deps_vec, len_enc_vec, data_enc, nlay_dec, ntot_dec);
+}
+
+extern "C" void decoding_wrap_prog_float(int nx, int ny, int nz, float *fld_1d, float tolreq, int nlayreq, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    decoding_wrap<float>(nx, ny, nz, fld_1d, tolreq, nlayreq, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+}
+extern "C" void decoding_wrap_prog_double(int nx, int ny, int nz, double *fld_1d, double tolreq, int nlayreq, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    decoding_wrap<double>(nx, ny, nz, fld_1d, tolreq, nlayreq, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+}
+
+extern "C" void decoding_wrap_res_float(int nx, int ny, int nz, float *fld_1d, int ired, float tolreq, int nlayreq, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    decoding_wrap<float>(nx, ny, nz, fld_1d, ired, tolreq, nlayreq, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+}
+extern "C" void decoding_wrap_res_double(int nx, int ny, int nz, double *fld_1d, int ired, double tolreq, int nlayreq, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    decoding_wrap<double>(nx, ny, nz, fld_1d, ired, tolreq, nlayreq, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+}
+
+extern "C" void decoding_slice_float(int nx, int ny, int nz, float *fld_s, int sdir, int nslc, int *islc, float tolreq, int nlayreq, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    decoding_slice<float>(nx, ny, nz, fld_s, sdir, nslc, islc, tolreq, nlayreq, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+}
+extern "C" void decoding_slice_double(int nx, int ny, int nz, double *fld_s, int sdir, int nslc, int *islc, double tolreq, int nlayreq, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    decoding_slice<double>(nx, ny, nz, fld_s, sdir, nslc, islc, tolreq, nlayreq, tolabs, midval, halfspanval, wlev, nlay, ntot_enc, deps_vec, minval_vec, len_enc_vec, data_enc);
+}
+
+extern "C" void encoding_wrap_stream_float(int nx, int ny, int nz, int wtflag, float tolrel, unsigned long int membudget, void *ctx_in, void (*read_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, float *fld), void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len), unsigned long int& ntot_enc, int ibackend)
+{
+    encoding_wrap_stream<float>(nx, ny, nz, wtflag, tolrel, membudget, ctx_in, read_fld, ctx_out, write_enc, ntot_enc, ibackend);
+}
+extern "C" void encoding_wrap_stream_double(int nx, int ny, int nz, int wtflag, double tolrel, unsigned long int membudget, void *ctx_in, void (*read_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, double *fld), void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len), unsigned long int& ntot_enc, int ibackend)
+{
+    encoding_wrap_stream<double>(nx, ny, nz, wtflag, tolrel, membudget, ctx_in, read_fld, ctx_out, write_enc, ntot_enc, ibackend);
+}
+
+extern "C" void decoding_wrap_stream_float(int nx, int ny, int nz, void *ctx_in, void (*read_enc)(void *ctx, unsigned char *buf, unsigned long int len), void *ctx_out, void (*write_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, const float *fld))
+{
+    decoding_wrap_stream<float>(nx, ny, nz, ctx_in, read_enc, ctx_out, write_fld);
+}
+extern "C" void decoding_wrap_stream_double(int nx, int ny, int nz, void *ctx_in, void (*read_enc)(void *ctx, unsigned char *buf, unsigned long int len), void *ctx_out, void (*write_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, const double *fld))
+{
+    decoding_wrap_stream<double>(nx, ny, nz, ctx_in, read_enc, ctx_out, write_fld);
+}
+
+extern "C" void encoding_wrap_brick_float(int nx, int ny, int nz, float *fld_1d, int wtflag, int *bvec, float tolrel, float& tolabs, unsigned long int& ntot_enc, unsigned char *data_enc, int ibackend)
+{
+    encoding_wrap_brick<float>(nx, ny, nz, fld_1d, wtflag, bvec, tolrel, tolabs, ntot_enc, data_enc, ibackend);
+}
+extern "C" void encoding_wrap_brick_double(int nx, int ny, int nz, double *fld_1d, int wtflag, int *bvec, double tolrel, double& tolabs, unsigned long int& ntot_enc, unsigned char *data_enc, int ibackend)
+{
+    encoding_wrap_brick<double>(nx, ny, nz, fld_1d, wtflag, bvec, tolrel, tolabs, ntot_enc, data_enc, ibackend);
+}
+
+extern "C" void decoding_region_float(int nx, int ny, int nz, int *rvec, float *fld_r, unsigned long int& ntot_enc, unsigned char *data_enc)
+{
+    decoding_region<float>(nx, ny, nz, rvec, fld_r, ntot_enc, data_enc);
+}
+extern "C" void decoding_region_double(int nx, int ny, int nz, int *rvec, double *fld_r, unsigned long int& ntot_enc, unsigned char *data_enc)
+{
+    decoding_region<double>(nx, ny, nz, rvec, fld_r, ntot_enc, data_enc);
+}
+
+
+/* Encoding subroutine with wavelet transform and range coding */ 
+template <typename T>
+void encoding_wrap(int nx, int ny, int nz, T *fld_1d, int wtflag, int mx, int my, int mz, T *cutoffvec, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    // Wavelet transform depth, hardcoded, see header file
+    int lvlvec[3] = {WAV_LVL, WAV_LVL, WAV_LVL};
+    encoding_wrap(nx,ny,nz,fld_1d,wtflag,lvlvec,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc);
+}
+
+
+/* Quantization and range coding of the wavelet coefficients fld_1d of a field transformed with the depths lvlvec, 
+   with the absolute tolerance tolabs and the local cutoffs cutoffvec, whose minimum is tolrel. The field descriptor 
+   is written if lvldesc is set or the coefficients are coded in subband order. The encoded data is stored in 
+   data_enc if write_enc is NULL, otherwise every piece of it is passed to write_enc as soon as it is ready */ 
+template <typename T>
+static void encoding_coefficients(int nx, int ny, int nz, T *fld_1d, const int *lvlvec, int lvldesc, unsigned char wlev, int mx, int my, int mz, T *cutoffvec, T tolrel, T tolabs, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len), int ibackend)
+{
+    // Total number of elements in the input array
+    unsigned long int ntot = (unsigned long int)(nx)*(unsigned long int)(ny)*(unsigned long int)(nz);
+
+    // Number of elements in the local cutoff array
+    unsigned int mtot = mx*my*mz;
+
+    // Minimum and maximum values
+    T minval, maxval;
+
+    // Arrange the coefficients in subband order, signalled in the field descriptor
+    unsigned char order = ((lvlvec[0] > 0) || (lvlvec[1] > 0) || (lvlvec[2] > 0)) ? WAV_ORDER : WAV_ORDER_MALLAT;
+    if (order == WAV_ORDER_SUBBAND)
+      {
+        T *fld_sb = new T[ntot];
+        subband_order(nx,ny,nz,lvlvec,fld_1d,fld_sb,0);
+        memcpy(fld_1d,fld_sb,ntot*sizeof(T));
+        delete [] fld_sb;
+      }
+    lvldesc |= (order != WAV_ORDER_MALLAT);
+
+    /* Range encoding */
+
+    // Alphabet size
+    int q = 256;
+
+    // Output quantized data array length
+    unsigned long int len_out_q = 0;
+
+    // Output vector counter
+    unsigned long int jtot = 0;
+
+    // Byte layer counter
+    unsigned char ilay = 0;
+
+    // Local precision of every coefficient in wavelet space, only needed if the local precision mask is activated.
+    // It is built once from separable index tables instead of converting the indexes of every element in every bit plane
+    T *prec_w = NULL;
+    if (mtot > 1)
+      {
+        prec_w = new T[ntot];
+        local_precision(nx,ny,nz,lvlvec,int(wlev),mx,my,mz,cutoffvec,tolrel,tolabs,prec_w);
+
+        // Same order as the coefficients
+        if (order == WAV_ORDER_SUBBAND)
+          {
+            T *prec_sb = new T[ntot];
+            subband_order(nx,ny,nz,lvlvec,prec_w,prec_sb,0);
+            delete [] prec_w;
+            prec_w = prec_sb;
+          }
+      }
+
+    // Significance pass of the dead-zone quantizer, which needs the subband order. Only the significant coefficients 
+    // are coded in the bit planes, moved to the beginning of the field
+    unsigned long int ncod = ntot;
+    unsigned long int lsmap = 0;
+    unsigned char *smap = NULL;
+    if ((order == WAV_ORDER_SUBBAND) && (DEAD_ZONE > 0))
+      ncod = significance_pass(nx,ny,nz,lvlvec,fld_1d,prec_w,tolabs,smap,lsmap,ibackend);
+
+    // Allocate the quantized vector. It is double-buffered, such that one bit plane can be range encoded while the 
+    // next one is being quantized. The encoded bit planes are written directly into the output array, or into a 
+    // scratch array passed to the sink. The range encoder reads one element past the end of its input
+    unsigned char *fld_q[2];
+    fld_q[0] = new unsigned char[ncod+1UL];
+    fld_q[1] = new unsigned char[ncod+1UL];
+    fld_q[0][ncod] = 0;
+    fld_q[1][ncod] = 0;
+    unsigned long int jmax = write_enc ? rc_layer_len(ncod) : enc_len_max(ntot);
+    unsigned char *lay_enc = write_enc ? new unsigned char[jmax] : NULL;
+
+    // Number of independently coded chunks in a bit plane and their encoded lengths
+    long int nchunk = long(rc_nchunk(ncod));
+    unsigned long int *clen = new unsigned long int[rc_nchunk(ncod)];
+    int overflow = 0;
+
+    // Field descriptor with the transform depths, the coefficient order and the length of the significance map, 
+    // stored with the map in front of the first bit plane
+    unsigned char desc[16];
+    if (lvldesc)
+      {
+        desc[0] = ENC_FIELD_DESC;
+        desc[1] = 14;
+        desc[2] = WAV_TYPE_CDF97;
+        for (int d = 0; d < 3; d++) desc[3+d] = (unsigned char)(lvlvec[d]);
+        desc[6] = order;
+        desc[7] = (smap != NULL);
+        put_u64(desc+8,lsmap);
+        emit_enc(desc,sizeof(desc),data_enc,jtot,ctx_out,write_enc);
+      }
+    if (smap) emit_enc(smap,lsmap,data_enc,jtot,ctx_out,write_enc);
+    unsigned long int lhead = jtot;
+
+    // Iteration break flag set to false by default
+    unsigned char brflag = 0;
+
+    // Min and max of the coded wavelet coefficients, those of the residuals are returned by the quantization kernel
+    layer_bounds(fld_1d,ncod,minval,maxval);
+
+    // Number of quantized byte layers, ilay counts the encoded ones
+    unsigned char nq = 0;
+
+    // Quantize and encode all byte layers. Range encoding of a layer runs concurrently with the quantization of 
+    // the next one, the output is the same as if they were executed one after the other
+    while (1)
+    {
+        // A new layer is quantized unless the last one is already reached
+        unsigned char qflag = !brflag;
+        T deps = 0, aopt = 0, bopt = 0;
+        if (qflag)
+          {
+            // Store the minimum value
+            minval_vec[nq] = minval;
+
+            // Quantize for a q-letter alphabet
+            deps = (maxval-minval)/(T)(q-1);
+
+            // Impose the desired accuracy of the least significant bit plane
+            if (deps < tolabs) 
+            {
+              deps = tolabs;
+              brflag = 1;
+            }
+
+            // Termnate if maximum bit plane is reached
+            if (nq >= NLAYMAX-1U) brflag = 1;
+
+            // Save the quantization interval size
+            deps_vec[nq] = deps;
+
+            // Combinations of minval and deps, for optimization
+            aopt = 1.0/deps;
+            bopt = -minval*aopt+0.5;
+          }
+
+        // Output of the encoded layer
+        unsigned char *enc_q = write_enc ? lay_enc : data_enc+jtot;
+        unsigned long int len_max = write_enc ? jmax : jmax-jtot;
+
+        // Two-stage pipeline: one thread quantizes the next layer while the others encode the chunks of the previous 
+        // one. Only run in parallel when there is more than one task
+        #pragma omp parallel if((ilay < nq) && (qflag || nchunk > 1))
+        {
+          // Quantize, replace the field with the residual and find its min and max for the next bit plane, all in 
+          // one sweep. The local precision mask is only passed if activated
+          #pragma omp single nowait
+          if (qflag) quantize_layer(fld_1d,fld_q[nq%2],prec_w,ncod,maxval-minval,aopt,bopt,deps,minval,minval,maxval);
+
+          // Encode the previously quantized layer
+          if (ilay < nq)
+            {
+              #pragma omp for schedule(dynamic,1) reduction(|:overflow)
+              for (long int ic = 0; ic < nchunk; ic++) overflow |= range_encode_chunk(fld_q[ilay%2],ncod,ic,enc_q,len_max,clen,ibackend);
+            }
+        }
+
+        // Store the encoded data
+        if (ilay < nq)
+          {
+            // Check for overflow
+            if (overflow)
+              {
+                cout << "Error: encoded array is too large. Use larger SAFETY_BUFFER_FACTOR" << endl;
+                throw std::exception();
+              }
+            range_encode_pack(ncod,enc_q,len_max,clen,len_out_q);
+            len_enc_vec[ilay] = len_out_q + (ilay == 0 ? lhead : 0);
+            emit_enc(enc_q,len_out_q,data_enc,jtot,ctx_out,write_enc);
+
+            // Update encoded layer index
+            ilay ++;
+          }
+
+        // Stop when the required tolerance is reached for all samples and the last layer is encoded
+        if ( qflag ) 
+          nq ++;
+        else
+          break;
+    }
+
+    // Number of byte layers
+    nlay = ilay;
+
+    // Total encoded data array length
+    ntot_enc = jtot;
+
+    // Deallocate memory
+    delete [] fld_q[0];
+    delete [] fld_q[1];
+    delete [] clen;
+    if (lay_enc) delete [] lay_enc;
+    if (prec_w) delete [] prec_w;
+    if (smap) delete [] smap;
+}
+
+
+/* Encoding with wavelet transform and range coding. The encoded data is stored in data_enc if write_enc is NULL, 
+   otherwise every piece of it is passed to write_enc as soon as it is ready and data_enc is not used */ 
+template <typename T>
+static void encoding_wrap_out(int nx, int ny, int nz, T *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, T *cutoffvec, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len), int ibackend)
+{
+    /* Wavelet decomposition */
+
+    // Total number of elements in the input array
+    unsigned long int ntot = (unsigned long int)(nx)*(unsigned long int)(ny)*(unsigned long int)(nz);
+
+    // Number of elements in the local cutoff array
+    unsigned int mtot = mx*my*mz;
+
+    // Entropy coding backend
+    check_backend(ibackend);
+
+    // Wavelet transform depth in each direction, chosen automatically where requested; zero if no transform required
+    if (wtflag) 
+      {
+        if ((lvlvec[0] == WAV_LVL_AUTO) || (lvlvec[1] == WAV_LVL_AUTO) || (lvlvec[2] == WAV_LVL_AUTO))
+          {
+            int lvlauto[3];
+            waveletcdf97_3d_levels(nx,ny,nz,fld_1d,lvlauto);
+            for (int d = 0; d < 3; d++) if (lvlvec[d] == WAV_LVL_AUTO) lvlvec[d] = lvlauto[d];
+          }
+        for (int d = 0; d < 3; d++) if ((lvlvec[d] < 0) || (lvlvec[d] > WAV_LVL_MAX))
+          {
+            cout << "Error: wavelet transform depth must be between 0 and " << WAV_LVL_MAX << endl;
+            throw std::exception();
+          }
+      }
+    else 
+      for (int d = 0; d < 3; d++) lvlvec[d] = 0;
+
+    // The largest depth is reported, the depths are stored in a field descriptor if they differ
+    wlev = (unsigned char)(lvlvec[0]);
+    if (lvlvec[1] > wlev) wlev = (unsigned char)(lvlvec[1]);
+    if (lvlvec[2] > wlev) wlev = (unsigned char)(lvlvec[2]);
+    int lvldesc = (lvlvec[0] != lvlvec[1]) || (lvlvec[0] != lvlvec[2]);
+
+    // Find the minimum and maximum values
+    T minval, maxval;
+    layer_bounds(fld_1d,ntot,minval,maxval);
+
+    // Find the middle value and the half-span of the data values
+    halfspanval = (maxval-minval)/2;
+    midval = minval+halfspanval;
+
+    // The reversible integer transform is coded separately, also for trivial data since it must be exact
+    if (wtflag == WAV_TYPE_CDF53)
+      {
+        T tolrel = cutoffvec[0];
+        for (unsigned int k=1; k<mtot; k++) if (cutoffvec[k] < tolrel) tolrel = cutoffvec[k];
+        encoding_cdf53(nx,ny,nz,fld_1d,tolrel,minval,maxval,midval,tolabs,lvlvec,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc,ctx_out,write_enc,ibackend);
+        return;
+      }
+
+    // If the half-span is close to zero, encoding is impossible and unnecessary
+    if (halfspanval <= 2*DBL_MIN)
+      {
+        // Encoded data array is empty and not used
+        ntot_enc = 0;
+        nlay = 0;
+        tolabs = 0;
+
+        // Exit from the subroutine
+        return;
+      }
+
+    // Minimum cutoff
+    T tolrel = cutoffvec[0];
+    for (unsigned int k=1; k<mtot; k++) if (cutoffvec[k] < tolrel) tolrel = cutoffvec[k];
+
+    // Absolute tolerance
+    tolabs = tolrel * fmax(fabs(minval),fabs(maxval));
+
+    // Apply a correction for round-off errors in wavelet transform
+    tolabs /= WAV_ACC_COEF;
+
+    // Apply wavelet transform
+    waveletcdf97_3d<T>(nx,ny,nz,lvlvec[0],lvlvec[1],lvlvec[2],fld_1d);
+
+    // Quantize and encode the wavelet coefficients
+    encoding_coefficients(nx,ny,nz,fld_1d,lvlvec,lvldesc,wlev,mx,my,mz,cutoffvec,tolrel,tolabs,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc,ctx_out,write_enc,ibackend);
+}
+
+
+/* Encoding subroutine with wavelet transform and range coding, with a separate transform depth in each direction */ 
+template <typename T>
+void encoding_wrap(int nx, int ny, int nz, T *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, T *cutoffvec, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    encoding_wrap_out(nx,ny,nz,fld_1d,wtflag,lvlvec,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc,NULL,NULL,ENC_BACKEND);
+}
+
+
+/* Encoding subroutine with wavelet transform and the entropy coding backend ibackend */ 
+template <typename T>
+void encoding_wrap(int nx, int ny, int nz, T *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, T *cutoffvec, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, int ibackend)
+{
+    encoding_wrap_out(nx,ny,nz,fld_1d,wtflag,lvlvec,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc,NULL,NULL,ibackend);
+}
+
+
+/* Encoding subroutine with wavelet transform and range coding, the encoded data is passed to a sink */ 
+template <typename T>
+void encoding_wrap(int nx, int ny, int nz, T *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, T *cutoffvec, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len))
+{
+    encoding_wrap_out(nx,ny,nz,fld_1d,wtflag,lvlvec,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,NULL,ctx_out,write_enc,ENC_BACKEND);
+}
+
+
+/* Encoding subroutine with wavelet transform and the entropy coding backend ibackend, the encoded data is passed to 
+   a sink */ 
+template <typename T>
+void encoding_wrap(int nx, int ny, int nz, T *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, T *cutoffvec, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len), int ibackend)
+{
+    encoding_wrap_out(nx,ny,nz,fld_1d,wtflag,lvlvec,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,NULL,ctx_out,write_enc,ibackend);
+}
+
+
+/* Decoding of the first nlay_dec of the nlay bit planes with range decoding and inverse wavelet transform, data_enc 
+   only needs to hold their encoded data. The field is reconstructed at the resolution reduced by the ired finest 
+   levels, fld_1d then holds the low-pass block with the extents given by lowpass_extents. If wspace is set, the 
+   inverse wavelet transform is skipped and fld_1d holds the wavelet coefficients */
+template <typename T>
+static void decoding_prefix(int nx, int ny, int nz, T *fld_1d, T midval, unsigned char wlev, unsigned char nlay, unsigned char nlay_dec, int ired, int sdir, int nslc, const int *islc, int wspace, unsigned long int ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    // Total number of elements
+    unsigned long int ntot = (unsigned long int)(nx)*(unsigned long int)(ny)*(unsigned long int)(nz);
+
+    // Case of trivial data
+    if (ntot_enc == 0)
+      {
+        // Reconstruct
+        int lvlvec[3], nred[3], lred[3];
+        stored_levels(wlev,ntot_enc,data_enc,lvlvec);
+        lowpass_extents(nx,ny,nz,lvlvec,ired,nred,lred);
+        unsigned long int ntot_r = (unsigned long int)(nred[0])*(unsigned long int)(nred[1])*(unsigned long int)(nred[2]);
+        for(unsigned long int j = 0; j < ntot_r; j++) fld_1d[j] = midval;
+
+        // Exit 
+        return;
+      }
+
+    // Transform depth in each direction, the same in all directions unless stored in a field descriptor
+    int lvlvec[3] = {int(wlev), int(wlev), int(wlev)};
+
+    // Length of the field descriptor
+    unsigned long int ldesc = 0;
+
+    // Order of the coded coefficients, as stored by the transform unless given in the field descriptor
+    unsigned char order = WAV_ORDER_MALLAT;
+
+    // Significance map of the dead-zone quantizer, if stored after the field descriptor
+    unsigned char *smap = NULL;
+    unsigned long int lsmap = 0;
+
+    // Encoded data that start with a field descriptor
+    if (data_enc[0] & ENC_FIELD_DESC)
+      {
+        if (data_enc[2] == WAV_TYPE_CDF53)
+          {
+            decoding_cdf53(nx,ny,nz,fld_1d,midval,wlev,nlay,nlay_dec,ired,data_enc,len_enc_vec,data_enc);
+            return;
+          }
+        else if (data_enc[2] == WAV_TYPE_CDF97)
+          {
+            for (int d = 0; d < 3; d++) lvlvec[d] = data_enc[3+d];
+            if (data_enc[1] >= 5) order = data_enc[6];
+            ldesc = 2UL + data_enc[1];
+            if ((data_enc[1] >= 14) && data_enc[7])
+              {
+                smap = data_enc+ldesc;
+                lsmap = get_u64(data_enc+8);
+              }
+            if ((data_enc[1] >= 15) && data_enc[16])
+              {
+                cout << "Error: bit planes per subband in the encoded data are not supported" << endl;
+                throw std::exception();
+              }
+            if ((order != WAV_ORDER_MALLAT) && (order != WAV_ORDER_SUBBAND))
+              {
+                cout << "Error: unknown coefficient order in the encoded data" << endl;
+                throw std::exception();
+              }
+            for (int d = 0; d < 3; d++) if (lvlvec[d] > WAV_LVL_MAX)
+              {
+                cout << "Error: corrupted transform depth in the encoded data" << endl;
+                throw std::exception();
+              }
+          }
+        else
+          {
+            cout << "Error: unknown field descriptor in the encoded data" << endl;
+            throw std::exception();
+          }
+      }
+
+    // Number of coded coefficients, only the significant ones if there is a significance map, and those of every 
+    // subband
+    unsigned long int ncod = ntot;
+    unsigned long int coff[2+7*WAV_LVL_MAX];
+    coff[0] = 0;
+    coff[1] = ntot;
+    if (order == WAV_ORDER_SUBBAND) subband_offsets(nx,ny,nz,lvlvec,coff);
+    unsigned char *sbits = NULL;
+    if (smap)
+      {
+        if ((nlay_dec == 0) || (ldesc > len_enc_vec[0]) || (lsmap > len_enc_vec[0]-ldesc))
+          {
+            cout << "Error: corrupted significance map in the encoded data" << endl;
+            throw std::exception();
+          }
+        ncod = significance_decode(nx,ny,nz,lvlvec,smap,lsmap,sbits,coff);
+        ldesc += lsmap;
+      }
+
+    // Low-pass block reconstructed at a reduced resolution. In subband order, its coefficients are the first ncod_r 
+    // coded ones, otherwise all coefficients are decoded and the block is taken from the wavelet space
+    int nred[3], lred[3];
+    int nscl = lowpass_extents(nx,ny,nz,lvlvec,ired,nred,lred);
+    unsigned long int ntot_r = (unsigned long int)(nred[0])*(unsigned long int)(nred[1])*(unsigned long int)(nred[2]);
+    unsigned long int ncod_r = ncod;
+    if ((order == WAV_ORDER_SUBBAND) && (ntot_r < ntot))
+      {
+        unsigned long int soff_r[2+7*WAV_LVL_MAX];
+        ncod_r = coff[subband_offsets(nred[0],nred[1],nred[2],lred,soff_r)];
+      }
+
+    /* Range decoding */
+
+    // Start of every layer in the encoded data, skipping the field descriptor and the significance map
+    unsigned long int *joff = new unsigned long int[nlay_dec+1];
+    joff[0] = ldesc;
+    for (unsigned char ilay = 0; ilay < nlay_dec; ilay++)
+      joff[ilay+1] = joff[ilay] + len_enc_vec[ilay] - (ilay == 0 ? ldesc : 0UL);
+
+    // Chunks of all layers, in the encoded data and in the decoded byte planes. Only the chunks that hold the first 
+    // ncod_r symbols, those of the reconstructed coefficients, are decoded, which skips the fine subbands at a 
+    // reduced resolution. The decoded part of the bit plane of a layer starts at dbas in dec_q
+    unsigned long int ntask = 0;
+    for (unsigned char ilay = 0; ilay < nlay_dec; ilay++)
+      ntask += range_decode_table(data_enc+joff[ilay],joff[ilay+1]-joff[ilay],ncod,NULL,NULL,NULL,NULL);
+    unsigned long int *eoff = new unsigned long int[4*ntask];
+    unsigned long int *elen = eoff+ntask, *doff = eoff+2*ntask, *dlen = eoff+3*ntask;
+    unsigned long int *dbas = new unsigned long int[nlay_dec+1];
+    unsigned long int itask = 0;
+    dbas[0] = 0;
+    for (unsigned char ilay = 0; ilay < nlay_dec; ilay++)
+      {
+        unsigned long int nchunk = range_decode_table(data_enc+joff[ilay],joff[ilay+1]-joff[ilay],ncod,eoff+itask,elen+itask,doff+itask,dlen+itask);
+        unsigned long int dend = 0, jtask = itask;
+        for (unsigned long int ic = itask; ic < itask+nchunk; ic++) if (doff[ic] < ncod_r)
+          {
+            if (doff[ic]+dlen[ic] > dend) dend = doff[ic]+dlen[ic];
+            eoff[jtask] = eoff[ic] + joff[ilay];
+            elen[jtask] = elen[ic];
+            doff[jtask] = doff[ic] + dbas[ilay];
+            dlen[jtask] = dlen[ic];
+            jtask++;
+          }
+        dbas[ilay+1] = dbas[ilay] + dend;
+        itask = jtask;
+      }
+    ntask = itask;
 
-    /* Range decoding */
+    // Allocate the decoded part of the byte planes of all layers
+    unsigned char *dec_q = new unsigned char[dbas[nlay_dec]];
 
-    // Allocate the quantized input and output vectors
-    unsigned char *dec_q = new unsigned char[ntot];
-    unsigned char *enc_q = new unsigned char[(SAFETY_BUFFER_FACTOR+1UL)*(ntot<1024UL?1024UL:ntot)]; // Encoded array may be longer than the original
+    // The layers and their chunks are coded independently, decode them concurrently
+    int overflow = 0;
+    #pragma omp parallel for schedule(dynamic,1) reduction(|:overflow)
+    for (long int ic = 0; ic < long(ntask); ic++)
+      overflow |= entropy_decode(data_enc+eoff[ic],elen[ic],dec_q+doff[ic],dlen[ic]);
+    if (overflow)
+      {
+        cout << "Error: corrupted range-coded data" << endl;
+        delete [] joff;
+        delete [] eoff;
+        delete [] dbas;
+        delete [] dec_q;
+        if (sbits) delete [] sbits;
+        throw std::exception();
+      }
+
+    // Cumulative field, reconstructed in cache-sized blocks with all layers accumulated in the same order as they 
+    // were coded. Coefficients in subband order are accumulated separately and put back in wavelet space, the 
+    // significant ones are first expanded to all coefficients. At a reduced resolution, only the coefficients of the 
+    // low-pass block are accumulated, in storage order the full wavelet space is decoded
+    int isub = (order == WAV_ORDER_SUBBAND);
+    int nsub[3] = {nx, ny, nz};
+    if (isub) for (int d = 0; d < 3; d++) nsub[d] = nred[d];
+    const int *lsub = isub ? lred : lvlvec;
+    T *fld_c = (isub || (ntot_r < ntot)) ? new T[isub ? ntot_r : ntot] : fld_1d;
+    T *fld_s = smap ? new T[ncod_r] : fld_c;
+    const unsigned long int nblk = 4096;
+    #pragma omp parallel for schedule(static)
+    for (long int jb = 0; jb < long(ncod_r); jb += nblk)
+      {
+        unsigned long int nj = (ncod_r-jb < nblk) ? ncod_r-jb : nblk;
+        for (unsigned long int j = 0; j < nj; j++) fld_s[jb+j] = 0;
+        for (unsigned char ilay = 0; ilay < nlay_dec; ilay++)
+          accumulate_layer(fld_s+jb,dec_q+dbas[ilay]+jb,nj,deps_vec[ilay],minval_vec[ilay]);
+      }
+    if (smap)
+      {
+        significance_expand(nsub[0],nsub[1],nsub[2],lsub,smap,sbits,fld_s,fld_c);
+        delete [] fld_s;
+        delete [] sbits;
+      }
+    if (isub)
+      subband_order(nred[0],nred[1],nred[2],lred,fld_1d,fld_c,1);
+    else if (ntot_r < ntot)
+      lowpass_block(nx,ny,nred,fld_c,fld_1d);
+    if (fld_c != fld_1d) delete [] fld_c;
+
+    // Deallocate memory
+    delete [] joff;
+    delete [] eoff;
+    delete [] dbas;
+    delete [] dec_q;
+
+    // Coefficients requested in wavelet space
+    if (wspace) return;
+
+    /* Wavelet reconstruction */
+
+    // Inverse wavelet transform of the coarse levels if the data is non-trivial, the low-pass block is scaled back 
+    // to the field values. If only planes normal to the direction sdir are requested, only they are reconstructed
+    if (nslc > 0)
+      waveletcdf97_3d_slices(nx,ny,nz,lvlvec[0],lvlvec[1],lvlvec[2],sdir,nslc,islc,fld_1d);
+    else
+      waveletcdf97_3d(nred[0],nred[1],nred[2],-lred[0],-lred[1],-lred[2],fld_1d);
+    if (nscl > 0)
+      {
+        T scl = T(pow(0.5,0.5*nscl));
+        for (unsigned long int j = 0; j < ntot_r; j++) fld_1d[j] *= scl;
+      }
+}
+
+
+/* Decoding subroutine with range decoding and inverse wavelet transform*/
+template <typename T>
+void decoding_wrap(int nx, int ny, int nz, T *fld_1d, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    decoding_prefix(nx,ny,nz,fld_1d,midval,wlev,nlay,nlay,0,0,0,NULL,0,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc);
+}
+
+
+/* Number of bit planes to decode for a requested tolerance or number of bit planes, and the length of their encoded 
+   data */
+template <typename T>
+void decoding_layers(T tolreq, int nlayreq, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, unsigned char& nlay_dec, unsigned long int& ntot_dec)
+{
+    // All bit planes by default
+    nlay_dec = nlay;
+    ntot_dec = ntot_enc;
+
+    // Case of trivial data
+    if (ntot_enc == 0) return;
+
+    // The integers of the exact mapping of the integer transform are the bit patterns of the reals, which are only 
+    // meaningful with all byte planes
+    int icdf53 = (data_enc[0] & ENC_FIELD_DESC) && (data_enc[2] == WAV_TYPE_CDF53);
+    if (icdf53 && (data_enc[3] != INT_MAP_QUANT)) return;
+
+    // Requested number of bit planes
+    if (nlayreq > 0)
+      {
+        if (nlayreq < int(nlay)) nlay_dec = (unsigned char)(nlayreq);
+      }
+
+    // Fewest bit planes that reach the requested tolerance. The wavelet coefficients are known within the 
+    // quantization interval of the last decoded bit plane, which is the tolerance for the last one. With the integer 
+    // transform, the missing byte planes are replaced by the middle of their range, which is exact within half their 
+    // weight times the integer quantization step, and the error grows by up to INT_TRUNC_GAIN in the inverse transform
+    else if (tolreq > 0)
+      {
+        double step = 0;
+        if (icdf53)
+          {
+            unsigned long int step_bits = get_u64(data_enc+12);
+            memcpy(&step,&step_bits,8);
+          }
+        for (unsigned char ilay = 0; ilay+1 < nlay; ilay++)
+          {
+            double err = icdf53 ? INT_TRUNC_GAIN*step*double(deps_vec[ilay])/2 : double(deps_vec[ilay]);
+            if ((err > 0) && (err <= double(tolreq)))
+              {
+                nlay_dec = ilay+1;
+                break;
+              }
+          }
+      }
+
+    // Length of the encoded data of the decoded bit planes
+    ntot_dec = 0;
+    for (unsigned char ilay = 0; ilay < nlay_dec; ilay++) ntot_dec += len_enc_vec[ilay];
+}
+
+
+/* Decoding subroutine that reconstructs the field from the first bit planes only */
+template <typename T>
+void decoding_wrap(int nx, int ny, int nz, T *fld_1d, T tolreq, int nlayreq, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    decoding_wrap(nx,ny,nz,fld_1d,0,tolreq,nlayreq,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc);
+}
+
+
+/* Decoding subroutine that reconstructs the field at a reduced resolution from the first bit planes */
+template <typename T>
+void decoding_wrap(int nx, int ny, int nz, T *fld_1d, int ired, T tolreq, int nlayreq, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    unsigned char nlay_dec;
+    unsigned long int ntot_dec;
+    decoding_layers(tolreq,nlayreq,nlay,ntot_enc,deps_vec,len_enc_vec,data_enc,nlay_dec,ntot_dec);
+    decoding_prefix(nx,ny,nz,fld_1d,midval,wlev,nlay,nlay_dec,ired,0,0,NULL,0,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc);
+}
+
+
+/* Decoding subroutine that reconstructs a few planes normal to one direction from the first bit planes */
+template <typename T>
+void decoding_slice(int nx, int ny, int nz, T *fld_s, int sdir, int nslc, int *islc, T tolreq, int nlayreq, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc)
+{
+    // Extents of the field
+    int nvec[3] = {nx, ny, nz};
+
+    // Check the direction and the indexes of the planes
+    if ((sdir < 1) || (sdir > 3) || (nslc < 1))
+      {
+        cout << "Error: invalid slice direction or number of slices" << endl;
+        throw std::exception();
+      }
+    for (int s = 0; s < nslc; s++) if ((islc[s] < 0) || (islc[s] >= nvec[sdir-1]))
+      {
+        cout << "Error: slice index out of range" << endl;
+        throw std::exception();
+      }
+
+    // Bit planes to decode
+    unsigned char nlay_dec;
+    unsigned long int ntot_dec;
+    decoding_layers(tolreq,nlayreq,nlay,ntot_enc,deps_vec,len_enc_vec,data_enc,nlay_dec,ntot_dec);
+
+    // All wavelet coefficients are decoded, but only the planes and their dependency cone are inverse transformed
+    unsigned long int ntot = (unsigned long int)(nx)*(unsigned long int)(ny)*(unsigned long int)(nz);
+    T *fld_1d = new T[ntot];
+    decoding_prefix(nx,ny,nz,fld_1d,midval,wlev,nlay,nlay_dec,0,sdir,nslc,islc,0,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc);
+
+    // Gather the planes in the order of islc
+    nvec[sdir-1] = nslc;
+    unsigned long int j = 0;
+    for (int iz = 0; iz < nvec[2]; iz++)
+      for (int iy = 0; iy < nvec[1]; iy++)
+        for (int ix = 0; ix < nvec[0]; ix++)
+          {
+            int ivec[3] = {ix, iy, iz};
+            ivec[sdir-1] = islc[ivec[sdir-1]];
+            fld_s[j++] = fld_1d[(unsigned long int)(ivec[0]) + (unsigned long int)(nx)*((unsigned long int)(ivec[1]) + (unsigned long int)(ny)*(unsigned long int)(ivec[2]))];
+          }
+
+    // Deallocate memory
+    delete [] fld_1d;
+}
+
+template void encoding_wrap<float>(int nx, int ny, int nz, float *fld_1d, int wtflag, int mx, int my, int mz, float *cutoffvec, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+template void encoding_wrap<double>(int nx, int ny, int nz, double *fld_1d, int wtflag, int mx, int my, int mz, double *cutoffvec, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+template void encoding_wrap<float>(int nx, int ny, int nz, float *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, float *cutoffvec, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+template void encoding_wrap<float>(int nx, int ny, int nz, float *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, float *cutoffvec, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, int ibackend);
+template void encoding_wrap<double>(int nx, int ny, int nz, double *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, double *cutoffvec, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+template void encoding_wrap<double>(int nx, int ny, int nz, double *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, double *cutoffvec, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, int ibackend);
+template void encoding_wrap<float>(int nx, int ny, int nz, float *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, float *cutoffvec, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len));
+template void encoding_wrap<float>(int nx, int ny, int nz, float *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, float *cutoffvec, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len), int ibackend);
+template void encoding_wrap<double>(int nx, int ny, int nz, double *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, double *cutoffvec, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len));
+template void encoding_wrap<double>(int nx, int ny, int nz, double *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, double *cutoffvec, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len), int ibackend);
+template void decoding_wrap<float>(int nx, int ny, int nz, float *fld_1d, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+template void decoding_wrap<double>(int nx, int ny, int nz, double *fld_1d, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+template void decoding_layers<float>(float tolreq, int nlayreq, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, unsigned char& nlay_dec, unsigned long int& ntot_dec);
+template void decoding_layers<double>(double tolreq, int nlayreq, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, unsigned char& nlay_dec, unsigned long int& ntot_dec);
+template void decoding_wrap<float>(int nx, int ny, int nz, float *fld_1d, float tolreq, int nlayreq, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+template void decoding_wrap<double>(int nx, int ny, int nz, double *fld_1d, double tolreq, int nlayreq, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+template void decoding_wrap<float>(int nx, int ny, int nz, float *fld_1d, int ired, float tolreq, int nlayreq, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+template void decoding_wrap<double>(int nx, int ny, int nz, double *fld_1d, int ired, double tolreq, int nlayreq, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+template void decoding_slice<float>(int nx, int ny, int nz, float *fld_s, int sdir, int nslc, int *islc, float tolreq, int nlayreq, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+template void decoding_slice<double>(int nx, int ny, int nz, double *fld_s, int sdir, int nslc, int *islc, double tolreq, int nlayreq, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+
+
+/* Number of planes of the field whose coefficients are coded together in a block by the streaming encoder, such that 
+   its working memory fits in the budget */
+template <typename T>
+static unsigned long int stream_block_planes(int nx, int ny, int nz, unsigned long int membudget)
+{
+    // Bytes per element of the planes in a block: the rows gathered at all levels, the block being coded, its copy 
+    // in subband order, double-buffered quantized layer and the encoded bit plane handed to the sink
+    unsigned long int nbytes = 3UL*sizeof(T) + 2UL + (SAFETY_BUFFER_FACTOR+1UL);
+
+    // The sliding windows of the transform take up to 15 planes
+    unsigned long int nxy = (unsigned long int)(nx)*(unsigned long int)(ny);
+    unsigned long int lwin = 15UL*sizeof(T)*nxy;
+
+    // Number of planes, at least one and not more than the field
+    unsigned long int nzb = (membudget > lwin) ? (membudget-lwin) / (nbytes*nxy) : 0UL;
+    if (nzb < 1UL) nzb = 1UL;
+    if (nzb > (unsigned long int)(nz)) nzb = (unsigned long int)(nz);
+    return nzb;
+}
+
+/* Sink of the streaming encoder. The encoded data of a block is passed on as it is produced, every piece preceded by 
+   its length; the block parameters follow a zero length */
+struct stream_sink
+{
+    void *ctx_out;
+    void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len);
+    unsigned long int ntot_enc;
+};
+static void stream_write(void *ctx, const unsigned char *buf, unsigned long int len)
+{
+    stream_sink *s = (stream_sink*)ctx;
+    if (len == 0) return;
+    unsigned char head[8];
+    put_u64(head,len);
+    s->write_enc(s->ctx_out,head,8);
+    s->write_enc(s->ctx_out,buf,len);
+    s->ntot_enc += 8UL + len;
+}
+
+/* State of the streaming encoder. The rows of every level k of the streamed transform are gathered in blocks of up 
+   to nrow[k] low-pass rows and the high-pass rows of the same index, and every block is coded as soon as it is 
+   complete. The running maximum absolute value of the planes read so far gives the absolute tolerance */
+template <typename T>
+struct stream_enc
+{
+    void *ctx_in;
+    void (*read_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, T *fld);
+    unsigned long int nxy;
+    T maxabs;
+    T tolrel;
+    int ibackend;
+    int nlev;
+    unsigned long int ext[6*WAV_LVL_MAX];
+    unsigned long int nrow[WAV_LVL_MAX], nl[WAV_LVL_MAX], nh[WAV_LVL_MAX];
+    T *low[WAV_LVL_MAX], *high[WAV_LVL_MAX];
+    T *fld_b;
+    stream_sink sink;
+};
+
+/* Read plane i3 of the field for the streamed transform */
+template <typename T>
+static void stream_read_plane(void *ctx, unsigned long int i3, T *plane)
+{
+    stream_enc<T> *e = (stream_enc<T>*)ctx;
+    e->read_fld(e->ctx_in, i3*e->nxy, e->nxy, plane);
+    T vmax = e->maxabs;
+    for (unsigned long int j = 0; j < e->nxy; j++) vmax = fmax(vmax,fabs(plane[j]));
+    e->maxabs = vmax;
+}
+
+/* Code the block of level k gathered so far: a head with the level and the numbers of low-pass and high-pass rows, 
+   the encoded coefficients, and the block parameters. The block is coded as a field of nl+nh planes with the 
+   low-pass rows first, transformed to depth one along the directions transformed at level k, which matches the 
+   order of its coefficients in wavelet space */
+template <typename T>
+static void stream_code_block(stream_enc<T> *e, int k)
+{
+    const unsigned long int *ext = e->ext+6*k;
+    unsigned long int nxyk = ext[0]*ext[1];
+    unsigned long int nl = e->nl[k], nh = e->nh[k];
+
+    // Block head
+    unsigned char head[24];
+    put_u64(head, (unsigned long int)(k+1));
+    put_u64(head+8, nl);
+    put_u64(head+16, nh);
+    e->sink.write_enc(e->sink.ctx_out, head, sizeof(head));
+    e->sink.ntot_enc += sizeof(head);
+
+    // Coefficients of the block in wavelet space
+    memcpy(e->fld_b, e->low[k], nl*nxyk*sizeof(T));
+    memcpy(e->fld_b+nl*nxyk, e->high[k], nh*nxyk*sizeof(T));
+    unsigned long int ntot = (nl+nh)*nxyk;
+    int lvlvec[3] = {int(ext[3]), int(ext[4]), int(ext[5]) && (nl+nh > 1UL)};
+
+    // Encode the block with the absolute tolerance of the planes read so far, unless it is constant
+    T minval, maxval;
+    layer_bounds(e->fld_b, ntot, minval, maxval);
+    T halfspanval = (maxval-minval)/2;
+    T midval = minval+halfspanval;
+    T tolabs = e->tolrel * e->maxabs / WAV_ACC_COEF;
+    unsigned char wlev = (unsigned char)((lvlvec[0] > lvlvec[1]) ? lvlvec[0] : lvlvec[1]);
+    if (lvlvec[2] > wlev) wlev = (unsigned char)(lvlvec[2]);
+    unsigned char nlay = 0;
+    unsigned long int ntot_enc_blk = 0;
+    T deps_vec[NLAYMAX], minval_vec[NLAYMAX];
+    unsigned long int len_enc_vec[NLAYMAX];
+    if (halfspanval > 2*DBL_MIN)
+      {
+        int lvldesc = (lvlvec[0] != lvlvec[1]) || (lvlvec[0] != lvlvec[2]);
+        encoding_coefficients(int(ext[0]), int(ext[1]), int(nl+nh), e->fld_b, lvlvec, lvldesc, wlev, 1, 1, 1, &e->tolrel, e->tolrel, tolabs, nlay, ntot_enc_blk, deps_vec, minval_vec, len_enc_vec, (unsigned char*)(NULL), &e->sink, stream_write, e->ibackend);
+      }
 
-    // Cumulative field
-    for(unsigned long int j = 0; j < ntot; j++) fld_1d[j] = 0;
+    // Block parameters behind the encoded bit planes, in little-endian byte order
+    unsigned char rec[8 + 2*sizeof(T) + 2 + 8 + NLAYMAX*(2*sizeof(T)+8)];
+    unsigned char *p = rec;
+    put_u64(p, 0UL); p += 8;
+    put_real(p, midval); p += sizeof(T);
+    put_real(p, halfspanval); p += sizeof(T);
+    *p++ = wlev;
+    *p++ = nlay;
+    put_u64(p, ntot_enc_blk); p += 8;
+    for (unsigned char ilay = 0; ilay < nlay; ilay++, p += sizeof(T)) put_real(p, deps_vec[ilay]);
+    for (unsigned char ilay = 0; ilay < nlay; ilay++, p += sizeof(T)) put_real(p, minval_vec[ilay]);
+    for (unsigned char ilay = 0; ilay < nlay; ilay++, p += 8) put_u64(p, len_enc_vec[ilay]);
+    e->sink.write_enc(e->sink.ctx_out, rec, (unsigned long int)(p-rec));
+    e->sink.ntot_enc += (unsigned long int)(p-rec);
+
+    e->nl[k] = 0;
+    e->nh[k] = 0;
+}
+
+/* Gather row i of level k of the streamed transform, the low-pass block of the next level is left out as zeros */
+template <typename T>
+static void stream_write_rows(void *ctx, int k, unsigned long int i, const T *low, const T *high)
+{
+    stream_enc<T> *e = (stream_enc<T>*)ctx;
+    k--;
+    const unsigned long int *ext = e->ext+6*k;
+    unsigned long int nxyk = ext[0]*ext[1];
+
+    T *row = e->low[k]+e->nl[k]*nxyk;
+    memcpy(row, low, nxyk*sizeof(T));
+    if (k+1 < e->nlev)
+      for (unsigned long int i2 = 0; i2 < ext[7]; i2++)
+        for (unsigned long int i1 = 0; i1 < ext[6]; i1++) row[i1+ext[0]*i2] = 0;
+    e->nl[k]++;
+    if (high) memcpy(e->high[k]+(e->nh[k]++)*nxyk, high, nxyk*sizeof(T));
+
+    // Code the block when it is full or the level is finished
+    unsigned long int nlow = ext[5] ? (ext[2]+1UL)/2UL : ext[2];
+    if ((e->nl[k] == e->nrow[k]) || (i+1UL == nlow)) stream_code_block(e, k);
+}
+
+
+/* Streaming encoding subroutine with wavelet transform and range coding */
+template <typename T>
+void encoding_wrap_stream(int nx, int ny, int nz, int wtflag, T tolrel, unsigned long int membudget, void *ctx_in, void (*read_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, T *fld), void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len), unsigned long int& ntot_enc, int ibackend)
+{
+    // Entropy coding backend of all blocks
+    check_backend(ibackend);
+
+    // Transform depth, zero if no transform required
+    if (wtflag == WAV_TYPE_CDF53)
+      {
+        cout << "Error: the streaming mode supports the CDF 9/7 transform or no transform" << endl;
+        throw std::exception();
+      }
+    int lvl = wtflag ? WAV_LVL : 0;
+
+    // Levels of the streamed transform and the rows of a block at each level, such that every block spans about 
+    // nzb planes of the field
+    stream_enc<T> e;
+    e.ctx_in = ctx_in;
+    e.read_fld = read_fld;
+    e.nxy = (unsigned long int)(nx)*(unsigned long int)(ny);
+    e.maxabs = 0;
+    e.tolrel = tolrel;
+    e.ibackend = ibackend;
+    e.nlev = waveletcdf97_3d_stream_levels(lvl, lvl, lvl, nx, ny, nz, e.ext);
+    unsigned long int nzb = stream_block_planes<T>(nx, ny, nz, membudget);
+    unsigned long int zspan = 1UL, nblk = 0UL;
+    for (int k = 0; k < e.nlev; k++)
+      {
+        const unsigned long int *ext = e.ext+6*k;
+        if (ext[5]) zspan *= 2UL;
+        e.nrow[k] = (nzb/zspan > 1UL) ? nzb/zspan : 1UL;
+        e.nl[k] = 0;
+        e.nh[k] = 0;
+        e.low[k] = new T[e.nrow[k]*ext[0]*ext[1]];
+        e.high[k] = new T[e.nrow[k]*ext[0]*ext[1]];
+        if (2UL*e.nrow[k]*ext[0]*ext[1] > nblk) nblk = 2UL*e.nrow[k]*ext[0]*ext[1];
+      }
+    e.fld_b = new T[nblk];
+
+    // Stream header: field size, precision and transform depth, as 8-byte little-endian integers
+    unsigned char header[56];
+    put_u64(header, (unsigned long int)(nx));
+    put_u64(header+8, (unsigned long int)(ny));
+    put_u64(header+16, (unsigned long int)(nz));
+    put_u64(header+24, sizeof(T));
+    for (int d = 0; d < 3; d++) put_u64(header+32+8*d, (unsigned long int)(lvl));
+    write_enc(ctx_out, header, sizeof(header));
+    e.sink.ctx_out = ctx_out;
+    e.sink.write_enc = write_enc;
+    e.sink.ntot_enc = sizeof(header);
+
+    // Transform the field plane by plane, the blocks are coded as they are completed
+    waveletcdf97_3d_stream<T>(nx, ny, nz, lvl, lvl, lvl, &e, stream_read_plane<T>, &e, stream_write_rows<T>);
+    ntot_enc = e.sink.ntot_enc;
+
+    // Deallocate memory
+    for (int k = 0; k < e.nlev; k++)
+      {
+        delete [] e.low[k];
+        delete [] e.high[k];
+      }
+    delete [] e.fld_b;
+}
+
+
+/* Decoded block of the streaming decoder: the coefficients of the low-pass rows i0 to i0+nl-1 and of the high-pass 
+   rows i0 to i0+nh-1 of one level, in a list of the blocks of that level */
+template <typename T>
+struct stream_blk
+{
+    T *fld;
+    unsigned long int i0, nl, nh;
+    stream_blk *next;
+};
+
+/* State of the streaming decoder. Blocks are read from the stream when the inverse transform requests a row that 
+   none of the decoded blocks of its level holds, the blocks of other levels read on the way are kept until they are 
+   needed */
+template <typename T>
+struct stream_dec
+{
+    void *ctx_in;
+    void (*read_enc)(void *ctx, unsigned char *buf, unsigned long int len);
+    void *ctx_out;
+    void (*write_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, const T *fld);
+    unsigned long int nxy;
+    int nlev;
+    unsigned long int ext[6*WAV_LVL_MAX];
+    unsigned long int nrow[WAV_LVL_MAX];
+    stream_blk<T> *first[WAV_LVL_MAX], *last[WAV_LVL_MAX];
+    unsigned long int lenc;
+    unsigned char *data_enc;
+};
+
+/* Read and decode the next block of the stream and append it to the list of its level */
+template <typename T>
+static void stream_read_block(stream_dec<T> *d)
+{
+    // Block head
+    unsigned char head[24];
+    d->read_enc(d->ctx_in, head, sizeof(head));
+    unsigned long int k = get_u64(head), nl = get_u64(head+8), nh = get_u64(head+16);
+    if ((k < 1UL) || (k > (unsigned long int)(d->nlev)))
+      {
+        cout << "Error: corrupted block record in the encoded stream" << endl;
+        throw std::exception();
+      }
+    const unsigned long int *ext = d->ext+6*(k-1UL);
+
+    // The block continues the rows of its level, with as many high-pass rows as low-pass rows, or one less at the 
+    // end of an odd number of planes
+    unsigned long int nlow = ext[5] ? (ext[2]+1UL)/2UL : ext[2];
+    unsigned long int nhigh = ext[2]-nlow;
+    unsigned long int i0 = d->nrow[k-1];
+    if ((nl < 1UL) || (nl > nlow-i0) || (nh > nl) || ((nh > 0UL) && (i0+nh > nhigh)) || ((nh < nl) && (i0+nh < nhigh)))
+      {
+        cout << "Error: corrupted block record in the encoded stream" << endl;
+        throw std::exception();
+      }
+    unsigned long int nxyk = ext[0]*ext[1];
+    unsigned long int ntot = (nl+nh)*nxyk;
 
-    // Input vector counter
+    // Read the encoded pieces of the block up to the zero length
+    unsigned long int ntot_enc_max = enc_len_max(ntot);
     unsigned long int jtot = 0;
+    while (1)
+      {
+        unsigned char len_head[8];
+        d->read_enc(d->ctx_in, len_head, 8);
+        unsigned long int len = get_u64(len_head);
+        if (len == 0) break;
+        if (len > ntot_enc_max-jtot)
+          {
+            cout << "Error: corrupted block record in the encoded stream" << endl;
+            throw std::exception();
+          }
+        if (jtot+len > d->lenc)
+          {
+            unsigned long int lnew = (2UL*d->lenc > jtot+len) ? 2UL*d->lenc : jtot+len;
+            unsigned char *data_new = new unsigned char[lnew];
+            if (jtot) memcpy(data_new, d->data_enc, jtot);
+            delete [] d->data_enc;
+            d->data_enc = data_new;
+            d->lenc = lnew;
+          }
+        d->read_enc(d->ctx_in, d->data_enc+jtot, len);
+        jtot += len;
+      }
 
-    // Output the decoded output vector   
-    for (unsigned char ilay = 0; ilay < nlay; ilay++)
-    {
+    // Read the block parameters
+    unsigned char rec[2*sizeof(T) + 2 + 8 + NLAYMAX*(2*sizeof(T)+8)];
+    d->read_enc(d->ctx_in, rec, 2*sizeof(T) + 2 + 8);
+    T midval = get_real<T>(rec, sizeof(T));
+    unsigned char wlev = rec[2*sizeof(T)];
+    unsigned char nlay = rec[2*sizeof(T)+1];
+    unsigned long int ntot_enc_blk = get_u64(rec+2*sizeof(T)+2);
+    if ((nlay > NLAYMAX) || (wlev > 1) || (ntot_enc_blk != jtot) || 
+        ((jtot > 2UL) && (d->data_enc[0] & ENC_FIELD_DESC) && (d->data_enc[2] != WAV_TYPE_CDF97)))
+      {
+        cout << "Error: corrupted block record in the encoded stream" << endl;
+        throw std::exception();
+      }
+    T deps_vec[NLAYMAX], minval_vec[NLAYMAX];
+    unsigned long int len_enc_vec[NLAYMAX];
+    d->read_enc(d->ctx_in, rec, nlay*(2*sizeof(T)+8));
+    unsigned char *p = rec;
+    for (unsigned char ilay = 0; ilay < nlay; ilay++, p += sizeof(T)) deps_vec[ilay] = get_real<T>(p, sizeof(T));
+    for (unsigned char ilay = 0; ilay < nlay; ilay++, p += sizeof(T)) minval_vec[ilay] = get_real<T>(p, sizeof(T));
+    for (unsigned char ilay = 0; ilay < nlay; ilay++, p += 8) len_enc_vec[ilay] = get_u64(p);
+
+    // Decode the coefficients of the block
+    stream_blk<T> *b = new stream_blk<T>;
+    b->fld = new T[ntot];
+    b->i0 = i0;
+    b->nl = nl;
+    b->nh = nh;
+    b->next = NULL;
+    decoding_prefix(int(ext[0]), int(ext[1]), int(nl+nh), b->fld, midval, wlev, nlay, nlay, 0, 0, 0, (const int*)(NULL), 1, ntot_enc_blk, deps_vec, minval_vec, len_enc_vec, d->data_enc);
+    d->nrow[k-1] += nl;
+    if (d->last[k-1]) d->last[k-1]->next = b;
+    else d->first[k-1] = b;
+    d->last[k-1] = b;
+}
+
+/* Fill row i of level k for the streamed inverse transform from the decoded blocks */
+template <typename T>
+static void stream_read_rows(void *ctx, int k, unsigned long int i, T *low, T *high)
+{
+    stream_dec<T> *d = (stream_dec<T>*)ctx;
+    k--;
+
+    // Drop the blocks of the rows already used and read blocks until one holds row i
+    while (1)
+      {
+        stream_blk<T> *b = d->first[k];
+        if (b && (i < b->i0+b->nl)) break;
+        if (b)
+          {
+            d->first[k] = b->next;
+            if (!b->next) d->last[k] = NULL;
+            delete [] b->fld;
+            delete b;
+          }
+        else
+          stream_read_block(d);
+      }
+    stream_blk<T> *b = d->first[k];
+    if (high && (i-b->i0 >= b->nh))
+      {
+        cout << "Error: corrupted block record in the encoded stream" << endl;
+        throw std::exception();
+      }
+
+    unsigned long int nxyk = d->ext[6*k]*d->ext[6*k+1];
+    memcpy(low, b->fld+(i-b->i0)*nxyk, nxyk*sizeof(T));
+    if (high) memcpy(high, b->fld+(b->nl+i-b->i0)*nxyk, nxyk*sizeof(T));
+}
+
+/* Pass plane i3 of the reconstructed field on */
+template <typename T>
+static void stream_write_plane(void *ctx, unsigned long int i3, const T *plane)
+{
+    stream_dec<T> *d = (stream_dec<T>*)ctx;
+    d->write_fld(d->ctx_out, i3*d->nxy, d->nxy, plane);
+}
+
+
+/* Streaming decoding subroutine with range decoding and inverse wavelet transform */
+template <typename T>
+void decoding_wrap_stream(int nx, int ny, int nz, void *ctx_in, void (*read_enc)(void *ctx, unsigned char *buf, unsigned long int len), void *ctx_out, void (*write_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, const T *fld))
+{
+    // Stream header
+    unsigned char header[56];
+    read_enc(ctx_in, header, sizeof(header));
+    unsigned long int lvl = get_u64(header+32);
+    if ((get_u64(header) != (unsigned long int)(nx)) || (get_u64(header+8) != (unsigned long int)(ny)) || (get_u64(header+16) != (unsigned long int)(nz)) || (get_u64(header+24) != sizeof(T)))
+      {
+        cout << "Error: the encoded stream does not match the field size or precision" << endl;
+        throw std::exception();
+      }
+    if ((lvl > (unsigned long int)(WAV_LVL_MAX)) || (get_u64(header+40) != lvl) || (get_u64(header+48) != lvl))
+      {
+        cout << "Error: corrupted transform depth in the encoded stream" << endl;
+        throw std::exception();
+      }
+
+    // Levels of the streamed transform, no blocks decoded yet
+    stream_dec<T> d;
+    d.ctx_in = ctx_in;
+    d.read_enc = read_enc;
+    d.ctx_out = ctx_out;
+    d.write_fld = write_fld;
+    d.nxy = (unsigned long int)(nx)*(unsigned long int)(ny);
+    d.nlev = waveletcdf97_3d_stream_levels(int(lvl), int(lvl), int(lvl), nx, ny, nz, d.ext);
+    for (int k = 0; k < d.nlev; k++)
+      {
+        d.nrow[k] = 0;
+        d.first[k] = NULL;
+        d.last[k] = NULL;
+      }
+    d.lenc = 0;
+    d.data_enc = NULL;
+
+    // Reconstruct the field plane by plane, the blocks are decoded as their rows are needed
+    waveletcdf97_3d_stream_inv<T>(nx, ny, nz, int(lvl), int(lvl), int(lvl), &d, stream_read_rows<T>, &d, stream_write_plane<T>);
+
+    // Deallocate memory
+    for (int k = 0; k < d.nlev; k++)
+      while (d.first[k])
+        {
+          stream_blk<T> *b = d.first[k];
+          d.first[k] = b->next;
+          delete [] b->fld;
+          delete b;
+        }
+    delete [] d.data_enc;
+}
+
+template void encoding_wrap_stream<float>(int nx, int ny, int nz, int wtflag, float tolrel, unsigned long int membudget, void *ctx_in, void (*read_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, float *fld), void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len), unsigned long int& ntot_enc, int ibackend);
+template void encoding_wrap_stream<double>(int nx, int ny, int nz, int wtflag, double tolrel, unsigned long int membudget, void *ctx_in, void (*read_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, double *fld), void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len), unsigned long int& ntot_enc, int ibackend);
+template void decoding_wrap_stream<float>(int nx, int ny, int nz, void *ctx_in, void (*read_enc)(void *ctx, unsigned char *buf, unsigned long int len), void *ctx_out, void (*write_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, const float *fld));
+template void decoding_wrap_stream<double>(int nx, int ny, int nz, void *ctx_in, void (*read_enc)(void *ctx, unsigned char *buf, unsigned long int len), void *ctx_out, void (*write_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, const double *fld));
+
+
+/* Brick sizes bsz, BRICK_SIZE where bvec is not positive and at most the field extents n, and the number of bricks 
+   nb in each direction */
+static void brick_grid(const int *n, const int *bvec, int *bsz, int *nb)
+{
+    for (int d = 0; d < 3; d++)
+      {
+        bsz[d] = (bvec[d] > 0) ? bvec[d] : BRICK_SIZE;
+        if (bsz[d] > n[d]) bsz[d] = n[d];
+        if ((bsz[d] < BRICK_SIZE_MIN) && (bsz[d] < n[d]))
+          {
+            cout << "Error: the brick size is smaller than " << BRICK_SIZE_MIN << endl;
+            throw std::exception();
+          }
+        if (bsz[d] < 1) bsz[d] = 1;
+        nb[d] = (n[d]+bsz[d]-1)/bsz[d];
+      }
+}
+
+/* Position i0 and extents nl of the brick ib, the bricks are numbered with the first direction being the fastest */
+static void brick_box(long int ib, const int *n, const int *bsz, const int *nb, int *i0, int *nl)
+{
+    for (int d = 0; d < 3; d++)
+      {
+        i0[d] = int(ib % nb[d])*bsz[d];
+        ib /= nb[d];
+        nl[d] = (i0[d]+bsz[d] > n[d]) ? n[d]-i0[d] : bsz[d];
+      }
+}
+
+/* Length of the header and the brick index at the beginning of a bricked encoded array: field size, brick size and 
+   precision, then the offset of every brick record and the total length, all as 8-byte little-endian integers */
+static unsigned long int brick_index_len(unsigned long int nbrick)
+{
+    return 7UL*8UL + (nbrick+1UL)*8UL;
+}
 
-        // Parameters for reconstruction
-        T deps = deps_vec[ilay];
-        T minval = minval_vec[ilay];
+/* Length of a brick record: parameters of the brick in little-endian byte order, as in a streamed block, followed by 
+   its encoded bit planes */
+template <typename T>
+static unsigned long int brick_record_len(unsigned char nlay, unsigned long int ntot_enc)
+{
+    return 2UL*sizeof(T) + 2UL + 8UL + (unsigned long int)(nlay)*(2UL*sizeof(T)+8UL) + ntot_enc;
+}
+
+/* Copy a box of extents nc from the position is of the field src of extents ns to the position id of the field dst 
+   of extents nd */
+template <typename T>
+static void copy_box(const int *nc, const T *src, const int *ns, const int *is, T *dst, const int *nd, const int *id)
+{
+    for (int kz = 0; kz < nc[2]; kz++)
+      for (int ky = 0; ky < nc[1]; ky++)
+        memcpy(dst + (unsigned long int)(id[0]) + (unsigned long int)(nd[0])*((unsigned long int)(id[1]+ky) + (unsigned long int)(nd[1])*(unsigned long int)(id[2]+kz)),
+               src + (unsigned long int)(is[0]) + (unsigned long int)(ns[0])*((unsigned long int)(is[1]+ky) + (unsigned long int)(ns[1])*(unsigned long int)(is[2]+kz)),
+               (unsigned long int)(nc[0])*sizeof(T));
+}
 
-        // Get the encoded data
-        unsigned long int len_out_q = len_enc_vec[ilay];
-        for(unsigned long int j = 0; j < len_out_q; j++) enc_q[j] = data_enc[jtot++];
 
-        // Decode
-        range_decode(enc_q,len_out_q,dec_q,ntot);
+/* Bricked encoding subroutine, every brick is wavelet-transformed and range-encoded independently */
+template <typename T>
+void encoding_wrap_brick(int nx, int ny, int nz, T *fld_1d, int wtflag, int *bvec, T tolrel, T& tolabs, unsigned long int& ntot_enc, unsigned char *data_enc, int ibackend)
+{
+    // Entropy coding backend of all bricks, checked before the parallel region
+    check_backend(ibackend);
+
+    // Brick sizes and the number of bricks
+    int n[3] = {nx, ny, nz};
+    int bsz[3], nb[3];
+    brick_grid(n, bvec, bsz, nb);
+    long int nbrick = (long int)(nb[0])*(long int)(nb[1])*(long int)(nb[2]);
+    unsigned long int nbtot = (unsigned long int)(bsz[0])*(unsigned long int)(bsz[1])*(unsigned long int)(bsz[2]);
+
+    // Global maximum absolute value, needed to impose the same absolute tolerance on all bricks
+    T minval, maxval;
+    layer_bounds(fld_1d, (unsigned long int)(nx)*(unsigned long int)(ny)*(unsigned long int)(nz), minval, maxval);
+    T maxabs = fmax(fabs(minval),fabs(maxval));
+
+    // Encode the bricks in parallel, each one in its own record. The wavelet transform and the range coder of a 
+    // brick run in one thread then, unless there is only one brick
+    unsigned char **brick_rec = new unsigned char*[nbrick];
+    unsigned long int *brick_len = new unsigned long int[nbrick];
+    #pragma omp parallel if(nbrick > 1)
+    {
+        // Brick field and encoded brick data of this thread
+        T *fld_b = new T[nbtot];
+        unsigned char *enc_b = new unsigned char[enc_len_max(nbtot)];
 
-        // Check quantized data bounds
-        unsigned char iminval = dec_q[0];
-        unsigned char imaxval = dec_q[0];
-        for(unsigned long int j = 1; j < ntot; j++)
+        #pragma omp for schedule(dynamic,1)
+        for (long int ib = 0; ib < nbrick; ib++)
           {
-             if (dec_q[j]<iminval) iminval = dec_q[j];
-             if (dec_q[j]>imaxval) imaxval = dec_q[j];
+            // Load the brick
+            int i0[3], nl[3], iz[3] = {0, 0, 0};
+            brick_box(ib, n, bsz, nb, i0, nl);
+            copy_box(nl, fld_1d, n, i0, fld_b, nl, iz);
+
+            // Relative cutoff of the brick that corresponds to the global absolute tolerance, tighter for the CDF 9/7 
+            // transform of a small brick
+            unsigned long int nltot = (unsigned long int)(nl[0])*(unsigned long int)(nl[1])*(unsigned long int)(nl[2]);
+            T bmin, bmax;
+            layer_bounds(fld_b, nltot, bmin, bmax);
+            T brickmax = fmax(fabs(bmin),fabs(bmax));
+            T cutoff = tolrel;
+            if (brickmax > 0) cutoff = tolrel * maxabs / brickmax;
+            if ((wtflag != WAV_TYPE_NONE) && (wtflag != WAV_TYPE_CDF53)) cutoff /= T(BRICK_ACC_COEF);
+
+            // Encode the brick
+            int lvlvec[3] = {WAV_LVL, WAV_LVL, WAV_LVL};
+            T tolabs_b, midval, halfspanval;
+            unsigned char wlev, nlay;
+            unsigned long int ntot_enc_b;
+            T deps_vec[NLAYMAX], minval_vec[NLAYMAX];
+            unsigned long int len_enc_vec[NLAYMAX];
+            encoding_wrap(nl[0], nl[1], nl[2], fld_b, wtflag, lvlvec, 1, 1, 1, &cutoff, tolabs_b, midval, halfspanval, wlev, nlay, ntot_enc_b, deps_vec, minval_vec, len_enc_vec, enc_b, ibackend);
+
+            // Brick record
+            brick_len[ib] = brick_record_len<T>(nlay, ntot_enc_b);
+            unsigned char *p = brick_rec[ib] = new unsigned char[brick_len[ib]];
+            put_real(p, midval); p += sizeof(T);
+            put_real(p, halfspanval); p += sizeof(T);
+            *p++ = wlev;
+            *p++ = nlay;
+            put_u64(p, ntot_enc_b); p += 8;
+            for (unsigned char k = 0; k < nlay; k++, p += sizeof(T)) put_real(p, deps_vec[k]);
+            for (unsigned char k = 0; k < nlay; k++, p += sizeof(T)) put_real(p, minval_vec[k]);
+            for (unsigned char k = 0; k < nlay; k++, p += 8) put_u64(p, len_enc_vec[k]);
+            memcpy(p, enc_b, ntot_enc_b);
           }
 
-        // Cumulative field
-        for(unsigned long int j = 0; j < ntot; j++)
-          fld_1d[j] = fld_1d[j] + ( dec_q[j]*deps + minval );
+        // Deallocate memory
+        delete [] fld_b;
+        delete [] enc_b;
     }
 
-    /* Wavelet reconstruction */
+    // Absolute tolerance of the reconstruction
+    tolabs = tolrel * maxabs;
 
-    // Inverse wavelet transform if the data is non-trivial
-    waveletcdf97_3d(nx,ny,nz,-int(wlev),fld_1d);
+    // Header, brick index and the brick records
+    unsigned long int header[7] = {(unsigned long int)(nx), (unsigned long int)(ny), (unsigned long int)(nz), (unsigned long int)(bsz[0]), (unsigned long int)(bsz[1]), (unsigned long int)(bsz[2]), sizeof(T)};
+    for (int k = 0; k < 7; k++) put_u64(data_enc+8*k, header[k]);
+    unsigned long int boff = brick_index_len(nbrick);
+    for (long int ib = 0; ib < nbrick; ib++)
+      {
+        put_u64(data_enc+56+8*ib, boff);
+        memcpy(data_enc+boff, brick_rec[ib], brick_len[ib]);
+        boff += brick_len[ib];
+        delete [] brick_rec[ib];
+      }
+    put_u64(data_enc+56+8*nbrick, boff);
+    ntot_enc = boff;
 
     // Deallocate memory
-    delete [] enc_q;
-    delete [] dec_q;
+    delete [] brick_rec;
+    delete [] brick_len;
+}
+
+
+/* Decoding subroutine of a region of a bricked field, only the bricks that overlap the region are decoded */
+template <typename T>
+void decoding_region(int nx, int ny, int nz, int *rvec, T *fld_r, unsigned long int& ntot_enc, unsigned char *data_enc)
+{
+    // Header
+    int n[3] = {nx, ny, nz};
+    if (ntot_enc < 56UL)
+      {
+        cout << "Error: the encoded data are not bricked" << endl;
+        throw std::exception();
+      }
+    unsigned long int header[7];
+    for (int k = 0; k < 7; k++) header[k] = get_u64(data_enc+8*k);
+    if ((header[0] != (unsigned long int)(nx)) || (header[1] != (unsigned long int)(ny)) || (header[2] != (unsigned long int)(nz)) || (header[3] < 1UL) || (header[3] > header[0]) || (header[4] < 1UL) || (header[4] > header[1]) || (header[5] < 1UL) || (header[5] > header[2]) || (header[6] != sizeof(T)))
+      {
+        cout << "Error: the bricked data do not match the field size or precision" << endl;
+        throw std::exception();
+      }
+
+    // Brick sizes and the number of bricks
+    int bsz[3] = {int(header[3]), int(header[4]), int(header[5])};
+    int nb[3];
+    brick_grid(n, bsz, bsz, nb);
+    long int nbrick = (long int)(nb[0])*(long int)(nb[1])*(long int)(nb[2]);
+    unsigned long int nbtot = (unsigned long int)(bsz[0])*(unsigned long int)(bsz[1])*(unsigned long int)(bsz[2]);
+
+    // Region extents
+    int nr[3], ir[3];
+    for (int d = 0; d < 3; d++)
+      {
+        if ((rvec[2*d] < 0) || (rvec[2*d] > rvec[2*d+1]) || (rvec[2*d+1] >= n[d]))
+          {
+            cout << "Error: the region is not inside the field" << endl;
+            throw std::exception();
+          }
+        ir[d] = rvec[2*d];
+        nr[d] = rvec[2*d+1]-rvec[2*d]+1;
+      }
+
+    // Brick index
+    if (ntot_enc < brick_index_len(nbrick))
+      {
+        cout << "Error: corrupted brick index in the encoded data" << endl;
+        throw std::exception();
+      }
+    unsigned long int *boff = new unsigned long int[nbrick+1];
+    for (long int ib = 0; ib <= nbrick; ib++) boff[ib] = get_u64(data_enc+56+8*ib);
+
+    // Bricks that overlap the region, from the one that holds its first element to the one that holds its last element
+    int b0[3], bn[3];
+    for (int d = 0; d < 3; d++)
+      {
+        b0[d] = rvec[2*d]/bsz[d];
+        bn[d] = rvec[2*d+1]/bsz[d] - b0[d] + 1;
+      }
+    long int nlist = (long int)(bn[0])*(long int)(bn[1])*(long int)(bn[2]);
+    long int *blist = new long int[nlist];
+    for (long int k = 0; k < nlist; k++)
+      {
+        long int ib = b0[0] + k % bn[0] + (long int)(nb[0])*(b0[1] + (k/bn[0]) % bn[1] + (long int)(nb[1])*(b0[2] + k/bn[0]/bn[1]));
+        blist[k] = ib;
+
+        // Check the brick record before decoding in parallel
+        unsigned char nlay = 0;
+        unsigned long int ntot_enc_b = 0;
+        if ((boff[ib] < brick_index_len(nbrick)) || (boff[ib] > boff[ib+1]) || (boff[ib+1] > ntot_enc) || (boff[ib+1]-boff[ib] < brick_record_len<T>(0,0)))
+          nlay = NLAYMAX+1;
+        else
+          {
+            nlay = data_enc[boff[ib]+2*sizeof(T)+1];
+            ntot_enc_b = get_u64(data_enc+boff[ib]+2*sizeof(T)+2);
+          }
+        if ((nlay > NLAYMAX) || (brick_record_len<T>(nlay, ntot_enc_b) != boff[ib+1]-boff[ib]))
+          {
+            cout << "Error: corrupted brick record in the encoded data" << endl;
+            throw std::exception();
+          }
+      }
+
+    // Decode the overlapping bricks in parallel and copy their part of the region
+    #pragma omp parallel if(nlist > 1)
+    {
+        // Brick field of this thread
+        T *fld_b = new T[nbtot];
+
+        #pragma omp for schedule(dynamic,1)
+        for (long int k = 0; k < nlist; k++)
+          {
+            // Read the brick record
+            unsigned char *p = data_enc + boff[blist[k]];
+            T tolabs = 0, midval, halfspanval;
+            unsigned char wlev, nlay;
+            unsigned long int ntot_enc_b;
+            T deps_vec[NLAYMAX], minval_vec[NLAYMAX];
+            unsigned long int len_enc_vec[NLAYMAX];
+            midval = get_real<T>(p, sizeof(T)); p += sizeof(T);
+            halfspanval = get_real<T>(p, sizeof(T)); p += sizeof(T);
+            wlev = *p++;
+            nlay = *p++;
+            ntot_enc_b = get_u64(p); p += 8;
+            for (unsigned char il = 0; il < nlay; il++, p += sizeof(T)) deps_vec[il] = get_real<T>(p, sizeof(T));
+            for (unsigned char il = 0; il < nlay; il++, p += sizeof(T)) minval_vec[il] = get_real<T>(p, sizeof(T));
+            for (unsigned char il = 0; il < nlay; il++, p += 8) len_enc_vec[il] = get_u64(p);
+
+            // Decode the brick
+            int i0[3], nl[3];
+            brick_box(blist[k], n, bsz, nb, i0, nl);
+            decoding_wrap(nl[0], nl[1], nl[2], fld_b, tolabs, midval, halfspanval, wlev, nlay, ntot_enc_b, deps_vec, minval_vec, len_enc_vec, p);
+
+            // Part of the brick inside the region
+            int nc[3], is[3], id[3];
+            for (int d = 0; d < 3; d++)
+              {
+                int lo = (i0[d] > ir[d]) ? i0[d] : ir[d];
+                int hi = (i0[d]+nl[d] < ir[d]+nr[d]) ? i0[d]+nl[d] : ir[d]+nr[d];
+                nc[d] = hi-lo;
+                is[d] = lo-i0[d];
+                id[d] = lo-ir[d];
+              }
+            copy_box(nc, fld_b, nl, is, fld_r, nr, id);
+          }
+
+        // Deallocate memory
+        delete [] fld_b;
+    }
+
+    // Deallocate memory
+    delete [] boff;
+    delete [] blist;
 }
 
+template void encoding_wrap_brick<float>(int nx, int ny, int nz, float *fld_1d, int wtflag, int *bvec, float tolrel, float& tolabs, unsigned long int& ntot_enc, unsigned char *data_enc, int ibackend);
+template void encoding_wrap_brick<double>(int nx, int ny, int nz, double *fld_1d, int wtflag, int *bvec, double tolrel, double& tolabs, unsigned long int& ntot_enc, unsigned char *data_enc, int ibackend);
+template void decoding_region<float>(int nx, int ny, int nz, int *rvec, float *fld_r, unsigned long int& ntot_enc, unsigned char *data_enc);
+template void decoding_region<double>(int nx, int ny, int nz, int *rvec, double *fld_r, unsigned long int& ntot_enc, unsigned char *data_enc);
+
 
 /* Return the number of bit planes and the required encoded data array size */ 
 extern "C" void setup_wr(int nx, int ny, int nz, unsigned char& nlaymax, unsigned long int& ntot_enc_max)
@@ -539,7 +2850,37 @@ extern "C" void setup_wr(int nx, int ny, int nz, unsigned char& nlaymax, unsigne
     unsigned long int ntot = (unsigned long int)(nx)*(unsigned long int)(ny)*(unsigned long int)(nz);
 
     // Required encoded data array size, for memory allocation
-    ntot_enc_max = SAFETY_BUFFER_FACTOR*NLAYMAX*(ntot<1024UL?1024UL:ntot);
+    ntot_enc_max = enc_len_max(ntot);
+}
+
+
+/* Return the required encoded data array size of the bricked encoding subroutine */ 
+extern "C" void setup_wr_brick(int nx, int ny, int nz, int *bvec, unsigned long int& ntot_enc_max)
+{
+    // Brick sizes and the number of bricks
+    int n[3] = {nx, ny, nz};
+    int bsz[3], nb[3];
+    brick_grid(n, bvec, bsz, nb);
+    long int nbrick = (long int)(nb[0])*(long int)(nb[1])*(long int)(nb[2]);
+
+    // Header, brick index and the largest record of every brick
+    ntot_enc_max = brick_index_len(nbrick);
+    for (long int ib = 0; ib < nbrick; ib++)
+      {
+        int i0[3], nl[3];
+        brick_box(ib, n, bsz, nb, i0, nl);
+        unsigned long int nltot = (unsigned long int)(nl[0])*(unsigned long int)(nl[1])*(unsigned long int)(nl[2]);
+        ntot_enc_max += brick_record_len<double>(NLAYMAX, enc_len_max(nltot));
+      }
+}
+
+
+/* Dimensions of the field reconstructed at a reduced resolution */ 
+extern "C" void decoding_extents(int nx, int ny, int nz, int ired, unsigned char& wlev, unsigned long int& ntot_enc, unsigned char *data_enc, int *nvec)
+{
+    int lvlvec[3], lred[3];
+    stored_levels(wlev,ntot_enc,data_enc,lvlvec);
+    lowpass_extents(nx,ny,nz,lvlvec,ired,nvec,lred);
 }
 
 
@@ -592,6 +2933,6 @@ extern "C" void setup_wr_f(int *nx, int *ny, int *nz, int& nlaymax, long int& nt
     long int ntot = (long int)(*nx)*(long int)(*ny)*(long int)(*nz);
 
     // Required encoded data array size, for memory allocation
-    ntot_enc_max = SAFETY_BUFFER_FACTOR*NLAYMAX*(ntot<1024L?1024L:ntot);
+    ntot_enc_max = long(enc_len_max((unsigned long int)(ntot)));
 }
 
@@ -29,19 +29,64 @@
     observational “Big Data”).
 */
 
+/* Options of the encoding subroutines encoding_wrap_opt_float and encoding_wrap_opt_double, a NULL pointer selects 
+   the defaults
+    ibackend : entropy coding backend, ENC_BACKEND_RANGE (0) for the range coder (default, ENC_BACKEND), 
+               ENC_BACKEND_RANS (1) for the interleaved rANS coder, which decodes several times faster, ENC_BACKEND_RAW 
+               (2) to store the bit planes without entropy coding. With the first two, bit planes with a zeroth-order 
+               entropy above RAW_BYPASS_BITS are stored raw. The decoder recognizes the backend from the encoded data
+    ctx_out, write_enc : if write_enc is not NULL, the encoded data are passed to it with the user context ctx_out 
+               instead of being stored in data_enc, as by the encoding subroutine with a sink */
+struct enc_options
+{
+    int ibackend;
+    void *ctx_out;
+    void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len);
+};
+
 extern "C" void encoding_wrap_float(int nx, int ny, int nz, float *fld_1d, int wtflag, int mx, int my, int mz, float *cutoffvec, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
 extern "C" void encoding_wrap_double(int nx, int ny, int nz, double *fld_1d, int wtflag, int mx, int my, int mz, double *cutoffvec, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
 
+extern "C" void encoding_wrap_lvl_float(int nx, int ny, int nz, float *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, float *cutoffvec, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+extern "C" void encoding_wrap_lvl_double(int nx, int ny, int nz, double *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, double *cutoffvec, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+
+extern "C" void encoding_wrap_opt_float(int nx, int ny, int nz, float *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, float *cutoffvec, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, const enc_options *opts);
+extern "C" void encoding_wrap_opt_double(int nx, int ny, int nz, double *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, double *cutoffvec, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, const enc_options *opts);
+
 extern "C" void decoding_wrap_float(int nx, int ny, int nz, float *fld_1d, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
 extern "C" void decoding_wrap_double(int nx, int ny, int nz, double *fld_1d, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
 
+extern "C" void decoding_layers_float(float tolreq, int nlayreq, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, unsigned char& nlay_dec, unsigned long int& ntot_dec);
+extern "C" void decoding_layers_double(double tolreq, int nlayreq, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, unsigned char& nlay_dec, unsigned long int& ntot_dec);
+
+extern "C" void decoding_wrap_prog_float(int nx, int ny, int nz, float *fld_1d, float tolreq, int nlayreq, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+extern "C" void decoding_wrap_prog_double(int nx, int ny, int nz, double *fld_1d, double tolreq, int nlayreq, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+
+extern "C" void decoding_wrap_res_float(int nx, int ny, int nz, float *fld_1d, int ired, float tolreq, int nlayreq, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+extern "C" void decoding_wrap_res_double(int nx, int ny, int nz, double *fld_1d, int ired, double tolreq, int nlayreq, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+
+extern "C" void decoding_slice_float(int nx, int ny, int nz, float *fld_s, int sdir, int nslc, int *islc, float tolreq, int nlayreq, float& tolabs, float& midval, float& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, float *deps_vec, float *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+extern "C" void decoding_slice_double(int nx, int ny, int nz, double *fld_s, int sdir, int nslc, int *islc, double tolreq, int nlayreq, double& tolabs, double& midval, double& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, double *deps_vec, double *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+
+extern "C" void encoding_wrap_stream_float(int nx, int ny, int nz, int wtflag, float tolrel, unsigned long int membudget, void *ctx_in, void (*read_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, float *fld), void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len), unsigned long int& ntot_enc, int ibackend);
+extern "C" void encoding_wrap_stream_double(int nx, int ny, int nz, int wtflag, double tolrel, unsigned long int membudget, void *ctx_in, void (*read_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, double *fld), void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len), unsigned long int& ntot_enc, int ibackend);
+
+extern "C" void decoding_wrap_stream_float(int nx, int ny, int nz, void *ctx_in, void (*read_enc)(void *ctx, unsigned char *buf, unsigned long int len), void *ctx_out, void (*write_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, const float *fld));
+extern "C" void decoding_wrap_stream_double(int nx, int ny, int nz, void *ctx_in, void (*read_enc)(void *ctx, unsigned char *buf, unsigned long int len), void *ctx_out, void (*write_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, const double *fld));
+
+extern "C" void encoding_wrap_brick_float(int nx, int ny, int nz, float *fld_1d, int wtflag, int *bvec, float tolrel, float& tolabs, unsigned long int& ntot_enc, unsigned char *data_enc, int ibackend);
+extern "C" void encoding_wrap_brick_double(int nx, int ny, int nz, double *fld_1d, int wtflag, int *bvec, double tolrel, double& tolabs, unsigned long int& ntot_enc, unsigned char *data_enc, int ibackend);
+
+extern "C" void decoding_region_float(int nx, int ny, int nz, int *rvec, float *fld_r, unsigned long int& ntot_enc, unsigned char *data_enc);
+extern "C" void decoding_region_double(int nx, int ny, int nz, int *rvec, double *fld_r, unsigned long int& ntot_enc, unsigned char *data_enc);
+
 /* C/C++ interface */
 /* Encoding subroutine with wavelet transform and range coding 
     nx : (INPUT) number of elements of the input 3D field in the first (fastest) direction
     ny : (INPUT) number of elements of the input 3D field in the second direction
     nz : (INPUT) number of elements of the input 3D field in the third (slowest) direction
     fld_1d : (INPUT) input 3D field reshaped in a 1D array with the direction x being contiguous (as in Fortran)
-    wtflag : (INPUT) wavelet transform flag: 0 if not transforming, 1 if transforming
+    wtflag : (INPUT) wavelet transform flag: 0 if not transforming, 1 for the CDF 9/7 transform, 2 for the reversible integer CDF 5/3 transform (lossless if the tolerance is zero)
     mx : (INPUT) number local cutoff subdomains in x, recommended mx=1
     my : (INPUT) number local cutoff subdomains in y, recommended my=1
     mz : (INPUT) number local cutoff subdomains in z, recommended mz=1
@@ -59,6 +104,30 @@ extern "C" void decoding_wrap_double(int nx, int ny, int nz, double *fld_1d, dou
 template <typename T>
 void encoding_wrap(int nx, int ny, int nz, T *fld_1d, int wtflag, int mx, int my, int mz, T *cutoffvec, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
 
+/* Encoding subroutine with a separate wavelet transform depth in each direction. The arguments are the same as above, except
+    lvlvec : (INPUT/OUTPUT) transform depths in the three directions, int lvlvec[3]; an entry equal to WAV_LVL_AUTO is chosen 
+             from the array extents and the energy compaction of the field; on output, the depths actually applied.
+             The depths are stored with the encoded data if they differ, and wlev is set to the largest of them */
+template <typename T>
+void encoding_wrap(int nx, int ny, int nz, T *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, T *cutoffvec, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+
+/* Encoding subroutine that passes the encoded data to a sink instead of storing it in data_enc, such that no array 
+   of the worst-case size ntot_enc_max is needed. The arguments are the same as above, except
+    ctx_out : (INPUT) user context passed to write_enc
+    write_enc : (INPUT) callback that appends len bytes of the encoded data from buf; it is called in the order of 
+                the data, at least once per bit plane, and the bytes are the same as would be stored in data_enc
+    ntot_enc : (OUTPUT) exact total number of bytes passed to write_enc */
+template <typename T>
+void encoding_wrap(int nx, int ny, int nz, T *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, T *cutoffvec, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len));
+
+/* Encoding subroutines with the entropy coding backend given for this call, the encoding subroutines above use 
+   ENC_BACKEND. The arguments are the same as above, except
+    ibackend : (INPUT) entropy coding backend, as in enc_options */
+template <typename T>
+void encoding_wrap(int nx, int ny, int nz, T *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, T *cutoffvec, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, int ibackend);
+template <typename T>
+void encoding_wrap(int nx, int ny, int nz, T *fld_1d, int wtflag, int *lvlvec, int mx, int my, int mz, T *cutoffvec, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len), int ibackend);
+
 /* Decoding subroutine with range decoding and inverse wavelet transform 
     nx : (INPUT) number of elements of the input 3D field in the first (fastest) direction
     ny : (INPUT) number of elements of the input 3D field in the second direction
@@ -77,18 +146,146 @@ void encoding_wrap(int nx, int ny, int nz, T *fld_1d, int wtflag, int mx, int my
 template <typename T>
 void decoding_wrap(int nx, int ny, int nz, T *fld_1d, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
 
+/* Number of bit planes needed for a precision-progressive decoding, and the length of the encoded data that holds them
+    tolreq : (INPUT) requested absolute tolerance, in the units of tolabs; the fewest bit planes whose quantization 
+             interval does not exceed tolreq are decoded, all of them if tolreq is not larger than tolabs or is zero
+    nlayreq : (INPUT) requested number of bit planes, used instead of tolreq if positive; 0 for all. All bit planes 
+              are decoded anyway if the field was encoded losslessly with the integer transform
+    nlay, ntot_enc, deps_vec, len_enc_vec : (INPUT) as output by the encoding subroutine
+    data_enc : (INPUT) encoded data array, only its first len_enc_vec[0] elements are read
+    nlay_dec : (OUTPUT) number of bit planes to decode
+    ntot_dec : (OUTPUT) number of elements at the start of data_enc that hold the encoded bit planes to decode */
+template <typename T>
+void decoding_layers(T tolreq, int nlayreq, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, unsigned long int *len_enc_vec, unsigned char *data_enc, unsigned char& nlay_dec, unsigned long int& ntot_dec);
+
+/* Precision-progressive decoding subroutine, reconstructs a coarser approximation of the field from the first bit 
+   planes only, as chosen by decoding_layers. The arguments are the same as in the decoding subroutine above, except
+    tolreq : (INPUT) requested absolute tolerance, see decoding_layers
+    nlayreq : (INPUT) requested number of bit planes, see decoding_layers
+    data_enc : (INPUT) encoded data array, only its first ntot_dec elements are read, as output by decoding_layers */
+template <typename T>
+void decoding_wrap(int nx, int ny, int nz, T *fld_1d, T tolreq, int nlayreq, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+
+/* Resolution-progressive decoding subroutine, reconstructs the low-pass approximation of the field left by the ired 
+   finest wavelet levels, without decoding their subbands nor applying their inverse transform. The arguments are 
+   the same as in the precision-progressive decoding subroutine above, except
+    fld_1d : (OUTPUT) reconstructed 3D field at the reduced resolution, of the extents given by decoding_extents
+    ired : (INPUT) number of finest levels to skip, 0 for the full resolution; directions transformed with fewer 
+           levels are reduced by their number of levels only. The fine subbands are still decoded if the field was 
+           encoded in the older Mallat coefficient order, a field encoded losslessly with the integer transform is 
+           reconstructed at full resolution and subsampled */
+template <typename T>
+void decoding_wrap(int nx, int ny, int nz, T *fld_1d, int ired, T tolreq, int nlayreq, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+
+/* Slice decoding subroutine, reconstructs a few planes normal to one direction. All wavelet coefficients are decoded, 
+   but the inverse transform only follows the dependency cone of the planes through the levels: along the normal 
+   direction, only the rows within reach of the lifting steps are transformed. The planes are identical to those of 
+   the full reconstruction. The arguments are the same as in the precision-progressive decoding subroutine above, 
+   except
+    fld_s : (OUTPUT) reconstructed planes, stored as the field restricted to the indexes islc along sdir, e.g. 
+            nx x ny x nslc for sdir = 3, the direction x being contiguous
+    sdir : (INPUT) direction normal to the planes, 1, 2 or 3 for the first, second or third direction
+    nslc : (INPUT) number of planes
+    islc : (INPUT) zero-based indexes of the planes along sdir, int islc[nslc]. A field encoded with the integer 
+           transform is reconstructed in full and the planes are extracted */
+template <typename T>
+void decoding_slice(int nx, int ny, int nz, T *fld_s, int sdir, int nslc, int *islc, T tolreq, int nlayreq, T& tolabs, T& midval, T& halfspanval, unsigned char& wlev, unsigned char& nlay, unsigned long int& ntot_enc, T *deps_vec, T *minval_vec, unsigned long int *len_enc_vec, unsigned char *data_enc);
+
+/* Streaming encoding subroutine for fields that do not fit in memory. The field is read once, plane by plane 
+   along the third direction, and wavelet-transformed over a sliding window of planes, so the transform is the 
+   same as that of the whole field. The coefficients of every level are quantized and range-encoded in blocks of 
+   rows as soon as they are complete, with the absolute tolerance given by the maximum absolute value of the planes 
+   read so far, never looser than that of the whole field. Every block is coded on its own: for a 256^3 double 
+   field the stream is 15% smaller to 20% larger than the whole field encoded at once with a budget of 64 MB or 
+   more, and 7-35% larger with 16 MB, where a block spans 4 planes.
+    nx : (INPUT) number of elements of the input 3D field in the first (fastest) direction
+    ny : (INPUT) number of elements of the input 3D field in the second direction
+    nz : (INPUT) number of elements of the input 3D field in the third (slowest) direction
+    wtflag : (INPUT) wavelet transform flag: 0 if not transforming, 1 for the CDF 9/7 transform
+    tolrel : (INPUT) relative global tolerance
+    membudget : (INPUT) approximate working memory limit in bytes, determines the number of planes spanned by a block 
+                (at least one plane). The transform window takes up to 15 planes, a block 3*sizeof(T)+4 bytes per 
+                element, for its rows, its copy in subband order, the quantized bit planes and one encoded bit plane
+    ctx_in : (INPUT) user context passed to read_fld
+    read_fld : (INPUT) callback that fills fld with nelem elements of the input field starting at the 1D index ioff
+    ctx_out : (INPUT) user context passed to write_enc
+    write_enc : (INPUT) callback that appends len bytes of the encoded stream from buf
+    ntot_enc : (OUTPUT) total number of bytes of the encoded stream
+    ibackend : (INPUT) entropy coding backend, as in enc_options */
+template <typename T>
+void encoding_wrap_stream(int nx, int ny, int nz, int wtflag, T tolrel, unsigned long int membudget, void *ctx_in, void (*read_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, T *fld), void *ctx_out, void (*write_enc)(void *ctx, const unsigned char *buf, unsigned long int len), unsigned long int& ntot_enc, int ibackend);
+
+/* Streaming decoding subroutine, reconstructs the field one plane at a time with the inverse transform over a 
+   sliding window of planes. The blocks are decoded as their rows are needed
+    nx : (INPUT) number of elements of the 3D field in the first (fastest) direction
+    ny : (INPUT) number of elements of the 3D field in the second direction
+    nz : (INPUT) number of elements of the 3D field in the third (slowest) direction
+    ctx_in : (INPUT) user context passed to read_enc
+    read_enc : (INPUT) callback that reads the next len bytes of the encoded stream into buf
+    ctx_out : (INPUT) user context passed to write_fld
+    write_fld : (INPUT) callback that receives nelem reconstructed elements starting at the 1D index ioff */
+template <typename T>
+void decoding_wrap_stream(int nx, int ny, int nz, void *ctx_in, void (*read_enc)(void *ctx, unsigned char *buf, unsigned long int len), void *ctx_out, void (*write_fld)(void *ctx, unsigned long int ioff, unsigned long int nelem, const T *fld));
+
+/* Bricked encoding subroutine for random access to subvolumes. The field is split in bricks, each brick is 
+   wavelet-transformed and range-encoded independently, in parallel, with the same absolute tolerance as if the 
+   whole field was encoded at once, tightened by BRICK_ACC_COEF for the CDF 9/7 transform. Small bricks compress 
+   less well, see BRICK_SIZE. The encoded array starts with the field size, the brick size and an index of 
+   the offsets of the brick records, stored in little-endian byte order like the brick parameters
+    nx : (INPUT) number of elements of the input 3D field in the first (fastest) direction
+    ny : (INPUT) number of elements of the input 3D field in the second direction
+    nz : (INPUT) number of elements of the input 3D field in the third (slowest) direction
+    fld_1d : (INPUT) input 3D field reshaped in a 1D array with the direction x being contiguous, it is not modified
+    wtflag : (INPUT) wavelet transform flag, as in the encoding subroutine
+    bvec : (INPUT) brick size in each direction, int bvec[3]; BRICK_SIZE if not positive, at most the field size and 
+           at least BRICK_SIZE_MIN where the field is larger
+    tolrel : (INPUT) relative global tolerance
+    tolabs : (OUTPUT) absolute tolerance of the reconstruction, tolrel times the largest magnitude of the field
+    ntot_enc : (OUTPUT) total number of elements of the encoded array data_enc
+    data_enc : (OUTPUT) encoded data array of at least ntot_enc_max elements, as output by setup_wr_brick
+    ibackend : (INPUT) entropy coding backend, as in enc_options */
+template <typename T>
+void encoding_wrap_brick(int nx, int ny, int nz, T *fld_1d, int wtflag, int *bvec, T tolrel, T& tolabs, unsigned long int& ntot_enc, unsigned char *data_enc, int ibackend);
+
+/* Decoding subroutine of a region of a bricked field, only the bricks that overlap the region are decoded, in 
+   parallel
+    nx, ny, nz : (INPUT) number of elements of the whole 3D field in each direction
+    rvec : (INPUT) first and last indexes of the region in each direction, int rvec[6] = {x0, x1, y0, y1, z0, z1}; 
+           zero-based and inclusive
+    fld_r : (OUTPUT) reconstructed region of extents (x1-x0+1) x (y1-y0+1) x (z1-z0+1), the direction x being contiguous
+    ntot_enc : (INPUT) total number of elements of the encoded array data_enc
+    data_enc : (INPUT) encoded data array, as output by encoding_wrap_brick. Only the header, the brick index and the 
+               records of the overlapping bricks are read */
+template <typename T>
+void decoding_region(int nx, int ny, int nz, int *rvec, T *fld_r, unsigned long int& ntot_enc, unsigned char *data_enc);
+
 /* Return the number of bit planes and the required encoded data array size, as needed for memory allocation
     nlaymax : maximum allowed number of bit planes
-    ntot_enc_max : maximum allowed total number of elements of the encoded array data_enc */ 
+    ntot_enc_max : maximum allowed total number of elements of the encoded array data_enc. It holds the encoded data 
+                   of any field of this size, including lossless encoding of incompressible data, whose streams are 
+                   stored raw */ 
 extern "C" void setup_wr(int nx, int ny, int nz, unsigned char& nlaymax, unsigned long int& ntot_enc_max);
 
+/* Return the required encoded data array size of the bricked encoding subroutine, as needed for memory allocation
+    bvec : brick size in each direction, as passed to encoding_wrap_brick
+    ntot_enc_max : maximum allowed total number of elements of the encoded array data_enc */ 
+extern "C" void setup_wr_brick(int nx, int ny, int nz, int *bvec, unsigned long int& ntot_enc_max);
+
+/* Return the extents of the field reconstructed by the resolution-progressive decoding subroutine
+    nx, ny, nz : (INPUT) number of elements of the full-resolution 3D field in each direction
+    ired : (INPUT) number of finest wavelet levels to skip
+    wlev, ntot_enc : (INPUT) as output by the encoding subroutine
+    data_enc : (INPUT) encoded data array, only its first len_enc_vec[0] elements are read
+    nvec : (OUTPUT) extents of the reduced field in each direction, int nvec[3] */ 
+extern "C" void decoding_extents(int nx, int ny, int nz, int ired, unsigned char& wlev, unsigned long int& ntot_enc, unsigned char *data_enc, int *nvec);
+
 /* Fortran interface */
 /* Encoding subroutine with wavelet transform and range coding 
     nx : (INPUT) number of elements of the input 3D field in the first (fastest) direction
     ny : (INPUT) number of elements of the input 3D field in the second direction
     nz : (INPUT) number of elements of the input 3D field in the third (slowest) direction
     fld : (INPUT) output reconstructed 3D field reshaped in a 1D array with the direction x being contiguous (as in Fortran)
-    wtflag : (INPUT) wavelet transform flag: 0 if not transforming, 1 if transforming
+    wtflag : (INPUT) wavelet transform flag: 0 if not transforming, 1 for the CDF 9/7 transform, 2 for the reversible integer CDF 5/3 transform (lossless if the tolerance is zero)
     tolrel : (INPUT) relative global tolerance
     tolabs : (OUTPUT) absolute global tolerance
     midval : (OUTPUT) mid-value, midval = minval+(maxval-minval)/2, where maxval is the maximum and minval is the minimum of fld
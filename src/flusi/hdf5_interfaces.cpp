@@ -37,6 +37,7 @@
 #include <iostream>
 #include <exception>
 #include <memory>
+#include <vector>
 
 #include "hdf5.h"
 #include "../core/defs.h"
@@ -743,6 +744,14 @@ int read_field_hdf5( const char *filename, const char *dsetname, double *fld )
 }
 
 
+/* Append a piece of the encoded data to a growable buffer, ctx is a std::vector<unsigned char> (sink for encoding_wrap) */
+void write_enc_buf( void *ctx, const unsigned char *buf, unsigned long int len )
+{
+   vector<unsigned char> *data_enc = static_cast<vector<unsigned char>*>(ctx);
+   data_enc->insert(data_enc->end(), buf, buf+len);
+}
+
+
 /* Write unsigned char type data set */
 int write_field_hdf5_enc( const char *filename, const char *dsetname, unsigned char *fld, unsigned long int ntot_enc )
 {
@@ -49,6 +49,8 @@ int write_field_hdf5( const char *filename, const char *dsetname, double *fld, i
 int read_field_hdf5( const char *filename, const char *dsetname, double *fld );
 /* Write unsigned char type data set */
 int write_field_hdf5_enc( const char *filename, const char *dsetname, unsigned char *fld, unsigned long int ntot_enc );
+/* Append a piece of the encoded data to a growable buffer, ctx is a std::vector<unsigned char> (sink for encoding_wrap) */
+void write_enc_buf( void *ctx, const unsigned char *buf, unsigned long int len );
 /* Read unsigned char type data set */
 int read_field_hdf5_enc( const char *filename, const char *dsetname, unsigned char *fld );
 
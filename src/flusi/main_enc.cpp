@@ -39,6 +39,7 @@
 #include <memory>
 #include <string>
 #include <sstream>
+#include <vector>
 
 #include "hdf5.h"
 #include "../core/defs.h"
@@ -275,13 +276,13 @@ int main( int argc, char *argv[] )
 	  // Print min and max
           cout << "        min=" << minval << " max=" << maxval << endl;
 
-          // Allocate encoded data array (will be stored in a file)
-          // Encoded array may be longer than the original
-          unsigned char *data_enc = new unsigned char[SAFETY_BUFFER_FACTOR*NLAYMAX*(ntot<1024UL?1024UL:ntot)];
+          // Encoded data array (will be stored in a file), grows to the exact encoded size
+          vector<unsigned char> data_enc;
 
           /* Do encoding */
           // Apply encoding routine
-          encoding_wrap(nx,ny,nz,fld_1d,1,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc);
+          int lvlvec[3] = {WAV_LVL, WAV_LVL, WAV_LVL};
+          encoding_wrap(nx,ny,nz,fld_1d,1,lvlvec,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,(void*)&data_enc,write_enc_buf);
 
           // Print efficient global cutoff
           cout << "        tolabs=" << tolabs << endl;
@@ -291,7 +292,7 @@ int main( int argc, char *argv[] )
 
           /* Write compressed data to a file */
           // Write data if the compressed data set is non-trivial
-          err = write_field_hdf5_enc( out_name.c_str(), dsetname, data_enc, ntot_enc );
+          err = write_field_hdf5_enc( out_name.c_str(), dsetname, data_enc.data(), ntot_enc );
 
           // Write attributes
           err = write_attrib_dble( out_name.c_str(), dsetname, "time", &time, 1 );
@@ -303,9 +304,6 @@ int main( int argc, char *argv[] )
           // Write coding attributes
           err = write_attrib_enc( out_name.c_str(), dsetname, &tolabs, &midval, &halfspanval, &wlev, &nlay, &ntot_enc, deps_vec, minval_vec, len_enc_vec );
 
-          // Deallocate memory
-          delete [] data_enc;
-
           break;
         }
 
@@ -496,13 +494,13 @@ int main( int argc, char *argv[] )
               // Print min and max
               cout << "        min=" << minval << " max=" << maxval << endl;
 
-              // Allocate encoded data array (will be stored in a file)
-              // Encoded array may be longer than the original
-              unsigned char *data_enc = new unsigned char[SAFETY_BUFFER_FACTOR*NLAYMAX*(ntot<1024UL?1024UL:ntot)];
+              // Encoded data array (will be stored in a file), grows to the exact encoded size
+              vector<unsigned char> data_enc;
 
               /* Do encoding */
               // Apply encoding routine
-              encoding_wrap(nx,ny,nz,fld_1d,1,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc);
+              int lvlvec[3] = {WAV_LVL, WAV_LVL, WAV_LVL};
+              encoding_wrap(nx,ny,nz,fld_1d,1,lvlvec,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,(void*)&data_enc,write_enc_buf);
 
               // Print efficient global cutoff
               cout << "        tolabs=" << tolabs << endl;
@@ -513,16 +511,13 @@ int main( int argc, char *argv[] )
               /* Write compressed data to a file */
               // Write data if the compressed data set is non-trivial
               if (ntot_enc > 0)
-                err = write_field_hdf5_enc( out_name.c_str(), dsettab[j], data_enc, ntot_enc );
+                err = write_field_hdf5_enc( out_name.c_str(), dsettab[j], data_enc.data(), ntot_enc );
 
               // Write attributes
               err = write_attrib_dble( out_name.c_str(), dsettab[j], "bckp", attributes, 8 );
 
               // Write coding attributes
               err = write_attrib_enc( out_name.c_str(), dsettab[j], &tolabs, &midval, &halfspanval, &wlev, &nlay, &ntot_enc, deps_vec, minval_vec, len_enc_vec );
-
-              // Deallocate memory
-              delete [] data_enc;
             }
           }
           break;
@@ -408,6 +408,19 @@ void write_field_gen_enc( const char *filename, unsigned char *fld, unsigned lon
 }
 
 
+/* Append a piece of the encoded data to an open file, ctx is the std::ofstream (sink for encoding_wrap) */
+void write_enc_gen( void *ctx, const unsigned char *buf, unsigned long int len )
+{
+    ofstream *outputfile = static_cast<ofstream*>(ctx);
+    outputfile->write(reinterpret_cast<const char*>(buf), len);
+    if (!outputfile->good())
+      {
+        cout << "Error: failed to write encoded data" << endl;
+        throw std::exception();
+      }
+}
+
+
 /* Read unsigned char type data set */
 void read_field_gen_enc( ifstream &inputfile, unsigned char *fld, unsigned long int ntot_enc )
 {
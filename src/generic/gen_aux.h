@@ -35,6 +35,8 @@ void write_field_gen( const char *filename, int idset, int ifiletype, int flag_c
 void read_field_gen( const char *filename, int idset, int ifiletype, int flag_convertendian, int nbytes, unsigned char *recl, int nx, int ny, int nz, int nh, int idinv, long *btpos, double *fld );
 /* Write unsigned char type data set */
 void write_field_gen_enc( const char *filename, unsigned char *fld, unsigned long int ntot_enc );
+/* Append a piece of the encoded data to an open file, ctx is the std::ofstream (sink for encoding_wrap) */
+void write_enc_gen( void *ctx, const unsigned char *buf, unsigned long int len );
 /* Read unsigned char type data set */
 void read_field_gen_enc( std::ifstream &inputfile, unsigned char *fld, unsigned long int ntot_enc );
 /* Write double type data set */
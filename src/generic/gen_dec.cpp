@@ -76,6 +76,19 @@ int main( int argc, char *argv[] )
     // Floating point input file precision (4: single; 8: double)
     int nbytes;
 
+    // Precision-progressive decoding: relative tolerance and number of bit planes to decode (0: full precision)
+    double tol_dec = 0;
+    int nlay_req = 0;
+
+    // Resolution-progressive decoding: number of finest wavelet levels to skip (0: full resolution)
+    int ired = 0;
+
+    // Slice decoding: direction normal to the planes (0: whole field) and their comma-separated indexes
+    int sdir = 0;
+    int nslc = 0;
+    int *islc = NULL;
+    string slc_list;
+
     // Data variable declarations
     double *fld_1d_rec;
     double tolabs;
@@ -97,12 +110,15 @@ int main( int argc, char *argv[] )
     unsigned char recl[8];
     for (int j = 0; j < 8; j++) recl[j] = 0;
 
-    cout << "usage: ./wrdec ENCODED_FILE HEADER_FILE EXTRACTED_FILE TYPE ENDIANFLIP\n";
+    cout << "usage: ./wrdec ENCODED_FILE HEADER_FILE EXTRACTED_FILE TYPE ENDIANFLIP [TOLERANCE [NLAYERS [REDUCTION [SLICEDIR SLICES]]]]\n";
     cout << "where TYPE=(0: Fortran sequential w 4-byte recl; 1: Fortran sequential w 8-byte recl; 2: C/C++) and ENDIANFLIP=(0:no; 1:yes)\n";
+    cout << "optional TOLERANCE=(relative tolerance of a coarser reconstruction; 0: full precision) and NLAYERS=(number of bit planes to decode; 0: all)\n";
+    cout << "and REDUCTION=(number of finest wavelet levels to skip, each halves the resolution; 0: full resolution)\n";
+    cout << "and SLICEDIR=(direction normal to the extracted planes, 1: x; 2: y; 3: z; 0: whole field) with SLICES=(comma-separated zero-based plane indexes)\n";
     cout << "interactive mode if not enough arguments are passed.\n";
 
     /* Prepare for decoding */
-    if ( argc == 6 )
+    if ( (argc >= 6) && (argc <= 11) && (argc != 10) )
     {
       // Read metadata from parameter string
       cout << "automatic mode.";
@@ -113,6 +129,27 @@ int main( int argc, char *argv[] )
       stringstream(bar) >> ifiletype;
       bar = argv[5];
       stringstream(bar) >> flag_convertendian;
+      if (argc >= 7)
+        {
+          bar = argv[6];
+          stringstream(bar) >> tol_dec;
+        }
+      if (argc >= 8)
+        {
+          bar = argv[7];
+          stringstream(bar) >> nlay_req;
+        }
+      if (argc >= 9)
+        {
+          bar = argv[8];
+          stringstream(bar) >> ired;
+        }
+      if (argc >= 11)
+        {
+          bar = argv[9];
+          stringstream(bar) >> sdir;
+          slc_list = argv[10];
+        }
     }
     else
     {
@@ -132,6 +169,34 @@ int main( int argc, char *argv[] )
       cout << "Enter endian conversion (0: do not perform; 1: inversion) [0]: ";
       getline (cin,bar);
       if (!bar.empty()) stringstream(bar) >> flag_convertendian;
+      cout << "Enter relative tolerance of a coarser reconstruction (0: full precision) [0]: ";
+      getline (cin,bar);
+      if (!bar.empty()) stringstream(bar) >> tol_dec;
+      cout << "Enter number of bit planes to decode (0: all) [0]: ";
+      getline (cin,bar);
+      if (!bar.empty()) stringstream(bar) >> nlay_req;
+      cout << "Enter number of finest wavelet levels to skip (0: full resolution) [0]: ";
+      getline (cin,bar);
+      if (!bar.empty()) stringstream(bar) >> ired;
+      cout << "Enter direction normal to the extracted planes (1: x; 2: y; 3: z; 0: whole field) [0]: ";
+      getline (cin,bar);
+      if (!bar.empty()) stringstream(bar) >> sdir;
+      if ((sdir >= 1) && (sdir <= 3))
+        {
+          cout << "Enter comma-separated plane indexes, starting from 0 [0]: ";
+          getline (cin,slc_list);
+        }
+    }
+
+    // Plane indexes of the slice decoding, which is done at full resolution
+    if ((sdir >= 1) && (sdir <= 3))
+    {
+      for (size_t j = 0; j < slc_list.size(); j++) if (slc_list[j] == ',') slc_list[j] = ' ';
+      islc = new int[slc_list.size()/2+2];
+      stringstream slc_stream(slc_list);
+      while (slc_stream >> islc[nslc]) nslc++;
+      if (nslc == 0) islc[nslc++] = 0;
+      ired = 0;
     }
 
     // Print out metadata
@@ -141,6 +206,15 @@ int main( int argc, char *argv[] )
     cout << "Extracted (output) data file name: " << out_name << endl;
     cout << "File type (0: Fortran sequential w 4-byte recl; 1: Fortran sequential w 8-byte recl; 2: C/C++): " << ifiletype << endl;
     if (flag_convertendian) cout << "Convert big endian to little endian or vice versa" << endl;
+    if (tol_dec > 0) cout << "Coarser reconstruction with the relative tolerance " << tol_dec << endl;
+    if (nlay_req > 0) cout << "Decode the first " << nlay_req << " bit planes" << endl;
+    if (ired > 0) cout << "Reduced resolution, skip the " << ired << " finest wavelet levels" << endl;
+    if (nslc > 0)
+      {
+        cout << "Extract " << nslc << " planes normal to the direction " << sdir << " at";
+        for (int s = 0; s < nslc; s++) cout << " " << islc[s];
+        cout << endl;
+      }
 
     /* Decoding */
     switch (ifiletype) {
@@ -189,8 +263,42 @@ int main( int argc, char *argv[] )
               // Size of the floating-point array
               ntot = (unsigned long int)(nx)*(unsigned long int)(ny)*(unsigned long int)(nz)*(unsigned long int)(nh);
 
+              // Extents of the reconstructed field, reduced by the ired finest wavelet levels. A compressed field 
+              // is reduced by its transform depth at most, an uncompressed one is subsampled
+              int nvec[3] = {nx, ny, nzh};
+              unsigned char *data_enc = NULL;
+              if (icomp)
+                {
+                  // Allocate encoded data array and read the first bit plane from file
+                  if (ntot_enc > 0)
+                    {
+                      data_enc = new unsigned char[ntot_enc];
+                      read_field_gen_enc(finput,data_enc,len_enc_vec[0]);
+                    }
+                  decoding_extents(nx,ny,nzh,ired,wlev,ntot_enc,data_enc,nvec);
+                }
+              else
+                {
+                  for (int d = 0; d < 3; d++)
+                    for (int k = 0; k < ired; k++) nvec[d] = nvec[d]/2 + nvec[d]%2;
+                }
+
+              // Extents of the extracted planes, stored as the field restricted to their indexes
+              if (nslc > 0)
+                {
+                  for (int s = 0; s < nslc; s++) if ((islc[s] < 0) || (islc[s] >= nvec[sdir-1]))
+                    {
+                      cout << "Error: slice index out of range" << endl;
+                      return 1;
+                    }
+                  nvec[sdir-1] = nslc;
+                }
+              unsigned long int ntot_r = (unsigned long int)(nvec[0])*(unsigned long int)(nvec[1])*(unsigned long int)(nvec[2]);
+              if (ired > 0) cout << "  reduced to nx=" << nvec[0] << "  ny=" << nvec[1] << "  nz=" << nvec[2] << endl;
+              if (nslc > 0) cout << "  planes of nx=" << nvec[0] << "  ny=" << nvec[1] << "  nz=" << nvec[2] << endl;
+
               // Allocate array
-              fld_1d_rec = new double[ntot];
+              fld_1d_rec = new double[ntot_r];
 
               // If compression flag is true for this field, read and reconstruct
               // Otherwise, read the original field from the file
@@ -198,21 +306,30 @@ int main( int argc, char *argv[] )
                 {
 
                   // Initialize array
-                  for (unsigned long int j=0; j<ntot; j++) fld_1d_rec[j] = midval;
+                  for (unsigned long int j=0; j<ntot_r; j++) fld_1d_rec[j] = midval;
 
                   // Reconstruct field
                   if (ntot_enc > 0)
                     {
-                      // Allocate encoded data array
-                      unsigned char *data_enc = new unsigned char[ntot_enc];
- 
-                      // Read from file
-                      read_field_gen_enc(finput,data_enc,ntot_enc);
+                      // Read only the bit planes needed for the requested precision, and skip the others. As in the 
+                      // encoder, the absolute tolerance of the CDF9/7 transform is corrected for its round-off errors, 
+                      // the integer transform estimates its error in the field units
+                      double tolreq = tol_dec*(fabs(midval)+halfspanval);
+                      if (!((data_enc[0] & ENC_FIELD_DESC) && (data_enc[2] == WAV_TYPE_CDF53))) tolreq /= WAV_ACC_COEF;
+                      unsigned char nlay_dec;
+                      unsigned long int ntot_dec;
+                      decoding_layers(tolreq,nlay_req,nlay,ntot_enc,deps_vec,len_enc_vec,data_enc,nlay_dec,ntot_dec);
+                      read_field_gen_enc(finput,data_enc+len_enc_vec[0],ntot_dec-len_enc_vec[0]);
+                      finput.seekg(ntot_enc-ntot_dec,ios::cur);
+                      if (nlay_dec < nlay) cout << "  read " << int(nlay_dec) << " of " << int(nlay) << " bit planes, " << ntot_dec << " of " << ntot_enc << " bytes" << endl;
     
                       // Apply decoding routine
                       cout << "  decoding fld_1d_rec, field number " << it << endl;
-                      decoding_wrap(nx,ny,nzh,fld_1d_rec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc);
-                      cout << "  decode: fld_1d_rec[0]=" << fld_1d_rec[0] << " fld_1d_rec[last]=" << fld_1d_rec[ntot-1UL] << endl;
+                      if (nslc > 0)
+                        decoding_slice(nx,ny,nzh,fld_1d_rec,sdir,nslc,islc,tolreq,nlay_req,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc);
+                      else
+                        decoding_wrap(nx,ny,nzh,fld_1d_rec,ired,tolreq,nlay_req,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc);
+                      cout << "  decode: fld_1d_rec[0]=" << fld_1d_rec[0] << " fld_1d_rec[last]=" << fld_1d_rec[ntot_r-1UL] << endl;
 
                       // Deallocate memory
                       delete [] data_enc;
@@ -221,13 +338,42 @@ int main( int argc, char *argv[] )
               else
                 {
                   // Read an uncompressed field
-                  read_field_gen_raw(finput,nbytes,fld_1d_rec,ntot);
+                  if (ired > 0)
+                    {
+                      // Keep every (2^ired)-th element in each direction
+                      double *fld_1d_raw = new double[ntot];
+                      read_field_gen_raw(finput,nbytes,fld_1d_raw,ntot);
+                      unsigned long int j = 0;
+                      for (int iz = 0; iz < nvec[2]; iz++)
+                        for (int iy = 0; iy < nvec[1]; iy++)
+                          for (int ix = 0; ix < nvec[0]; ix++)
+                            fld_1d_rec[j++] = fld_1d_raw[((unsigned long int)(ix) << ired) + (unsigned long int)(nx)*(((unsigned long int)(iy) << ired) + (unsigned long int)(ny)*((unsigned long int)(iz) << ired))];
+                      delete [] fld_1d_raw;
+                    }
+                  else if (nslc > 0)
+                    {
+                      // Keep the planes
+                      double *fld_1d_raw = new double[ntot];
+                      read_field_gen_raw(finput,nbytes,fld_1d_raw,ntot);
+                      unsigned long int j = 0;
+                      for (int iz = 0; iz < nvec[2]; iz++)
+                        for (int iy = 0; iy < nvec[1]; iy++)
+                          for (int ix = 0; ix < nvec[0]; ix++)
+                            {
+                              int ivec[3] = {ix, iy, iz};
+                              ivec[sdir-1] = islc[ivec[sdir-1]];
+                              fld_1d_rec[j++] = fld_1d_raw[(unsigned long int)(ivec[0]) + (unsigned long int)(nx)*((unsigned long int)(ivec[1]) + (unsigned long int)(ny)*(unsigned long int)(ivec[2]))];
+                            }
+                      delete [] fld_1d_raw;
+                    }
+                  else
+                    read_field_gen_raw(finput,nbytes,fld_1d_rec,ntot);
                 }
 
               // Calculate min and max
               double minval = fld_1d_rec[0];
               double maxval = fld_1d_rec[0];
-              for(unsigned long int j1 = 0; j1 < ntot; j1++)
+              for(unsigned long int j1 = 0; j1 < ntot_r; j1++)
                 {
                   minval = fmin(minval,fld_1d_rec[j1]);
                   maxval = fmax(maxval,fld_1d_rec[j1]);
@@ -236,11 +382,20 @@ int main( int argc, char *argv[] )
               // Echo min and max
               cout << "        min=" << minval << " max=" << maxval << endl;
 
-              // Write data in the local domain
-              write_field_gen(out_name.c_str(),it,ifiletype,flag_convertendian,nbytes,recl,nx,ny,nz,nh,idinv,fld_1d_rec);
+              // Write data in the local domain. A reduced field or the extracted planes are written as 3D, with the 
+              // record length of their size
+              if ((ired > 0) || (nslc > 0))
+                {
+                  unsigned long int lrec = (unsigned long int)(nbytes)*ntot_r;
+                  unsigned char recl_r[8];
+                  for (int j = 0; j < 8; j++) recl_r[j] = (unsigned char)(lrec >> (8*j));
+                  write_field_gen(out_name.c_str(),it,ifiletype,flag_convertendian,nbytes,recl_r,nvec[0],nvec[1],nvec[2],1,idinv,fld_1d_rec);
+                }
+              else
+                write_field_gen(out_name.c_str(),it,ifiletype,flag_convertendian,nbytes,recl,nx,ny,nz,nh,idinv,fld_1d_rec);
 
               // Diagnostics
-              cout << "  wrote: fld_1d_rec[0]=" << fld_1d_rec[0] << " fld_1d_rec[last]=" << fld_1d_rec[ntot-1UL] << endl;
+              cout << "  wrote: fld_1d_rec[0]=" << fld_1d_rec[0] << " fld_1d_rec[last]=" << fld_1d_rec[ntot_r-1UL] << endl;
 
               // Deallocate memory
               delete [] fld_1d_rec;
@@ -261,6 +416,9 @@ int main( int argc, char *argv[] )
 
     }
 
+    // Deallocate plane indexes
+    if (islc) delete [] islc;
+
     // Display a message on exit
     cout << "=== End of decompression ===\n";
 
@@ -53,6 +53,23 @@
 using namespace std;
 
 
+// Read the transform depths: "auto", one depth for all directions or three depths separated by spaces or commas;
+// a string that cannot be read gives depths beyond WAV_LVL_MAX, which are rejected before encoding
+static void read_levels(string lvl_str, int *ilvl)
+{
+    std::replace(lvl_str.begin(), lvl_str.end(), ',', ' ');
+    std::transform(lvl_str.begin(), lvl_str.end(), lvl_str.begin(), ::tolower);
+    stringstream lvl_ss(lvl_str);
+    string rest;
+    if (lvl_str.find("auto") != string::npos) 
+    {
+       lvl_ss >> rest;
+       ilvl[0] = ilvl[1] = ilvl[2] = (rest == "auto" && !(lvl_ss >> rest)) ? WAV_LVL_AUTO : WAV_LVL_MAX+1;
+    }
+    else if (!(lvl_ss >> ilvl[0])) ilvl[0] = ilvl[1] = ilvl[2] = WAV_LVL_MAX+1;
+    else if (!(lvl_ss >> ilvl[1])) ilvl[1] = ilvl[2] = ilvl[0];
+    else if (!(lvl_ss >> ilvl[2]) || (lvl_ss >> rest)) ilvl[0] = ilvl[1] = ilvl[2] = WAV_LVL_MAX+1;
+}
 
 // Main code for encoding
 int main( int argc, char *argv[] )
@@ -85,7 +102,7 @@ int main( int argc, char *argv[] )
     double *cutoffvec;
 
     // Field parameter arrays
-    int *nbytes_vec, *nx_vec, *ny_vec, *nz_vec, *nh_vec, *idinv_vec, *icomp_vec;
+    int *nbytes_vec, *nx_vec, *ny_vec, *nz_vec, *nh_vec, *idinv_vec, *icomp_vec, *iwav_vec, *ilvl_vec;
     double *tol_base_vec;
 
     // Data variable declarations
@@ -99,7 +116,9 @@ int main( int argc, char *argv[] )
     unsigned long int len_enc_vec[NLAYMAX];
 
     // I/O variable declarations
-    int ifiletype = 0, iintype = 2, idinv = 0, icomp = 1;
+    int ifiletype = 0, iintype = 2, idinv = 0, icomp = 1, iwav = WAV_TYPE_CDF97;
+    int ilvl[3] = {WAV_LVL, WAV_LVL, WAV_LVL};
+    int ibackend = ENC_BACKEND;
     string in_name = "data.bin", out_name = "data.wrb", header_name = "data.wrh";
 
     // I/O read buffer string, current position in the input file, Fortran record length
@@ -117,7 +136,7 @@ int main( int argc, char *argv[] )
     if (!ifs.fail()) //check file existence
     {
        std::string str;
-       std::string sbuf[11]; // buffer for read params
+       std::string sbuf[14]; // buffer for read params
        // read parameters from file(inmeta)
        std::cout << "==== " << file_name << " exists. ====" << std::endl;
        while (getline(ifs, str))
@@ -143,6 +162,7 @@ int main( int argc, char *argv[] )
                     if (var_name == "&file_type") { sbuf[0] = var_value;}
                     if (var_name == "&endian_conversion") { sbuf[1] = var_value;}
                     if (var_name == "&number_of_field") { sbuf[2] = var_value;}
+                    if (var_name == "&entropy_backend") { sbuf[13] = var_value;}
 
                     //std::cout << var_name << " = " << var_value << std::endl;
                 }
@@ -168,6 +188,7 @@ int main( int argc, char *argv[] )
           std::cout << "file_type = " << sbuf[0] << std::endl;
           std::cout << "endian_conversion = " << sbuf[1] << std::endl;
           std::cout << "number_of_field = " << sbuf[2] << std::endl;
+          if (!sbuf[13].empty()) std::cout << "entropy_backend = " << sbuf[13] << std::endl;
           std::cout << "" << std::endl;
           if (in_name.empty()) in_name = "data.bin";
           if (out_name.empty()) out_name = "data.wrb";
@@ -175,6 +196,7 @@ int main( int argc, char *argv[] )
           if (!sbuf[0].empty()) stringstream(sbuf[0]) >> ifiletype;
           if (!sbuf[1].empty()) stringstream(sbuf[1]) >> flag_convertendian;
           if (!sbuf[2].empty()) stringstream(sbuf[2]) >> nf;
+          if (!sbuf[13].empty() && !(stringstream(sbuf[13]) >> ibackend)) ibackend = -1;
 
        
           // Allocate arrays for the parameters of each field
@@ -185,6 +207,8 @@ int main( int argc, char *argv[] )
           nh_vec = new int[nf];
           idinv_vec = new int[nf];
           icomp_vec = new int[nf];
+          iwav_vec = new int[nf];
+          ilvl_vec = new int[3*nf];
           tol_base_vec = new double[nf];
        
           // read parameters of each field from file(inmeta)
@@ -233,6 +257,8 @@ int main( int argc, char *argv[] )
                       if (var_name == "&order") { sbuf[8] = var_value;}
                       if (var_name == "&compress") { sbuf[9] = var_value;}
                       if (var_name == "&tolerance") { sbuf[10] = var_value;}
+                      if (var_name == "&wavelet") { sbuf[11] = var_value;}
+                      if (var_name == "&levels") { sbuf[12] = var_value;}
                    }
                 }
                 if ( str_trim.at(0) == '/' )  // end of field parameters
@@ -245,6 +271,8 @@ int main( int argc, char *argv[] )
                    std::cout << "order = " << sbuf[8] << std::endl;
                    std::cout << "compress = " << sbuf[9] << std::endl;
                    std::cout << "tolerance = " << sbuf[10] << std::endl;
+                   std::cout << "wavelet = " << sbuf[11] << std::endl;
+                   std::cout << "levels = " << sbuf[12] << std::endl;
                    std::cout << "" << std::endl;
                    if (!sbuf[3].empty()) stringstream(sbuf[3]) >> iintype;
                    if (!sbuf[4].empty()) stringstream(sbuf[4]) >> nx;
@@ -254,6 +282,8 @@ int main( int argc, char *argv[] )
                    if (!sbuf[8].empty()) stringstream(sbuf[8]) >> idinv;
                    if (!sbuf[9].empty()) stringstream(sbuf[9]) >> icomp;
                    if (!sbuf[10].empty()) stringstream(sbuf[10]) >> tol_base;
+                   if (!sbuf[11].empty() && !(stringstream(sbuf[11]) >> iwav)) iwav = -1;
+                   if (!sbuf[12].empty()) read_levels(sbuf[12],ilvl);
                    if (iintype==1) nbytes = 4; else nbytes = 8;
                    // Fill the arrays of parameters for field
                    nbytes_vec[field_id] = nbytes;
@@ -263,6 +293,8 @@ int main( int argc, char *argv[] )
                    nh_vec[field_id] = nh;
                    idinv_vec[field_id] = idinv;
                    icomp_vec[field_id] = icomp;
+                   iwav_vec[field_id] = iwav;
+                   for (int d = 0; d < 3; d++) ilvl_vec[3*field_id+d] = ilvl[d];
                    tol_base_vec[field_id] = tol_base;
                 }
              }
@@ -307,6 +339,8 @@ int main( int argc, char *argv[] )
            nh_vec = new int[nf];
            idinv_vec = new int[nf];
            icomp_vec = new int[nf];
+           iwav_vec = new int[nf];
+           ilvl_vec = new int[3*nf];
            tol_base_vec = new double[nf];
        
            for (int it=0; it<nf; it++)
@@ -345,6 +379,8 @@ int main( int argc, char *argv[] )
               nh_vec[it] = nh;
               idinv_vec[it] = idinv;
               icomp_vec[it] = icomp;
+              iwav_vec[it] = iwav;
+              for (int d = 0; d < 3; d++) ilvl_vec[3*it+d] = ilvl[d];
               tol_base_vec[it] = tol_base;
            }
        }
@@ -360,6 +396,9 @@ int main( int argc, char *argv[] )
        cout << "      ENDIANFLIP=(0:no; 1:yes), NF=(how many fields, e.g. 1), PRECISION=(1:single; 2:double),\n";
        cout << "      NX=(e.g. 16), NY=(e.g. 16), NZ=(e.g. 16) and TOLERANCE=(e.g. 1.0e-16)\n";
        cout << "interactive mode if not enough arguments are passed.\n";
+       cout << "optional field keys of inmeta: &wavelet=(0: none; 1: CDF 9/7 [default]; 2: reversible integer CDF 5/3),\n";
+       cout << "      &levels=(transform depth, e.g. 4 [default], three depths, e.g. 6,5,1, or auto);\n";
+       cout << "optional global key of inmeta: &entropy_backend=(0: range coder [default]; 1: rANS; 2: none)\n";
          
        /* Prepare for encoding */
        if ( argc == 12 )
@@ -397,6 +436,8 @@ int main( int argc, char *argv[] )
            nh_vec = new int[nf];
            idinv_vec = new int[nf];
            icomp_vec = new int[nf];
+           iwav_vec = new int[nf];
+           ilvl_vec = new int[3*nf];
            // Fill the arrays of parameters in a loop
            for (int it=0; it<nf; it++)
            {
@@ -408,6 +449,8 @@ int main( int argc, char *argv[] )
              nh_vec[it] = nh;
              idinv_vec[it] = idinv;
              icomp_vec[it] = icomp;
+             iwav_vec[it] = iwav;
+             for (int d = 0; d < 3; d++) ilvl_vec[3*it+d] = ilvl[d];
           }
        }
        else
@@ -433,6 +476,9 @@ int main( int argc, char *argv[] )
           cout << "Enter the number of fields in the file, nf [1]: ";
           getline (cin,bar);
           if (!bar.empty()) stringstream(bar) >> nf;
+          cout << "Enter entropy coding backend (0: range coder; 1: rANS; 2: none) [0]: ";
+          getline (cin,bar);
+          if (!bar.empty() && !(stringstream(bar) >> ibackend)) ibackend = -1;
           // Allocate arrays for the parameters of each field
           nbytes_vec = new int[nf];
           tol_base_vec = new double[nf];
@@ -442,6 +488,8 @@ int main( int argc, char *argv[] )
           nh_vec = new int[nf];
           idinv_vec = new int[nf];
           icomp_vec = new int[nf];
+          iwav_vec = new int[nf];
+          ilvl_vec = new int[3*nf];
           // Read parameters of each field in a loop
           for (int it=0; it<nf; it++)
           {
@@ -474,12 +522,22 @@ int main( int argc, char *argv[] )
              getline (cin,bar);
              if (!bar.empty()) stringstream(bar) >> icomp;
              icomp_vec[it] = icomp;
+             iwav_vec[it] = iwav;
+             for (int d = 0; d < 3; d++) ilvl_vec[3*it+d] = ilvl[d];
              if (icomp)
              {
                 cout << "Enter base cutoff relative tolerance [1e-16]: ";
                 getline (cin,bar);
                 if (!bar.empty()) stringstream(bar) >> tol_base;
                 tol_base_vec[it] = tol_base;
+                cout << "Enter wavelet transform (0: none; 1: CDF 9/7; 2: reversible integer CDF 5/3) [1]: ";
+                getline (cin,bar);
+                if (!bar.empty() && !(stringstream(bar) >> iwav)) iwav = -1;
+                iwav_vec[it] = iwav;
+                cout << "Enter transform depth, three depths (e.g. 6,5,1) or auto [" << WAV_LVL << "]: ";
+                getline (cin,bar);
+                if (!bar.empty()) read_levels(bar,ilvl);
+                for (int d = 0; d < 3; d++) ilvl_vec[3*it+d] = ilvl[d];
              }
              else tol_base_vec[it] = 0;
           }
@@ -494,6 +552,27 @@ int main( int argc, char *argv[] )
     cout << "File type (0: Fortran sequential w 4-byte recl; 1: Fortran sequential w 8-byte recl; 2: C/C++): " << ifiletype << endl;
     if (flag_convertendian) cout << "Convert big endian to little endian or vice versa" << endl;
     cout << "Number of fields in the file, nf: " << nf << endl;
+    cout << "Entropy coding backend (0: range coder; 1: rANS; 2: none): " << ibackend << endl;
+
+    // Check the parameters of the compressed fields
+    if ((ibackend < 0) || (ibackend >= ENC_BACKEND_NUM))
+    {
+       cout << "Error: unknown entropy coding backend " << ibackend << endl;
+       return 1;
+    }
+    for (int it=0; it<nf; it++) if (icomp_vec[it])
+    {
+       if ((iwav_vec[it] < WAV_TYPE_NONE) || (iwav_vec[it] > WAV_TYPE_CDF53))
+       {
+          cout << "Error: unknown wavelet transform" << endl;
+          return 1;
+       }
+       for (int d = 0; d < 3; d++) if ((ilvl_vec[3*it+d] != WAV_LVL_AUTO) && ((ilvl_vec[3*it+d] < 0) || (ilvl_vec[3*it+d] > WAV_LVL_MAX)))
+       {
+          cout << "Error: wavelet transform depth must be between 0 and " << WAV_LVL_MAX << " or auto" << endl;
+          return 1;
+       }
+    }
 
     // Define uniform cutoff
     mx = 1;
@@ -545,6 +624,8 @@ int main( int argc, char *argv[] )
               tol_base = tol_base_vec[it];
               idinv = idinv_vec[it];
               icomp = icomp_vec[it];
+              iwav = iwav_vec[it];
+              for (int d = 0; d < 3; d++) ilvl[d] = ilvl_vec[3*it+d];
               nx = nx_vec[it];
               ny = ny_vec[it];
               nz = nz_vec[it];
@@ -586,31 +667,30 @@ int main( int argc, char *argv[] )
                 {
                   // Print compression status
                   cout << "  Compression enabled with base relative tolerance " << tol_base << endl;
+                  if (iwav == WAV_TYPE_CDF53) cout << "  Reversible integer wavelet transform" << (tol_base > 0 ? "" : ", lossless") << endl;
+
+                  // Uniform cutoff of the current field
+                  cutoffvec[0] = tol_base;
 
-                  // Allocate encoded data array (will be stored in a file)
-                  // Encoded array may be longer than the original
-                  unsigned char *data_enc = new unsigned char[SAFETY_BUFFER_FACTOR*NLAYMAX*(ntot<1024UL?1024UL:ntot)];
+                  // Open the encoded data file for appending, the encoded data are streamed into it
+                  foutput.open(out_name.c_str(), ios::binary|ios::out|ios::app);
+                  assert(foutput.is_open());
 
                   /* Do encoding */
-                  // Apply encoding routine
-                  encoding_wrap(nx,ny,nzh,fld_1d,1,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc);
+                  // Apply encoding routine, the compressed data are written to the file as they are produced
+                  encoding_wrap(nx,ny,nzh,fld_1d,iwav,ilvl,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,(void*)&foutput,write_enc_gen,ibackend);
+                  foutput.close();
 
                   // Deallocate memory
                   delete [] fld_1d;
 
-                  // Print efficient global cutoff
+                  // Print efficient global cutoff and the transform depths
                   cout << "        tolabs=" << tolabs << endl;
+                  cout << "        levels=" << ilvl[0] << " " << ilvl[1] << " " << ilvl[2] << endl;
 
-                  /* Write compressed data to a file */
+                  /* Write compression attributes */
                   // Append the header file with coding attributes
                   write_header_gen_enc(header_name.c_str(),it,&nbytes,recl,&nx,&ny,&nz,&nh,&idinv,&icomp,&tol_base,&tolabs,&midval,&halfspanval,&wlev,&nlay,&ntot_enc,deps_vec,minval_vec,len_enc_vec);
-
-                  // Write data if the compressed data set is non-trivial
-                  if (ntot_enc > 0)
-                      write_field_gen_enc(out_name.c_str(),data_enc,ntot_enc);
-
-                  // Deallocate memory
-                  delete [] data_enc;
                 }
               else
                 {
@@ -647,6 +727,8 @@ int main( int argc, char *argv[] )
     delete [] nh_vec;
     delete [] idinv_vec;
     delete [] icomp_vec;
+    delete [] iwav_vec;
+    delete [] ilvl_vec;
 
     // Display a message on exit
     cout << "=== End of compression ===\n";
@@ -39,6 +39,8 @@ void write_field_mssg( const char *filename, int flag_convertendian, int nbytes,
 void read_field_mssg( const char *filename, int flag_convertendian, int nbytes, int idset, int nx, int ny, int nz, int nxloc, int nyloc, int ixst, int iyst, double *fld );
 /* Write unsigned char type data set */
 void write_field_mssg_enc( const char *filename, unsigned char *fld, unsigned long int ntot_enc );
+/* Append a piece of the encoded data to an open file, ctx is the std::ofstream (sink for encoding_wrap) */
+void write_enc_mssg( void *ctx, const unsigned char *buf, unsigned long int len );
 /* Read unsigned char type data set */
 void read_field_mssg_enc( std::ifstream &inputfile, unsigned char *fld, unsigned long int ntot_enc );
 /* Write encoding header file */
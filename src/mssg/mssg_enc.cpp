@@ -350,43 +350,35 @@ int main( int argc, char *argv[] )
                   // Print masking info
                   cout << " Masking detected, padding with fld_pad=" << fld_pad << ", mask min=" << minval << endl;
 
-                  // Allocate encoded data array (will be stored in a file)
-                  // Encoded array may be longer than the original
-                  unsigned char *data_enc = new unsigned char[SAFETY_BUFFER_FACTOR*NLAYMAX*(ntot<1024UL?1024UL:ntot)];
-
                   // Tolerance of the mask function encoding
                   double *cutoffvecmask = new double[1];
                   cutoffvecmask[0] = MSSG_MASK_TOLREL; 
 
-                  // Apply encoding routine to the mask
-                  encoding_wrap(nx,ny,nz,mask_1d,0,mx,my,mz,cutoffvecmask,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc);
+                  // Apply encoding routine to the mask, the compressed mask is appended to the encoded data file
+                  int lvlmask[3] = {WAV_LVL, WAV_LVL, WAV_LVL};
+                  foutput.open(out_name.c_str(), ios::binary|ios::out|ios::app);
+                  assert(foutput.is_open());
+                  encoding_wrap(nx,ny,nz,mask_1d,0,lvlmask,mx,my,mz,cutoffvecmask,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,(void*)&foutput,write_enc_mssg);
+                  foutput.close();
 
                   // Deallocate memory
                   delete [] mask_1d;
                   delete [] cutoffvecmask;
 
-                  // Write compressed mask to a file
-                  // Append the header file with coding attributes
+                  // Append the header file with coding attributes of the mask
                   write_header_mssg_enc(header_name.c_str(),it,"mask",&tolabs,&midval,&halfspanval,&wlev,&nlay,&ntot_enc,deps_vec,minval_vec,len_enc_vec);
-  
-                  // Write data if the compressed data set is non-trivial
-                  if (ntot_enc > 0)
-                      write_field_mssg_enc(out_name.c_str(),data_enc,ntot_enc);
 
                   // Text output
                   cout << " Mask done, encoding the main field..." << endl;
-
-                  // Deallocate memory
-                  delete [] data_enc;
                 }
 
-              // Allocate encoded data array (will be stored in a file)
-              // Encoded array may be longer than the original
-              unsigned char *data_enc = new unsigned char[SAFETY_BUFFER_FACTOR*NLAYMAX*(ntot<1024UL?1024UL:ntot)];
-
               /* Do encoding */
-              // Apply encoding routine
-              encoding_wrap(nx,ny,nz,fld_1d,1,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc);
+              // Apply encoding routine, the compressed data are appended to the encoded data file as they are produced
+              int lvlvec[3] = {WAV_LVL, WAV_LVL, WAV_LVL};
+              foutput.open(out_name.c_str(), ios::binary|ios::out|ios::app);
+              assert(foutput.is_open());
+              encoding_wrap(nx,ny,nz,fld_1d,1,lvlvec,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,(void*)&foutput,write_enc_mssg);
+              foutput.close();
 
               // Print efficient global cutoff
               cout << "        tolabs=" << tolabs << endl;
@@ -394,16 +386,9 @@ int main( int argc, char *argv[] )
               // Deallocate memory
               delete [] fld_1d;
 
-              /* Write compressed data to a file */
+              /* Write compression attributes */
               // Append the header file with coding attributes
               write_header_mssg_enc(header_name.c_str(),it,dsetname,&tolabs,&midval,&halfspanval,&wlev,&nlay,&ntot_enc,deps_vec,minval_vec,len_enc_vec);
-  
-              // Write data if the compressed data set is non-trivial
-              if (ntot_enc > 0)
-                  write_field_mssg_enc(out_name.c_str(),data_enc,ntot_enc);
-
-              // Deallocate memory
-              delete [] data_enc;
             }
 
           break;
@@ -568,16 +553,16 @@ int main( int argc, char *argv[] )
             // Print min and max
             cout << "        min=" << minval << " max=" << maxval << endl;
 
-            // Allocate encoded data array (will be stored in a file)
-            // Encoded array may be longer than the original
-            unsigned char *data_enc = new unsigned char[SAFETY_BUFFER_FACTOR*NLAYMAX*(ntot<1024UL?1024UL:ntot)];
-
             /* Do encoding */
-            // Apply encoding routine
+            // Apply encoding routine, the compressed data are appended to the encoded data file as they are produced
+            int lvlvec[3] = {WAV_LVL, WAV_LVL, WAV_LVL};
+            foutput.open(out_name.c_str(), ios::binary|ios::out|ios::app);
+            assert(foutput.is_open());
             if (ifiletype == 1)
-                encoding_wrap(nx,ny,nz,fld_1d,1,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc);
+                encoding_wrap(nx,ny,nz,fld_1d,1,lvlvec,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,(void*)&foutput,write_enc_mssg);
             else
-                encoding_wrap(nxloc,nyloc,nz,fld_1d,1,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,data_enc);
+                encoding_wrap(nxloc,nyloc,nz,fld_1d,1,lvlvec,mx,my,mz,cutoffvec,tolabs,midval,halfspanval,wlev,nlay,ntot_enc,deps_vec,minval_vec,len_enc_vec,(void*)&foutput,write_enc_mssg);
+            foutput.close();
 
             // Print efficient global cutoff
             cout << "        tolabs=" << tolabs << endl;
@@ -585,16 +570,9 @@ int main( int argc, char *argv[] )
             // Deallocate memory
             delete [] fld_1d;
 
-            /* Write compressed data to a file */
+            /* Write compression attributes */
             // Append the header file with coding attributes
             write_header_mssg_enc(header_name.c_str(),idset,dsettab[idset],&tolabs,&midval,&halfspanval,&wlev,&nlay,&ntot_enc,deps_vec,minval_vec,len_enc_vec);
-
-            // Write data if the compressed data set is non-trivial
-            if (ntot_enc > 0)
-                write_field_mssg_enc(out_name.c_str(),data_enc,ntot_enc);
-
-            // Deallocate memory
-            delete [] data_enc;
           }
           break;
         }
@@ -137,28 +137,26 @@ char coderversion[]="rangecoder 1.3 (c) 1997-2000 Michael Schindler";
 
 
 /* Read, echo and store a character from buf                 */  
+/* Bytes beyond datalen are dropped and the overflow flagged */
 static Inline unsigned char outbyte( rangecoder *rc, unsigned char buf )
 {
-#ifndef NOWARN
     if ((*rc).datapos >= (*rc).datalen) 
-    {  printf( "Error: outbyte (*rc).datalen limit exceeded\n" );
-       abort();
+    {  (*rc).overflow = 1;
+       return buf;
     }
-#endif
     (*rc).databuf[(*rc).datapos++] = buf;
     return buf;
 }
 
 
 /* Return the next stored character                          */
+/* Reading beyond datalen returns 0 and flags the overflow   */
 static Inline unsigned char inbyte( rangecoder *rc )
 {
-#ifndef NOWARN
     if ((*rc).datapos >= (*rc).datalen)
-    {  printf( "Error: inbyte (*rc).datalen limit exceeded\n" );
-       abort();
+    {  (*rc).overflow = 1;
+       return 0;
     }
-#endif
     return (*rc).databuf[(*rc).datapos++];
 }
 
@@ -366,6 +364,72 @@ unsigned short decode_short(rangecoder *rc)
 }
 
 
+#ifndef RENORM95
+/* Decode a block of n symbols with cumulative frequencies   */
+/* counts[0..256], counts[256] = tot_f, 0 < tot_f <= 1<<16   */
+/* Same as n calls of decode_culfreq and decode_update, but  */
+/* the symbol is looked up in a table indexed by the top     */
+/* DECODE_LUT_BITS of the cumulative frequency, and the      */
+/* division by tot_f is a multiplication by its reciprocal,  */
+/* or a shift as in decode_culshift if tot_f is a power of 2 */
+/* rc is the range coder to be used, out receives n symbols  */
+void decode_block( rangecoder *rc, freq *counts, unsigned char *out, freq n )
+{   unsigned char lut[1<<DECODE_LUT_BITS];
+    freq tot_f = counts[256], cf, s, b, lt_f, hi_f;
+    int shift = 0, k = CODE_BITS-1;
+    unsigned long long m;
+    code_value low, range, help = (*rc).help;
+    unsigned char buffer;
+
+    if (n == 0) return;
+
+    /* Table of the symbol containing the lowest cumulative  */
+    /* frequency b<<shift of each bucket b                   */
+    while (((tot_f-1) >> shift) >> DECODE_LUT_BITS) shift++;
+    for (b=0, s=0; (b<<shift) < tot_f; b++)
+    {   while (counts[s+1] <= (b<<shift)) s++;
+        lut[b] = (unsigned char)s;
+    }
+
+    /* range <= Top_value, then range/tot_f is exact as      */
+    /* (range*m)>>k with m = ceil(2^k/tot_f), k = 31+log2(tot_f) */
+    while (((freq)1 << (k-CODE_BITS+1)) < tot_f) k++;
+    m = (((unsigned long long)1 << k) + tot_f - 1) / tot_f;
+    if ((tot_f & (tot_f-1)) == 0)
+    {   m = 1;
+        k -= CODE_BITS-1;
+    }
+
+    low = (*rc).low;
+    range = (*rc).range;
+    buffer = (*rc).buffer;
+    for (freq i=0; i<n; i++)
+    {   while (range <= Bottom_value)   /* dec_normalize */
+        {   low = (low<<8) | ((buffer<<EXTRA_BITS)&0xff);
+            buffer = inbyte(rc);
+            low |= buffer >> (8-EXTRA_BITS);
+            range <<= 8;
+        }
+        help = (code_value)(((unsigned long long)range * m) >> k);
+        cf = low/help;
+        if (cf >= tot_f) cf = tot_f-1;
+        /* Skip symbols of zero frequency within the bucket  */
+        for (s=lut[cf>>shift]; counts[s+1]<=cf; s++);
+        /* decode_update, without a branch on the last symbol */
+        lt_f = counts[s];
+        hi_f = counts[s+1];
+        low -= help * lt_f;
+        range = (hi_f < tot_f) ? help * (hi_f-lt_f) : range - help * lt_f;
+        out[i] = (unsigned char)s;
+    }
+    (*rc).low = low;
+    (*rc).range = range;
+    (*rc).help = help;
+    (*rc).buffer = buffer;
+}
+#endif
+
+
 /* Finish decoding                                           */
 /* rc is the range coder to be used                          */
 void done_decoding( rangecoder *rc )
@@ -378,11 +442,22 @@ void init_databuf( rangecoder *rc, unsigned long int maxlen )
 {   (*rc).datalen = maxlen;
     (*rc).datapos = 0;
     (*rc).databuf = (unsigned char *)calloc(maxlen, sizeof(unsigned char) );
+    (*rc).extbuf = 0;
+    (*rc).overflow = 0;
+}
+
+/* Use caller-owned memory as the data buffer array          */
+void attach_databuf( rangecoder *rc, unsigned char *buf, unsigned long int maxlen )
+{   (*rc).datalen = maxlen;
+    (*rc).datapos = 0;
+    (*rc).databuf = buf;
+    (*rc).extbuf = 1;
+    (*rc).overflow = 0;
 }
 
-/* Deallocate the data buffer array                          */
+/* Deallocate the data buffer array, unless owned by caller  */
 void free_databuf( rangecoder *rc )
-{   free((*rc).databuf);
+{   if (!(*rc).extbuf) free((*rc).databuf);
 }
 
 /* Count number of occurances of each byte */
@@ -396,6 +471,31 @@ void countblock(int *buffer, freq length, freq *counters)
         counters[buffer[i]]++;
 }
 
+/* Scale the counts of length > 0 symbols to a total of     */
+/* 1<<shift; symbols that occur keep a count of at least 1   */
+void scalecounts(freq *counters, freq length, freq shift)
+{   freq total = (freq)1 << shift, sum = 0, big = 0, i;
+    for (i=0; i<256; i++)
+    {   if (counters[i])
+        {   freq c = (freq)(((unsigned long long)counters[i] * total + length/2) / length);
+            counters[i] = c ? c : 1;
+        }
+        sum += counters[i];
+        if (counters[i] > counters[big]) big = i;
+    }
+    /* Add the rounding deficit to the most frequent symbol, */
+    /* or take the excess from the most frequent symbols     */
+    if (sum < total) counters[big] += total - sum;
+    while (sum > total)
+    {   freq take = counters[big] - 1;
+        if (take > sum - total) take = sum - total;
+        counters[big] -= take;
+        sum -= take;
+        for (i=0; i<256; i++)
+            if (counters[i] > counters[big]) big = i;
+    }
+}
+
 /* Decode the frequencies */
 void readcounts(rangecoder *rc, freq *counters)
 {   freq i;
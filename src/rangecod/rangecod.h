@@ -128,6 +128,8 @@ typedef struct {
     unsigned char *databuf;
     unsigned long int datalen,
                       datapos;
+    unsigned char extbuf;   /* data buffer is owned by the caller */
+    unsigned char overflow; /* set if datalen was exceeded */
 } rangecoder;
 
 
@@ -188,6 +190,14 @@ unsigned char decode_byte(rangecoder *rc);
 unsigned short decode_short(rangecoder *rc);
 
 
+/* Decode a block of n symbols using a table lookup          */
+/* rc is the range coder to be used                          */
+/* counts are the culmulative frequencies                    */
+/* out receives the n decoded symbols                        */
+#define DECODE_LUT_BITS 12
+void decode_block( rangecoder *rc, freq *counts, unsigned char *out, freq n );
+
+
 /* Finish decoding                                           */
 /* rc is the range coder to be used                          */
 void done_decoding( rangecoder *rc );
@@ -195,12 +205,19 @@ void done_decoding( rangecoder *rc );
 /* Set up the data buffer array                              */
 void init_databuf( rangecoder *rc, unsigned long int maxlen );
 
+/* Use caller-owned memory of length maxlen as the data      */
+/* buffer, the coder writes into or reads from it directly   */
+void attach_databuf( rangecoder *rc, unsigned char *buf, unsigned long int maxlen );
+
 /* Deallocate the data buffer array                          */
 void free_databuf( rangecoder *rc );
 
 /* Count number of occurances of each byte */
 void countblock(int *buffer, freq length, freq *counters);
 
+/* Scale the counts to a total of 1<<shift */
+void scalecounts(freq *counters, freq length, freq shift);
+
 /* Decode the frequencies */
 void readcounts(rangecoder *rc, freq *counters);
 
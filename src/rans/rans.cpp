@@ -0,0 +1,230 @@
+/*
+    rans.cpp : This file is part of WaveRange CFD data compression utility
+
+    Copyright (C) 2017  Dmitry Kolomenskiy
+    Copyright (C) 2017  Ryo Onishi
+    Copyright (C) 2017  JAMSTEC
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  
+    Reference:
+    doc/cfdproc2017.pdf
+    Dmitry Kolomenskiy, Ryo Onishi and Hitoshi Uehara "Wavelet-Based Compression of CFD Big Data"
+    Proceedings of the 31st Computational Fluid Dynamics Symposium, Kyoto, December 12-14, 2017
+    Paper No. C08-1
+
+    This work is supported by the FLAGSHIP2020, MEXT within the priority study4 
+    (Advancement of meteorological and global environmental predictions utilizing 
+    observational “Big Data”).
+
+    Interleaved static rANS entropy coder (asymmetric numeral systems, J. Duda, arXiv:1311.2540)
+*/
+
+#include <string.h>
+#include "rans.h"
+
+/* The coder state is kept in [RANS_L, RANS_L<<16) and renormalized in 16-bit words */
+#define RANS_L (1u << 16)
+/* Total of the scaled frequencies */
+#define RANS_TOT (1u << RANS_SCALE_BITS)
+
+
+/* Scale the counts of n > 0 symbols to a total of RANS_TOT; symbols that occur keep a frequency of at least 1 */
+static void rans_scale(unsigned int *cnt, unsigned int n)
+{
+    unsigned int sum = 0, big = 0, s;
+    for (s = 0; s < 256; s++)
+      {
+        if (cnt[s])
+          {
+            unsigned int c = (unsigned int)(((unsigned long long)cnt[s] * RANS_TOT + n/2) / n);
+            cnt[s] = c ? c : 1;
+          }
+        sum += cnt[s];
+        if (cnt[s] > cnt[big]) big = s;
+      }
+
+    // Add the rounding deficit to the most frequent symbol, or take the excess from the most frequent symbols
+    if (sum < RANS_TOT) cnt[big] += RANS_TOT - sum;
+    while (sum > RANS_TOT)
+      {
+        unsigned int take = cnt[big] - 1;
+        if (take > sum - RANS_TOT) take = sum - RANS_TOT;
+        cnt[big] -= take;
+        sum -= take;
+        for (s = 0; s < 256; s++)
+          if (cnt[s] > cnt[big]) big = s;
+      }
+}
+
+
+/* Write the frequency table: a 256-bit map of the symbols that occur, then freq-1 of each of them in one byte 
+   if below 128, otherwise in two bytes with the high bit set. Returns the length, or 0 if it does not fit */
+static unsigned long int rans_put_freqs(const unsigned int *freq, unsigned char *out, unsigned long int maxlen)
+{
+    unsigned long int pos = 32;
+    if (maxlen < pos) return 0;
+    memset(out,0,32);
+    for (unsigned int s = 0; s < 256; s++)
+      if (freq[s])
+        {
+          unsigned int v = freq[s] - 1;
+          if (pos + 2 > maxlen) return 0;
+          out[s>>3] |= (unsigned char)(1 << (s&7));
+          if (v < 128) 
+            out[pos++] = (unsigned char)v;
+          else
+            {
+              out[pos++] = (unsigned char)(0x80 | (v >> 8));
+              out[pos++] = (unsigned char)(v & 0xff);
+            }
+        }
+    return pos;
+}
+
+/* Read the frequency table. Returns its length, or 0 if it is truncated or the frequencies do not sum up to 
+   RANS_TOT */
+static unsigned long int rans_get_freqs(const unsigned char *in, unsigned long int len, unsigned int *freq)
+{
+    unsigned long int pos = 32;
+    unsigned int sum = 0;
+    if (len < pos) return 0;
+    for (unsigned int s = 0; s < 256; s++)
+      {
+        freq[s] = 0;
+        if (in[s>>3] & (1 << (s&7)))
+          {
+            if (pos >= len) return 0;
+            unsigned int v = in[pos++];
+            if (v & 0x80)
+              {
+                if (pos >= len) return 0;
+                v = ((v & 0x7f) << 8) | in[pos++];
+              }
+            freq[s] = v + 1;
+            sum += freq[s];
+          }
+      }
+    return (sum == RANS_TOT) ? pos : 0;
+}
+
+
+/* Encode a block of n symbols with static frequencies */
+unsigned long int rans_encode_block(const unsigned char *in, unsigned int n, unsigned char *out, unsigned long int maxlen)
+{
+    unsigned int freq[256], start[256], x[RANS_WAYS];
+    unsigned long int hlen, pos;
+    unsigned int i, j, s;
+
+    // Statistics of the block, scaled to the total RANS_TOT
+    memset(freq,0,sizeof(freq));
+    for (i = 0; i < n; i++) freq[in[i]]++;
+    rans_scale(freq,n);
+    hlen = rans_put_freqs(freq,out,maxlen);
+    if (hlen == 0) return 0;
+    for (s = 0, start[0] = 0; s < 255; s++) start[s+1] = start[s] + freq[s];
+
+    // Encode backwards, since the decoder runs forwards. The words are written downwards from the end of out
+    for (j = 0; j < RANS_WAYS; j++) x[j] = RANS_L;
+    pos = maxlen;
+    for (i = n; i-- > 0; )
+      {
+        unsigned int& xj = x[i % RANS_WAYS];
+        unsigned int f = freq[in[i]];
+        // Renormalize such that the coded state stays below RANS_L<<16
+        if ((unsigned long long)xj >= ((unsigned long long)f << (32 - RANS_SCALE_BITS)))
+          {
+            if (pos < hlen + 4*RANS_WAYS + 2) return 0;
+            pos -= 2;
+            out[pos] = (unsigned char)(xj & 0xff);
+            out[pos+1] = (unsigned char)((xj >> 8) & 0xff);
+            xj >>= 16;
+          }
+        xj = ((xj / f) << RANS_SCALE_BITS) + (xj % f) + start[in[i]];
+      }
+
+    // Final states follow the frequency table, then the words
+    if (pos < hlen + 4*RANS_WAYS) return 0;
+    for (j = 0; j < RANS_WAYS; j++)
+      for (s = 0; s < 4; s++) out[hlen+4*j+s] = (unsigned char)(x[j] >> (8*s));
+    memmove(out+hlen+4*RANS_WAYS,out+pos,maxlen-pos);
+    return hlen + 4*RANS_WAYS + (maxlen-pos);
+}
+
+
+/* Decode a block of n symbols */
+unsigned long int rans_decode_block(const unsigned char *in, unsigned long int len, unsigned char *out, unsigned int n)
+{
+    unsigned int freq[256], tab[RANS_TOT], x[RANS_WAYS];
+    unsigned char sym[RANS_TOT];
+    unsigned long int hlen;
+    unsigned int i, j, s, k, slot;
+
+    // Frequency table
+    hlen = rans_get_freqs(in,len,freq);
+    if ((hlen == 0) || (hlen + 4*RANS_WAYS > len)) return 0;
+
+    // Decoding table: symbol, and frequency with the offset in the symbol interval of every slot
+    for (s = 0, slot = 0; s < 256; s++)
+      for (k = 0; k < freq[s]; k++, slot++)
+        {
+          sym[slot] = (unsigned char)s;
+          tab[slot] = (freq[s] << 16) | k;
+        }
+
+    // Initial states
+    for (j = 0; j < RANS_WAYS; j++)
+      {
+        x[j] = 0;
+        for (s = 0; s < 4; s++) x[j] |= (unsigned int)(in[hlen+4*j+s]) << (8*s);
+        if (x[j] < RANS_L) return 0;
+      }
+    const unsigned char *p = in + hlen + 4*RANS_WAYS, *end = in + len;
+
+    // Decode RANS_WAYS symbols at a time with independent states. The length of the data is only checked when less 
+    // than the words of a whole step are left
+    for (i = 0; (i + RANS_WAYS <= n) && (end - p >= 2*RANS_WAYS); i += RANS_WAYS)
+      for (j = 0; j < RANS_WAYS; j++)
+        {
+          slot = x[j] & (RANS_TOT - 1);
+          out[i+j] = sym[slot];
+          x[j] = (tab[slot] >> 16) * (x[j] >> RANS_SCALE_BITS) + (tab[slot] & 0xffff);
+          if (x[j] < RANS_L)
+            {
+              x[j] = (x[j] << 16) | p[0] | ((unsigned int)(p[1]) << 8);
+              p += 2;
+            }
+        }
+    for (; i < n; i += RANS_WAYS)
+      {
+        unsigned int m = (n - i < RANS_WAYS) ? n - i : RANS_WAYS;
+        for (j = 0; j < m; j++)
+          {
+            slot = x[j] & (RANS_TOT - 1);
+            out[i+j] = sym[slot];
+            x[j] = (tab[slot] >> 16) * (x[j] >> RANS_SCALE_BITS) + (tab[slot] & 0xffff);
+            if (x[j] < RANS_L)
+              {
+                if (p + 2 > end) return 0;
+                x[j] = (x[j] << 16) | p[0] | ((unsigned int)(p[1]) << 8);
+                p += 2;
+              }
+          }
+      }
+
+    // The states return to their initial value at the end of a consistent block
+    for (j = 0; j < RANS_WAYS; j++)
+      if (x[j] != RANS_L) return 0;
+    return (unsigned long int)(p - in);
+}
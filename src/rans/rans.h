@@ -0,0 +1,53 @@
+/*
+    rans.h : This file is part of WaveRange CFD data compression utility
+
+    Copyright (C) 2017  Dmitry Kolomenskiy
+    Copyright (C) 2017  Ryo Onishi
+    Copyright (C) 2017  JAMSTEC
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  
+    Reference:
+    doc/cfdproc2017.pdf
+    Dmitry Kolomenskiy, Ryo Onishi and Hitoshi Uehara "Wavelet-Based Compression of CFD Big Data"
+    Proceedings of the 31st Computational Fluid Dynamics Symposium, Kyoto, December 12-14, 2017
+    Paper No. C08-1
+
+    This work is supported by the FLAGSHIP2020, MEXT within the priority study4 
+    (Advancement of meteorological and global environmental predictions utilizing 
+    observational “Big Data”).
+
+    Interleaved static rANS entropy coder (asymmetric numeral systems, J. Duda, arXiv:1311.2540)
+*/
+
+#ifndef rans_h
+#define rans_h
+
+/* Probability scale: the frequencies of every block sum up to 1<<RANS_SCALE_BITS */
+#define RANS_SCALE_BITS 12
+/* Number of interleaved coder states, symbol i of a block is coded by state i%RANS_WAYS */
+#define RANS_WAYS 4
+/* Largest number of symbols in a block */
+#define RANS_BLOCK_MAX 65535
+
+/* Encode a block of n symbols from in with static frequencies (1 <= n <= RANS_BLOCK_MAX). The encoded block is 
+   [symbol presence bitmap][frequencies][RANS_WAYS final states][16-bit words] and is written to out, which has 
+   room for maxlen bytes. Returns the number of bytes written, or 0 if the block does not fit */
+unsigned long int rans_encode_block(const unsigned char *in, unsigned int n, unsigned char *out, unsigned long int maxlen);
+
+/* Decode a block of n symbols from in, which holds len bytes, into out. Returns the number of bytes consumed, 
+   or 0 if the encoded block is inconsistent or truncated */
+unsigned long int rans_decode_block(const unsigned char *in, unsigned long int len, unsigned char *out, unsigned int n);
+
+#endif
@@ -0,0 +1,236 @@
+/*
+    waveletcdf53_3d.cpp : This file is part of WaveRange CFD data compression utility
+
+    Copyright (C) 2017  Dmitry Kolomenskiy
+    Copyright (C) 2017  Ryo Onishi
+    Copyright (C) 2017  JAMSTEC
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  
+    Reference:
+    doc/cfdproc2017.pdf
+    Dmitry Kolomenskiy, Ryo Onishi and Hitoshi Uehara "Wavelet-Based Compression of CFD Big Data"
+    Proceedings of the 31st Computational Fluid Dynamics Symposium, Kyoto, December 12-14, 2017
+    Paper No. C08-1
+
+    This work is supported by the FLAGSHIP2020, MEXT within the priority study4 
+    (Advancement of meteorological and global environmental predictions utilizing 
+    observational “Big Data”).
+
+    Reversible integer CDF5/3 (LeGall) lifting wavelet transform
+*/
+
+#include "../core/defs.h"
+#include "waveletcdf53_3d.h"
+
+
+/* Prediction floor((a+b)/2) and update floor((a+b+2)/4) of two's complement integers, wrapped modulo 2^64 */
+static inline unsigned long int cdf53_pred(unsigned long int a, unsigned long int b) { return (unsigned long int)((long int)(a+b) >> 1); }
+static inline unsigned long int cdf53_updt(unsigned long int a, unsigned long int b) { return (unsigned long int)((long int)(a+b+2UL) >> 2); }
+
+
+/* Forward CDF5/3 lifting of P interleaved lines of length N held in V: element i of line p is V[i*P+p] */
+template <unsigned long int P>
+static void cdf53_fwd_lines(unsigned long int N, unsigned long int *V, unsigned long int *V0, unsigned long int *V1)
+{
+  // Indexes
+  unsigned long int i, p;
+
+  // Low-pass and high-pass filtered vector lengths
+  unsigned long int M = (N/2UL) + ( (N%2UL) > 0UL ? 1UL : 0UL );
+  unsigned long int K = N-M;
+
+  // Row pointers
+  unsigned long int *W0, *W1, *Wn;
+
+  // Initialize low-pass and high-pass filtered vectors
+  for (i = 0; i < M; i++)
+    {
+      W0 = V0 + i*P;
+      W1 = V1 + i*P;
+      for (p = 0; p < P; p++) W0[p] = V[2UL*i*P+p];
+      if (i < K) for (p = 0; p < P; p++) W1[p] = V[(2UL*i+1UL)*P+p];
+    }
+
+  // Prediction, the right boundary is extended symmetrically
+  for (i = 0; i < K; i++)
+    {
+      W0 = V0 + i*P; Wn = (i+1UL < M) ? W0 + P : W0; W1 = V1 + i*P;
+      for (p = 0; p < P; p++) W1[p] -= cdf53_pred(W0[p],Wn[p]);
+    }
+
+  // Update, both boundaries are extended symmetrically
+  for (i = 0; i < M; i++)
+    {
+      W0 = V0 + i*P; W1 = V1 + (i < K ? i : K-1UL)*P; Wn = V1 + (i > 0UL ? i-1UL : 0UL)*P;
+      for (p = 0; p < P; p++) W0[p] += cdf53_updt(Wn[p],W1[p]);
+    }
+
+  // Concatenate low-pass and high-pass vectors
+  for (i = 0; i < M*P; i++) V[i] = V0[i];
+  for (i = 0; i < K*P; i++) V[M*P+i] = V1[i];
+}
+
+
+/* Inverse CDF5/3 lifting of P interleaved lines of length N held in V: element i of line p is V[i*P+p] */
+template <unsigned long int P>
+static void cdf53_inv_lines(unsigned long int N, unsigned long int *V, unsigned long int *V0, unsigned long int *V1)
+{
+  // Indexes
+  unsigned long int i, p;
+
+  // Low-pass and high-pass filtered vector lengths
+  unsigned long int M = (N/2UL) + ( (N%2UL) > 0UL ? 1UL : 0UL );
+  unsigned long int K = N-M;
+
+  // Row pointers
+  unsigned long int *W0, *W1, *Wn;
+
+  // Initialize low-pass and high-pass filtered vectors
+  for (i = 0; i < M*P; i++) V0[i] = V[i];
+  for (i = 0; i < K*P; i++) V1[i] = V[M*P+i];
+
+  // Undo the update
+  for (i = 0; i < M; i++)
+    {
+      W0 = V0 + i*P; W1 = V1 + (i < K ? i : K-1UL)*P; Wn = V1 + (i > 0UL ? i-1UL : 0UL)*P;
+      for (p = 0; p < P; p++) W0[p] -= cdf53_updt(Wn[p],W1[p]);
+    }
+
+  // Undo the prediction
+  for (i = 0; i < K; i++)
+    {
+      W0 = V0 + i*P; Wn = (i+1UL < M) ? W0 + P : W0; W1 = V1 + i*P;
+      for (p = 0; p < P; p++) W1[p] += cdf53_pred(W0[p],Wn[p]);
+    }
+
+  // Interleave low-pass and high-pass vectors
+  for (i = 0; i < M; i++)
+    {
+      W0 = V0 + i*P;
+      W1 = V1 + i*P;
+      for (p = 0; p < P; p++) V[2UL*i*P+p] = W0[p];
+      if (i < K) for (p = 0; p < P; p++) V[(2UL*i+1UL)*P+p] = W1[p];
+    }
+}
+
+
+/* Three-dimensional reversible integer wavelet transform using CDF5/3 wavelets */
+void waveletcdf53_3d(int N1in, int N2in, int N3in, int lvlin, unsigned long int *X)
+{
+  waveletcdf53_3d(N1in, N2in, N3in, lvlin, lvlin, lvlin, X);
+}
+
+
+/* Three-dimensional reversible integer wavelet transform using CDF5/3 wavelets with a separate depth in each direction */
+void waveletcdf53_3d(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, unsigned long int *X)
+{
+  // Number of lines lifted together
+  const unsigned long int P = WAV_PANEL;
+
+  // Initialize data size to input values
+  const unsigned long int N1L = (unsigned long int)(N1in);
+  const unsigned long int N2L = (unsigned long int)(N2in);
+  const unsigned long int N3L = (unsigned long int)(N3in);
+  const unsigned long int N1N2L = N1L*N2L;
+
+  // Inverse transform if any of the depths is negative
+  const int inv = (lvl1in < 0) || (lvl2in < 0) || (lvl3in < 0);
+  const int lvl1 = (lvl1in < 0) ? -lvl1in : lvl1in;
+  const int lvl2 = (lvl2in < 0) ? -lvl2in : lvl2in;
+  const int lvl3 = (lvl3in < 0) ? -lvl3in : lvl3in;
+
+  // Total number of levels
+  int nlvl = lvl1;
+  if (lvl2 > nlvl) nlvl = lvl2;
+  if (lvl3 > nlvl) nlvl = lvl3;
+
+  // Largest array extent, determines the size of the temporary panels
+  unsigned long int NmaxL = N1L;
+  if (N2L > NmaxL) NmaxL = N2L;
+  if (N3L > NmaxL) NmaxL = N3L;
+
+  // All lines of one direction at one level are independent, they are distributed between the threads
+  #pragma omp parallel
+  {
+    // Indexes
+    int k, kd, kk, id, dir, lvld;
+    unsigned long int i, j, p, np, N1, N2, N3, N, S, Na, Nb, Sa, Sb, npan;
+
+    // Offsets of the lines gathered in a panel
+    unsigned long int ioff[WAV_PANEL];
+
+    // Temporary panels of this thread, allocated once for all directions and levels
+    unsigned long int *V = (unsigned long int*) calloc(NmaxL*P,sizeof(unsigned long int));
+    unsigned long int *V0 = (unsigned long int*) calloc((NmaxL/2UL+1UL)*P,sizeof(unsigned long int));
+    unsigned long int *V1 = (unsigned long int*) calloc((NmaxL/2UL+1UL)*P,sizeof(unsigned long int));
+
+    // Loop over the levels, the forward transform goes from fine to coarse, the inverse from coarse to fine
+    for (kd = 0; kd < nlvl; kd++)
+      {
+        // Array extents at this level, the directions with fewer levels keep the extents of their last level
+        k = inv ? nlvl-1-kd : kd;
+        N1 = N1L; N2 = N2L; N3 = N3L;
+        for (kk = 0; kk < k; kk++)
+          {
+            if (kk < lvl1) N1 = (N1/2UL) + ( (N1%2UL) > 0UL ? 1UL : 0UL );
+            if (kk < lvl2) N2 = (N2/2UL) + ( (N2%2UL) > 0UL ? 1UL : 0UL );
+            if (kk < lvl3) N3 = (N3/2UL) + ( (N3%2UL) > 0UL ? 1UL : 0UL );
+          }
+
+        // Loop over the three directions, in reverse order for the inverse transform
+        for (id = 0; id < 3; id++)
+          {
+            dir = inv ? 2-id : id;
+
+            // Extent and stride in the transform direction, extents and strides of the remaining two directions
+            if (dir == 0) { N = N1; S = 1UL; Na = N2; Sa = N1L; Nb = N3; Sb = N1N2L; lvld = lvl1; }
+            else if (dir == 1) { N = N2; S = N1L; Na = N1; Sa = 1UL; Nb = N3; Sb = N1N2L; lvld = lvl2; }
+            else { N = N3; S = N1N2L; Na = N1; Sa = 1UL; Nb = N2; Sb = N1L; lvld = lvl3; }
+
+            // This direction is transformed at this level, and at least two elements are required
+            if ((k >= lvld) || (N < 2UL)) continue;
+
+            // Number of panels, lines are numbered contiguously in the first remaining direction
+            npan = (Na*Nb+P-1UL)/P;
+
+            // Loop over panels of P lines
+            #pragma omp for schedule(static)
+            for (j = 0; j < npan; j++)
+              {
+                // Number of lines in this panel and their offsets
+                np = (Na*Nb-j*P < P) ? Na*Nb-j*P : P;
+                for (p = 0; p < np; p++) ioff[p] = Sa*((j*P+p)%Na)+Sb*((j*P+p)/Na);
+
+                // Place data elements in a panel
+                for (i = 0; i < N; i++)
+                  for (p = 0; p < np; p++) V[i*P+p] = X[ioff[p]+S*i];
+
+                // Lifting of all lines in the panel
+                if (!inv) cdf53_fwd_lines<WAV_PANEL>(N, V, V0, V1);
+                else cdf53_inv_lines<WAV_PANEL>(N, V, V0, V1);
+
+                // Substitute the result in the 3D array
+                for (i = 0; i < N; i++)
+                  for (p = 0; p < np; p++) X[ioff[p]+S*i] = V[i*P+p];
+              }
+          }
+      }
+
+    // Deallocate panels
+    free(V1);
+    free(V0);
+    free(V); 
+  }
+}
@@ -0,0 +1,43 @@
+/*
+    waveletcdf53_3d.h : This file is part of WaveRange CFD data compression utility
+
+    Copyright (C) 2017  Dmitry Kolomenskiy
+    Copyright (C) 2017  Ryo Onishi
+    Copyright (C) 2017  JAMSTEC
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+  
+    Reference:
+    doc/cfdproc2017.pdf
+    Dmitry Kolomenskiy, Ryo Onishi and Hitoshi Uehara "Wavelet-Based Compression of CFD Big Data"
+    Proceedings of the 31st Computational Fluid Dynamics Symposium, Kyoto, December 12-14, 2017
+    Paper No. C08-1
+
+    This work is supported by the FLAGSHIP2020, MEXT within the priority study4 
+    (Advancement of meteorological and global environmental predictions utilizing 
+    observational “Big Data”).
+
+    Reversible integer CDF5/3 (LeGall) lifting wavelet transform
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Three-dimensional reversible integer wavelet transform using CDF5/3 wavelets. Lifting is performed 
+   in modulo 2^64 arithmetic, therefore the inverse transform (lvlin < 0) recovers the input exactly */
+void waveletcdf53_3d(int N1in, int N2in, int N3in, int lvlin, unsigned long int *X);
+
+/* Three-dimensional reversible integer wavelet transform using CDF5/3 wavelets with a separate depth in each direction; 
+   forward transform if all depths are non-negative, inverse transform if they are non-positive */
+void waveletcdf53_3d(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, unsigned long int *X);
@@ -31,26 +31,159 @@
     Modified from the Matlab code by Pascal Getreuer (http://www.getreuer.info/home/waveletcdf97/)
 */
 
+#include <string.h>
+
 #include "../core/defs.h"
 #include "waveletcdf97_3d.h"
 
-/* Three-dimensional wavelet transform using CDF9/7 wavelets */
+#if defined(__AVX512F__) || defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/* Row operations of the lifting scheme. A row holds element i of all P lines of a panel */
+template <typename T, unsigned long int P>
+struct lift_rows
+{
+  // Copy y = a
+  static inline void copy(T *y, const T *a) { for (unsigned long int p = 0; p < P; p++) y[p] = a[p]; }
+  // Reset y = 0
+  static inline void zero(T *y) { for (unsigned long int p = 0; p < P; p++) y[p] = 0; }
+  // Scale y = c*a
+  static inline void scale(T *y, T c, const T *a) { for (unsigned long int p = 0; p < P; p++) y[p] = a[p]*c; }
+  // Boundary update y += c*a
+  static inline void single(T *y, T c, const T *a) { for (unsigned long int p = 0; p < P; p++) y[p] += c*a[p]; }
+  // Interior update y += c*(a+b)
+  static inline void pair(T *y, T c, const T *a, const T *b) { for (unsigned long int p = 0; p < P; p++) y[p] += c*(a[p]+b[p]); }
+  // Extrapolation y = a*e0 + b*e1 + d*e2
+  static inline void extrap(T *y, const T *a, T e0, const T *b, T e1, const T *d, T e2) 
+    { for (unsigned long int p = 0; p < P; p++) y[p] = a[p]*e0 + b[p]*e1 + d[p]*e2; }
+};
+
+#if defined(__AVX512F__) || defined(__AVX__) || defined(__SSE2__)
+/* Vector registers of the widest instruction set enabled at compile time */
+template <typename T> struct simd_reg;
+
+#if defined(__AVX512F__)
+template <> struct simd_reg<double>
+{
+  typedef __m512d R;
+  static const unsigned long int W = 8;
+  static inline R load(const double *a) { return _mm512_loadu_pd(a); }
+  static inline void store(double *y, R r) { _mm512_storeu_pd(y, r); }
+  static inline R set(double c) { return _mm512_set1_pd(c); }
+  static inline R add(R a, R b) { return _mm512_add_pd(a, b); }
+  static inline R mul(R a, R b) { return _mm512_mul_pd(a, b); }
+  static inline R madd(R a, R b, R c) { return _mm512_fmadd_pd(a, b, c); }
+};
+template <> struct simd_reg<float>
+{
+  typedef __m512 R;
+  static const unsigned long int W = 16;
+  static inline R load(const float *a) { return _mm512_loadu_ps(a); }
+  static inline void store(float *y, R r) { _mm512_storeu_ps(y, r); }
+  static inline R set(float c) { return _mm512_set1_ps(c); }
+  static inline R add(R a, R b) { return _mm512_add_ps(a, b); }
+  static inline R mul(R a, R b) { return _mm512_mul_ps(a, b); }
+  static inline R madd(R a, R b, R c) { return _mm512_fmadd_ps(a, b, c); }
+};
+#elif defined(__AVX__)
+template <> struct simd_reg<double>
+{
+  typedef __m256d R;
+  static const unsigned long int W = 4;
+  static inline R load(const double *a) { return _mm256_loadu_pd(a); }
+  static inline void store(double *y, R r) { _mm256_storeu_pd(y, r); }
+  static inline R set(double c) { return _mm256_set1_pd(c); }
+  static inline R add(R a, R b) { return _mm256_add_pd(a, b); }
+  static inline R mul(R a, R b) { return _mm256_mul_pd(a, b); }
+#if defined(__FMA__)
+  static inline R madd(R a, R b, R c) { return _mm256_fmadd_pd(a, b, c); }
+#else
+  static inline R madd(R a, R b, R c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+};
+template <> struct simd_reg<float>
+{
+  typedef __m256 R;
+  static const unsigned long int W = 8;
+  static inline R load(const float *a) { return _mm256_loadu_ps(a); }
+  static inline void store(float *y, R r) { _mm256_storeu_ps(y, r); }
+  static inline R set(float c) { return _mm256_set1_ps(c); }
+  static inline R add(R a, R b) { return _mm256_add_ps(a, b); }
+  static inline R mul(R a, R b) { return _mm256_mul_ps(a, b); }
+#if defined(__FMA__)
+  static inline R madd(R a, R b, R c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+  static inline R madd(R a, R b, R c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+};
+#else
+template <> struct simd_reg<double>
+{
+  typedef __m128d R;
+  static const unsigned long int W = 2;
+  static inline R load(const double *a) { return _mm_loadu_pd(a); }
+  static inline void store(double *y, R r) { _mm_storeu_pd(y, r); }
+  static inline R set(double c) { return _mm_set1_pd(c); }
+  static inline R add(R a, R b) { return _mm_add_pd(a, b); }
+  static inline R mul(R a, R b) { return _mm_mul_pd(a, b); }
+  static inline R madd(R a, R b, R c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+};
+template <> struct simd_reg<float>
+{
+  typedef __m128 R;
+  static const unsigned long int W = 4;
+  static inline R load(const float *a) { return _mm_loadu_ps(a); }
+  static inline void store(float *y, R r) { _mm_storeu_ps(y, r); }
+  static inline R set(float c) { return _mm_set1_ps(c); }
+  static inline R add(R a, R b) { return _mm_add_ps(a, b); }
+  static inline R mul(R a, R b) { return _mm_mul_ps(a, b); }
+  static inline R madd(R a, R b, R c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+};
+#endif
+
+/* Row operations on full panels using vector registers */
 template <typename T>
-void waveletcdf97_3d(int N1in, int N2in, int N3in, int lvlin, T *X)
+struct lift_rows<T, WAV_PANEL>
 {
-  // Lifting filter coefficients
-  static const T lfc[4] = {-1.5861343420693648, -0.0529801185718856, 0.8829110755411875, 0.4435068520511142};
+  typedef simd_reg<T> S;
+  typedef typename S::R R;
+  static inline void copy(T *y, const T *a) 
+    { for (unsigned long int p = 0; p < WAV_PANEL; p += S::W) S::store(y+p, S::load(a+p)); }
+  static inline void zero(T *y) 
+    { R rz = S::set(0); for (unsigned long int p = 0; p < WAV_PANEL; p += S::W) S::store(y+p, rz); }
+  static inline void scale(T *y, T c, const T *a) 
+    { R rc = S::set(c); for (unsigned long int p = 0; p < WAV_PANEL; p += S::W) S::store(y+p, S::mul(S::load(a+p), rc)); }
+  static inline void single(T *y, T c, const T *a) 
+    { R rc = S::set(c); for (unsigned long int p = 0; p < WAV_PANEL; p += S::W) S::store(y+p, S::madd(rc, S::load(a+p), S::load(y+p))); }
+  static inline void pair(T *y, T c, const T *a, const T *b) 
+    { R rc = S::set(c); for (unsigned long int p = 0; p < WAV_PANEL; p += S::W) S::store(y+p, S::madd(rc, S::add(S::load(a+p), S::load(b+p)), S::load(y+p))); }
+  static inline void extrap(T *y, const T *a, T e0, const T *b, T e1, const T *d, T e2) 
+    { 
+      R r0 = S::set(e0), r1 = S::set(e1), r2 = S::set(e2);
+      for (unsigned long int p = 0; p < WAV_PANEL; p += S::W) 
+        S::store(y+p, S::madd(S::load(d+p), r2, S::madd(S::load(b+p), r1, S::mul(S::load(a+p), r0))));
+    }
+};
+#endif
 
-  // Scale factor
-  static const T scl = 1.1496043988602418;
-  static const T pscl = 1.0/1.1496043988602418;
 
-  // Indexes
-  int k;
-  unsigned long int i1, i2, i3, i, M1, M2, M3, M, N, Q;
+/* Lifting filter coefficients and scale factor of the CDF9/7 transform, shared by the transform of whole lines and 
+   the transform streamed along the third direction */
+static const double cdf97_lfc[4] = {-1.5861343420693648, -0.0529801185718856, 0.8829110755411875, 0.4435068520511142};
+static const double cdf97_scl = 1.1496043988602418;
 
-  // Temporary vectors
-  T *V, *V0, *V1;
+
+/* Forward CDF9/7 lifting of P interleaved lines of length N held in V: element i of line p is V[i*P+p] */
+template <typename T, unsigned long int P>
+static void cdf97_fwd_lines(unsigned long int N, T *V, T *V0, T *V1)
+{
+  // Lifting filter coefficients
+  static const T lfc[4] = {T(cdf97_lfc[0]), T(cdf97_lfc[1]), T(cdf97_lfc[2]), T(cdf97_lfc[3])};
+
+  // Scale factor
+  static const T scl = T(cdf97_scl);
+  static const T pscl = T(1.0/cdf97_scl);
 
   // Extrapolation coefficients for odd-sized arrays
   T ext[3];
@@ -58,424 +191,1108 @@ void waveletcdf97_3d(int N1in, int N2in, int N3in, int lvlin, T *X)
   ext[1] = -2*lfc[1]*lfc[2]/(1+2*lfc[1]*lfc[2]);
   ext[2] = -2*(lfc[0]+lfc[2]+3*lfc[0]*lfc[1]*lfc[2])/(1+2*lfc[1]*lfc[2]);
 
-  // Initialize data size and level to input values
-  unsigned long int N1L = (unsigned long int)(N1in);
-  unsigned long int N2L = (unsigned long int)(N2in);
-  unsigned long int N3L = (unsigned long int)(N3in);
-  unsigned long int N1 = N1L;
-  unsigned long int N2 = N2L;
-  unsigned long int N3 = N3L;
-  unsigned long int N1N2L = N1L*N2L;
-  int lvl = lvlin;
-
-  if (lvl >= 0)   
-    // Forward transform
+  // Row operations
+  typedef lift_rows<T,P> L;
+
+  // Indexes
+  unsigned long int i;
+
+  // Low-pass filtered vector length
+  unsigned long int M = (N/2UL) + ( (N%2UL) > 0UL ? 1UL : 0UL );
+
+  // Initialize low-pass and high-pass filtered vectors
+  for (i = 0; i < M; i++)
+    {
+      L::copy(V0+i*P, V+2UL*i*P);
+      if (2UL*i+1UL<N) L::copy(V1+i*P, V+(2UL*i+1UL)*P);
+    }
+
+  // Extrapolate if the vector length is odd
+  if (N%2UL) L::extrap(V1+(M-1UL)*P, V0+(M-2UL)*P, ext[0], V1+(M-2UL)*P, ext[1], V0+(M-1UL)*P, ext[2]);
+
+  // Apply the four lifting stages in a single sweep, stages 3 and 4 lag one row behind stages 1 and 2
+  for (i = 0; i < M; i++)
     {
-      for (k = 1; k <= lvl; k++)
+      // Lifting stage 1 at row i
+      if (i < M-1UL) L::pair(V1+i*P, lfc[0], V0+(i+1UL)*P, V0+i*P);
+      else L::single(V1+i*P, lfc[0]*2, V0+i*P);
+
+      // Lifting stage 2 at row i
+      if (i > 0UL) L::pair(V0+i*P, lfc[1], V1+i*P, V1+(i-1UL)*P);
+      else L::single(V0, lfc[1]*2, V1);
+
+      if (i > 0UL)
         {
-          // Low-pass filtered vector length
-          M1 = (N1/2UL) + ( (N1%2UL) > 0UL ? 1UL : 0UL );
-          M2 = (N2/2UL) + ( (N2%2UL) > 0UL ? 1UL : 0UL );
-          M3 = (N3/2UL) + ( (N3%2UL) > 0UL ? 1UL : 0UL );
+          // Lifting stage 3 at row i-1
+          L::pair(V1+(i-1UL)*P, lfc[2], V0+i*P, V0+(i-1UL)*P);
 
-          // Transform along the FIRST direction
-          // At least two elements are required
-          if (N1 > 1UL)
-            {         
-              // Array extents in the corresponding direction
-              N = N1;
-              M = M1;
-
-              // Allocate temporary vectors
-              V = (T*) malloc(N*sizeof(T));
-              V0 = (T*) malloc(M*sizeof(T));
-              V1 = (T*) malloc(M*sizeof(T));
-
-              // Loop over the remaining two directions
-              for (i3 = 0; i3 < N3; i3++)
-                for (i2 = 0; i2 < N2; i2++)
-                  {
-                    // Place data elements in a contiguous vector
-                    unsigned long int i23 = N1L*i2+N1N2L*i3;
-                    for (i1 = 0; i1 < N1; i1++) V[i1] = X[i1+i23];
+          // Lifting stage 4 at row i-1
+          if (i > 1UL) L::pair(V0+(i-1UL)*P, lfc[3], V1+(i-1UL)*P, V1+(i-2UL)*P);
+          else L::single(V0, lfc[3]*2, V1);
 
-                    // Initialize low-pass and high-pass filtered vectors
-                    for (i = 0; i < M; i++)
-                      {
-                        V0[i] = V[2UL*i];
-                        if (2UL*i+1UL<N) V1[i] = V[2UL*i+1UL];
-                      }
+          // Concatenate low-pass and high-pass vectors at row i-1
+          L::scale(V+(i-1UL)*P, scl, V0+(i-1UL)*P);
+          L::scale(V+(i-1UL+M)*P, pscl, V1+(i-1UL)*P);
+        }
+    }
+
+  // Lifting stages 3 and 4 at the last row
+  L::single(V1+(M-1UL)*P, lfc[2]*2, V0+(M-1UL)*P);
+  if (M > 1UL) L::pair(V0+(M-1UL)*P, lfc[3], V1+(M-1UL)*P, V1+(M-2UL)*P);
+  else L::single(V0, lfc[3]*2, V1);
+
+  // Concatenate low-pass and high-pass vectors at the last row
+  L::scale(V+(M-1UL)*P, scl, V0+(M-1UL)*P);
+  if (N%2UL == 0UL) L::scale(V+(2UL*M-1UL)*P, pscl, V1+(M-1UL)*P);
+}
+
+
+/* Inverse CDF9/7 lifting of P interleaved lines of length M held in V: element i of line p is V[i*P+p] */
+template <typename T, unsigned long int P>
+static void cdf97_inv_lines(unsigned long int M, T *V, T *V0, T *V1)
+{
+  // Lifting filter coefficients, negated for the inverse transform
+  static const T lfc[4] = {T(-cdf97_lfc[0]), T(-cdf97_lfc[1]), T(-cdf97_lfc[2]), T(-cdf97_lfc[3])};
+
+  // Scale factor
+  static const T scl = T(cdf97_scl);
+  static const T pscl = T(1.0/cdf97_scl);
+
+  // Row operations
+  typedef lift_rows<T,P> L;
+
+  // Indexes
+  unsigned long int i;
+
+  // Low-pass filtered vector length
+  unsigned long int Q = (M/2UL) + ( (M%2UL) > 0UL ? 1UL : 0UL );
+
+  // Initialize low-pass and high-pass filtered vectors
+  for (i = 0; i < Q; i++) L::scale(V0+i*P, pscl, V+i*P);
+  for (i = 0; i < M-Q; i++) L::scale(V1+i*P, scl, V+(i+Q)*P);
+  if (M%2UL) L::zero(V1+(Q-1UL)*P);
+
+  // Apply the four lifting stages in a single sweep, each stage lagging one row behind the previous one where needed
+  for (i = 0; i < Q; i++)
+    {
+      // Lifting stage 1 at row i
+      if (i > 0UL) L::pair(V0+i*P, lfc[3], V1+i*P, V1+(i-1UL)*P);
+      else L::single(V0, lfc[3]*2, V1);
+
+      if (i > 0UL)
+        {
+          // Lifting stage 2 at row i-1
+          L::pair(V1+(i-1UL)*P, lfc[2], V0+i*P, V0+(i-1UL)*P);
 
-                    // Extrapolate if the vector length is odd
-                    if (N%2UL) V1[M-1UL] = V0[M-2UL]*ext[0] + V1[M-2UL]*ext[1] + V0[M-1UL]*ext[2];
+          // Lifting stage 3 at row i-1
+          if (i > 1UL) L::pair(V0+(i-1UL)*P, lfc[1], V1+(i-1UL)*P, V1+(i-2UL)*P);
+          else L::single(V0, lfc[1]*2, V1);
+        }
+
+      if (i > 1UL)
+        {
+          // Lifting stage 4 at row i-2
+          L::pair(V1+(i-2UL)*P, lfc[0], V0+(i-1UL)*P, V0+(i-2UL)*P);
+
+          // Interleave low-pass and high-pass vectors at row i-2
+          L::copy(V+2UL*(i-2UL)*P, V0+(i-2UL)*P);
+          L::copy(V+(2UL*(i-2UL)+1UL)*P, V1+(i-2UL)*P);
+        }
+    }
+
+  // Lifting stages 2 and 3 at the last row
+  L::single(V1+(Q-1UL)*P, lfc[2]*2, V0+(Q-1UL)*P);
+  if (Q > 1UL) L::pair(V0+(Q-1UL)*P, lfc[1], V1+(Q-1UL)*P, V1+(Q-2UL)*P);
+  else L::single(V0, lfc[1]*2, V1);
 
-                    // Apply lifting stage 1
-                    for (i = 0; i < M-1UL; i++) V1[i] += lfc[0]*(V0[i+1UL]+V0[i]);
-                    V1[M-1UL] += lfc[0]*2*V0[M-1UL];
+  // Lifting stage 4 at the last two rows
+  if (Q > 1UL) L::pair(V1+(Q-2UL)*P, lfc[0], V0+(Q-1UL)*P, V0+(Q-2UL)*P);
+  L::single(V1+(Q-1UL)*P, lfc[0]*2, V0+(Q-1UL)*P);
 
-                    // Apply lifting stage 2
-                    V0[0] += lfc[1UL]*2*V1[0UL];
-                    for (i = 1; i < M; i++) V0[i] += lfc[1]*(V1[i]+V1[i-1UL]);
+  // Interleave low-pass and high-pass vectors at the last two rows
+  for (i = (Q > 1UL ? Q-2UL : 0UL); i < Q; i++)
+    {
+      L::copy(V+2UL*i*P, V0+i*P);
+      if (2UL*i+1UL<M) L::copy(V+(2UL*i+1UL)*P, V1+i*P);
+    }
+}
 
-                    // Apply lifting stage 3
-                    for (i = 0; i < M-1UL; i++) V1[i] += lfc[2]*(V0[i+1UL]+V0[i]);
-                    V1[M-1UL] += lfc[2]*2*V0[M-1UL];
 
-                    // Apply lifting stage 4
-                    V0[0] += lfc[3]*2*V1[0];
-                    for (i = 1; i < M; i++) V0[i] += lfc[3]*(V1[i]+V1[i-1UL]);
+/* Array extent after k low-pass filtering steps */
+static inline unsigned long int lvl_extent(unsigned long int N, int k)
+{
+  for (int kk = 0; kk < k; kk++) N = (N/2UL) + ( (N%2UL) > 0UL ? 1UL : 0UL );
+  return N;
+}
+
+
+/* Three-dimensional wavelet transform using CDF9/7 wavelets */
+template <typename T>
+void waveletcdf97_3d(int N1in, int N2in, int N3in, int lvlin, T *X)
+{
+  waveletcdf97_3d(N1in, N2in, N3in, lvlin, lvlin, lvlin, X);
+}
 
-                    // Concatenate low-pass and high-pass vectors
-                    for (i = 0; i < M; i++)
+
+/* Three-dimensional wavelet transform using CDF9/7 wavelets with a separate depth in each direction */
+template <typename T>
+void waveletcdf97_3d(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, T *X)
+{
+  // Number of lines lifted together
+  const unsigned long int P = WAV_PANEL;
+
+  // Initialize data size to input values
+  const unsigned long int N1L = (unsigned long int)(N1in);
+  const unsigned long int N2L = (unsigned long int)(N2in);
+  const unsigned long int N3L = (unsigned long int)(N3in);
+  const unsigned long int N1N2L = N1L*N2L;
+
+  // Inverse transform if any of the depths is negative
+  const int inv = (lvl1in < 0) || (lvl2in < 0) || (lvl3in < 0);
+  const int lvl1 = (lvl1in < 0) ? -lvl1in : lvl1in;
+  const int lvl2 = (lvl2in < 0) ? -lvl2in : lvl2in;
+  const int lvl3 = (lvl3in < 0) ? -lvl3in : lvl3in;
+
+  // Total number of levels
+  int lvl = lvl1;
+  if (lvl2 > lvl) lvl = lvl2;
+  if (lvl3 > lvl) lvl = lvl3;
+
+  // Largest array extent, determines the size of the temporary panels
+  unsigned long int NmaxL = N1L;
+  if (N2L > NmaxL) NmaxL = N2L;
+  if (N3L > NmaxL) NmaxL = N3L;
+
+  // All lines of one direction at one level are independent, they are distributed between the threads
+  #pragma omp parallel
+  {
+    // Indexes
+    int k;
+    unsigned long int i1, i2, i3, j, p, np, M1, M2, M3, M, N;
+
+    // Offsets of the lines gathered in a panel along the first direction
+    unsigned long int i23[WAV_PANEL];
+
+    // Temporary panels of this thread, allocated once for all directions and levels.
+    // Lifting is always applied to full panels, unused lines are initially padded by zeros 
+    // and afterwards contain finite left-over values that do not interact with the used lines
+    T *V = (T*) calloc(NmaxL*P,sizeof(T));
+    T *V0 = (T*) calloc((NmaxL/2UL+1UL)*P,sizeof(T));
+    T *V1 = (T*) calloc((NmaxL/2UL+1UL)*P,sizeof(T));
+
+    // Array extents at the current level
+    unsigned long int N1, N2, N3;
+
+    if (!inv)   
+      // Forward transform
+      {
+        for (k = 1; k <= lvl; k++)
+          {
+            // Array extents, the directions with fewer levels keep the extents of their last level
+            N1 = lvl_extent(N1L, k-1 < lvl1 ? k-1 : lvl1);
+            N2 = lvl_extent(N2L, k-1 < lvl2 ? k-1 : lvl2);
+            N3 = lvl_extent(N3L, k-1 < lvl3 ? k-1 : lvl3);
+
+            // Transform along the FIRST direction
+            // At least two elements are required
+            if ((k <= lvl1) && (N1 > 1UL))
+              {         
+                // Array extents in the corresponding direction
+                N = N1;
+
+                // Loop over the remaining two directions, P lines at a time
+                #pragma omp for schedule(static)
+                for (j = 0; j < N2*N3; j += P)
+                  {
+                    // Number of lines in this panel
+                    np = (N2*N3-j < P) ? N2*N3-j : P;
+
+                    // Place data elements in a transposed panel
+                    for (p = 0; p < np; p++)
                       {
-                        V[i] = V0[i]*scl;
-                        if (2UL*i+1UL<N) V[i+M] = V1[i]*pscl;
+                        i23[p] = N1L*((j+p)%N2)+N1N2L*((j+p)/N2);
+                        for (i1 = 0; i1 < N1; i1++) V[i1*P+p] = X[i1+i23[p]];
                       }
 
+                    // Lifting of all lines in the panel
+                    cdf97_fwd_lines<T,WAV_PANEL>(N, V, V0, V1);
+
                     // Substitute the result in the 3D array
-                    for (i1 = 0; i1 < N1; i1++) X[i1+i23] = V[i1];
+                    for (p = 0; p < np; p++)
+                      for (i1 = 0; i1 < N1; i1++) X[i1+i23[p]] = V[i1*P+p];
                   }
-
-              // Deallocate arrays
-              free(V1);
-              free(V0);
-              free(V); 
-            }
-
-          // Transform along the SECOND direction
-          // At least two elements are required
-          if (N2 > 1UL)
-            {         
-              // Array extents in the corresponding direction
-              N = N2;
-              M = M2;
-
-              // Allocate temporary vectors
-              V = (T*) malloc(N*sizeof(T));
-              V0 = (T*) malloc(M*sizeof(T));
-              V1 = (T*) malloc(M*sizeof(T));
-
-              // Loop over the remaining two directions
-              for (i3 = 0; i3 < N3; i3++)
-                for (i1 = 0; i1 < N1; i1++)
+              }
+
+            // Transform along the SECOND direction
+            // At least two elements are required
+            if ((k <= lvl2) && (N2 > 1UL))
+              {         
+                // Array extents in the corresponding direction
+                N = N2;
+
+                // Loop over the remaining two directions, P adjacent lines at a time
+                #pragma omp for schedule(static)
+                for (j = 0; j < N3*((N1+P-1UL)/P); j++)
                   {
-                    // Place data elements in a contiguous vector
+                    // First line and number of lines in this panel
+                    i1 = (j%((N1+P-1UL)/P))*P;
+                    i3 = j/((N1+P-1UL)/P);
+                    np = (N1-i1 < P) ? N1-i1 : P;
+
+                    // Place data elements in a contiguous panel
                     unsigned long int i13 = i1+N1N2L*i3;
-                    for (i2 = 0; i2 < N2; i2++) V[i2] = X[N1L*i2+i13];
+                    for (i2 = 0; i2 < N2; i2++)
+                      for (p = 0; p < np; p++) V[i2*P+p] = X[N1L*i2+i13+p];
 
-                    // Initialize low-pass and high-pass filtered vectors
-                    for (i = 0; i < M; i++)
-                      {
-                        V0[i] = V[2UL*i];
-                        if (2UL*i+1UL<N) V1[i] = V[2UL*i+1UL];
-                      }
+                    // Lifting of all lines in the panel
+                    cdf97_fwd_lines<T,WAV_PANEL>(N, V, V0, V1);
 
-                    // Extrapolate if the vector length is odd
-                    if (N%2UL) V1[M-1UL] = V0[M-2UL]*ext[0] + V1[M-2UL]*ext[1] + V0[M-1UL]*ext[2];
+                    // Substitute the result in the 3D array
+                    for (i2 = 0; i2 < N2; i2++)
+                      for (p = 0; p < np; p++) X[N1L*i2+i13+p] = V[i2*P+p];
+                  }
+              }
+
+            // Transform along the THIRD direction
+            // At least two elements are required
+            if ((k <= lvl3) && (N3 > 1UL))
+              {         
+                // Array extents in the corresponding direction
+                N = N3;
+
+                // Loop over the remaining two directions, P adjacent lines at a time
+                #pragma omp for schedule(static)
+                for (j = 0; j < N2*((N1+P-1UL)/P); j++)
+                  {
+                    // First line and number of lines in this panel
+                    i1 = (j%((N1+P-1UL)/P))*P;
+                    i2 = j/((N1+P-1UL)/P);
+                    np = (N1-i1 < P) ? N1-i1 : P;
 
-                    // Apply lifting stage 1
-                    for (i = 0; i < M-1UL; i++) V1[i] += lfc[0]*(V0[i+1UL]+V0[i]);
-                    V1[M-1] += lfc[0]*2*V0[M-1UL];
+                    // Place data elements in a contiguous panel
+                    unsigned long int i12 = i1+N1L*i2;
+                    for (i3 = 0; i3 < N3; i3++)
+                      for (p = 0; p < np; p++) V[i3*P+p] = X[i12+N1N2L*i3+p];
 
-                    // Apply lifting stage 2
-                    V0[0] += lfc[1]*2*V1[0];
-                    for (i = 1; i < M; i++) V0[i] += lfc[1]*(V1[i]+V1[i-1UL]);
+                    // Lifting of all lines in the panel
+                    cdf97_fwd_lines<T,WAV_PANEL>(N, V, V0, V1);
 
-                    // Apply lifting stage 3
-                    for (i = 0; i < M-1UL; i++) V1[i] += lfc[2]*(V0[i+1UL]+V0[i]);
-                    V1[M-1] += lfc[2]*2*V0[M-1UL];
+                    // Substitute the result in the 3D array
+                    for (i3 = 0; i3 < N3; i3++)
+                      for (p = 0; p < np; p++) X[i12+N1N2L*i3+p] = V[i3*P+p];
+                  }
+              }
+          }
+      }
+    else           
+      // Inverse transform
+      {
+        for (k = lvl; k >= 1; k--)
+          {
+            // Array extents, the directions with fewer levels keep the extents of their last level
+            M1 = lvl_extent(N1L, k-1 < lvl1 ? k-1 : lvl1);
+            M2 = lvl_extent(N2L, k-1 < lvl2 ? k-1 : lvl2);
+            M3 = lvl_extent(N3L, k-1 < lvl3 ? k-1 : lvl3);
+
+            // Inverse transform along the THIRD direction
+            // At least two elements are required
+            if ((k <= lvl3) && (M3 > 1UL))
+              {         
+                // Array extents in the corresponding direction
+                M = M3;
+
+                // Loop over the remaining two directions, P adjacent lines at a time
+                #pragma omp for schedule(static)
+                for (j = 0; j < M2*((M1+P-1UL)/P); j++)
+                  {
+                    // First line and number of lines in this panel
+                    i1 = (j%((M1+P-1UL)/P))*P;
+                    i2 = j/((M1+P-1UL)/P);
+                    np = (M1-i1 < P) ? M1-i1 : P;
 
-                    // Apply lifting stage 4
-                    V0[0] += lfc[3]*2*V1[0];
-                    for (i = 1; i < M; i++) V0[i] += lfc[3]*(V1[i]+V1[i-1UL]);
+                    // Place data elements in a contiguous panel
+                    unsigned long int i12 = i1+N1L*i2;
+                    for (i3 = 0; i3 < M3; i3++)
+                      for (p = 0; p < np; p++) V[i3*P+p] = X[i12+N1N2L*i3+p];
 
-                    // Concatenate low-pass and high-pass vectors
-                    for (i = 0; i < M; i++)
-                      {
-                        V[i] = V0[i]*scl;
-                        if (2UL*i+1UL<N) V[i+M] = V1[i]*pscl;
-                      }
+                    // Inverse lifting of all lines in the panel
+                    cdf97_inv_lines<T,WAV_PANEL>(M, V, V0, V1);
 
                     // Substitute the result in the 3D array
-                    for (i2 = 0; i2 < N2; i2++) X[N1L*i2+i13] = V[i2];
+                    for (i3 = 0; i3 < M3; i3++)
+                      for (p = 0; p < np; p++) X[i12+N1N2L*i3+p] = V[i3*P+p];
                   }
+              }
+
+            // Inverse transform along the SECOND direction
+            // At least two elements are required
+            if ((k <= lvl2) && (M2 > 1UL))
+              {         
+                // Array extents in the corresponding direction
+                M = M2;
+
+                // Loop over the remaining two directions, P adjacent lines at a time
+                #pragma omp for schedule(static)
+                for (j = 0; j < M3*((M1+P-1UL)/P); j++)
+                  {
+                    // First line and number of lines in this panel
+                    i1 = (j%((M1+P-1UL)/P))*P;
+                    i3 = j/((M1+P-1UL)/P);
+                    np = (M1-i1 < P) ? M1-i1 : P;
 
-              // Deallocate arrays
-              free(V1);
-              free(V0);
-              free(V); 
-            }
+                    // Place data elements in a contiguous panel
+                    unsigned long int i13 = i1+N1N2L*i3;
+                    for (i2 = 0; i2 < M2; i2++)
+                      for (p = 0; p < np; p++) V[i2*P+p] = X[N1L*i2+i13+p];
 
-          // Transform along the THIRD direction
-          // At least two elements are required
-          if (N3 > 1UL)
-            {         
-              // Array extents in the corresponding direction
-              N = N3;
-              M = M3;
-
-              // Allocate temporary vectors
-              V = (T*) malloc(N*sizeof(T));
-              V0 = (T*) malloc(M*sizeof(T));
-              V1 = (T*) malloc(M*sizeof(T));
-
-              // Loop over the remaining two directions
-              for (i2 = 0; i2 < N2; i2++)
-                for (i1 = 0; i1 < N1; i1++)
+                    // Inverse lifting of all lines in the panel
+                    cdf97_inv_lines<T,WAV_PANEL>(M, V, V0, V1);
+
+                    // Substitute the result in the 3D array
+                    for (i2 = 0; i2 < M2; i2++)
+                      for (p = 0; p < np; p++) X[N1L*i2+i13+p] = V[i2*P+p];
+                  }
+              }
+
+            // Inverse transform along the FIRST direction
+            // At least two elements are required
+            if ((k <= lvl1) && (M1 > 1UL))
+              {         
+                // Array extents in the corresponding direction
+                M = M1;
+
+                // Loop over the remaining two directions, P lines at a time
+                #pragma omp for schedule(static)
+                for (j = 0; j < M2*M3; j += P)
                   {
-                    // Place data elements in a contiguous vector
-                    unsigned long int i12 = i1+N1L*i2;
-                    for (i3 = 0; i3 < N3; i3++) V[i3] = X[i12+N1N2L*i3];
+                    // Number of lines in this panel
+                    np = (M2*M3-j < P) ? M2*M3-j : P;
 
-                    // Initialize low-pass and high-pass filtered vectors
-                    for (i = 0; i < M; i++)
+                    // Place data elements in a transposed panel
+                    for (p = 0; p < np; p++)
                       {
-                        V0[i] = V[2UL*i];
-                        if (2UL*i+1UL<N) V1[i] = V[2UL*i+1UL];
+                        i23[p] = N1L*((j+p)%M2)+N1N2L*((j+p)/M2);
+                        for (i1 = 0; i1 < M1; i1++) V[i1*P+p] = X[i1+i23[p]];
                       }
 
-                    // Extrapolate if the vector length is odd
-                    if (N%2UL) V1[M-1UL] = V0[M-2UL]*ext[0] + V1[M-2UL]*ext[1] + V0[M-1UL]*ext[2];
+                    // Inverse lifting of all lines in the panel
+                    cdf97_inv_lines<T,WAV_PANEL>(M, V, V0, V1);
+
+                    // Substitute the result in the 3D array
+                    for (p = 0; p < np; p++)
+                      for (i1 = 0; i1 < M1; i1++) X[i1+i23[p]] = V[i1*P+p];
+                  }
+              }
+          }
+      }
+
+    // Deallocate panels
+    free(V1);
+    free(V0);
+    free(V); 
+  }
+}
+
 
-                    // Apply lifting stage 1
-                    for (i = 0; i < M-1UL; i++) V1[i] += lfc[0]*(V0[i+1UL]+V0[i]);
-                    V1[M-1UL] += lfc[0]*2*V0[M-1UL];
 
-                    // Apply lifting stage 2
-                    V0[0] += lfc[1]*2*V1[0];
-                    for (i = 1; i < M; i++) V0[i] += lfc[1]*(V1[i]+V1[i-1UL]);
+/* Inverse three-dimensional wavelet transform using CDF9/7 wavelets that only reconstructs the planes normal to the 
+   direction dir (1, 2 or 3) at the nslc indexes islc. Every output row of the inverse lifting depends on the low-pass 
+   and high-pass rows within two rows of its pair, so the rows needed at each level form a cone that widens by two 
+   pairs per level towards the coarse levels. Along dir, only the windows of the cone are lifted, and along the 
+   other two directions only the planes in the cone are transformed; the directions are processed in the same order 
+   as by the full inverse transform, which yields the same planes. Other elements of X are left undefined */
+template <typename T>
+void waveletcdf97_3d_slices(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, int dir, int nslc, const int *islc, T *X)
+{
+  // Number of lines lifted together
+  const unsigned long int P = WAV_PANEL;
+
+  // Extents, strides and transform depths of the three directions
+  const unsigned long int NL[3] = {(unsigned long int)(N1in), (unsigned long int)(N2in), (unsigned long int)(N3in)};
+  const unsigned long int SL[3] = {1UL, NL[0], NL[0]*NL[1]};
+  const int lvlv[3] = {lvl1in < 0 ? -lvl1in : lvl1in, lvl2in < 0 ? -lvl2in : lvl2in, lvl3in < 0 ? -lvl3in : lvl3in};
+
+  // Direction normal to the planes and its extent
+  const int d = dir-1;
+  const unsigned long int N = NL[d];
+
+  // Total number of levels
+  int lvl = lvlv[0];
+  if (lvlv[1] > lvl) lvl = lvlv[1];
+  if (lvlv[2] > lvl) lvl = lvlv[2];
+
+  // Largest array extent, determines the size of the temporary panels
+  unsigned long int NmaxL = NL[0];
+  if (NL[1] > NmaxL) NmaxL = NL[1];
+  if (NL[2] > NmaxL) NmaxL = NL[2];
+
+  // Rows along dir needed in the output of every level k, flagged in need+(k-1)*N. The rows needed at the coarsest 
+  // level, in need+lvl*N, are the input of the inverse transform
+  unsigned char *need = (unsigned char*) calloc((unsigned long int)(lvl+1)*N,sizeof(unsigned char));
+  for (int s = 0; s < nslc; s++) 
+    if ((islc[s] >= 0) && ((unsigned long int)(islc[s]) < N)) need[islc[s]] = 1;
+  for (int k = 1; k <= lvl; k++)
+    {
+      unsigned char *nout = need+(unsigned long int)(k-1)*N, *nin = nout+N;
+      unsigned long int M = lvl_extent(N, k-1 < lvlv[d] ? k-1 : lvlv[d]);
+      if ((k <= lvlv[d]) && (M > 1UL))
+        {
+          // Pairs of low-pass and high-pass rows within two pairs of a needed output row
+          unsigned long int Q = (M/2UL) + ( (M%2UL) > 0UL ? 1UL : 0UL );
+          for (unsigned long int r = 0; r < M; r++) if (nout[r])
+            for (unsigned long int i = (r/2UL > 2UL ? r/2UL-2UL : 0UL); (i <= r/2UL+2UL) && (i < Q); i++) nin[i] = 1;
+        }
+      else
+        for (unsigned long int r = 0; r < M; r++) nin[r] = nout[r];
+    }
 
-                    // Apply lifting stage 3
-                    for (i = 0; i < M-1UL; i++) V1[i] += lfc[2]*(V0[i+1UL]+V0[i]);
-                    V1[M-1UL] += lfc[2]*2*V0[M-1UL];
+  // The lines of one direction at one level are independent, they are distributed between the threads
+  #pragma omp parallel
+  {
+    // Indexes
+    int k, e;
+    unsigned long int i, j, p, np, r, w0, w1, nw, nh;
+
+    // Offsets of the lines gathered in a panel
+    unsigned long int off[WAV_PANEL];
+
+    // Temporary panels of this thread: the lines being lifted, their low-pass and high-pass parts, and the needed 
+    // output rows of the windows along dir
+    T *V = (T*) calloc(NmaxL*P,sizeof(T));
+    T *V0 = (T*) calloc((NmaxL/2UL+1UL)*P,sizeof(T));
+    T *V1 = (T*) calloc((NmaxL/2UL+1UL)*P,sizeof(T));
+    T *Y = (T*) calloc(N*P,sizeof(T));
+
+    // Planes transformed along the other two directions before and after the lifting along dir, and the first and 
+    // last pairs of the windows along dir
+    unsigned long int *lin = (unsigned long int*) malloc(N*sizeof(unsigned long int));
+    unsigned long int *lout = (unsigned long int*) malloc(N*sizeof(unsigned long int));
+    unsigned long int *win = (unsigned long int*) malloc(N*sizeof(unsigned long int));
+
+    for (k = lvl; k >= 1; k--)
+      {
+        // Array extents, the directions with fewer levels keep the extents of their last level
+        unsigned long int M[3];
+        for (e = 0; e < 3; e++) M[e] = lvl_extent(NL[e], k-1 < lvlv[e] ? k-1 : lvlv[e]);
+        const unsigned char *nout = need+(unsigned long int)(k-1)*N, *nin = nout+N;
+
+        // Needed output planes
+        unsigned long int nout_l = 0;
+        for (r = 0; r < M[d]; r++) if (nout[r]) lout[nout_l++] = r;
+
+        // Windows of pairs and the planes they read, the low-pass rows first and then the high-pass rows
+        const int trd = (k <= lvlv[d]) && (M[d] > 1UL);
+        unsigned long int Q = (M[d]/2UL) + ( (M[d]%2UL) > 0UL ? 1UL : 0UL );
+        unsigned long int nin_l = 0, nwin = 0;
+        if (trd)
+          {
+            for (i = 0; i < Q; i++) if (nin[i])
+              {
+                if ((i == 0UL) || !nin[i-1UL]) win[nwin] = i;
+                if ((i+1UL == Q) || !nin[i+1UL])
+                  {
+                    win[nwin+1UL] = i;
+                    nwin += 2UL;
+                  }
+                lin[nin_l++] = i;
+              }
+            for (i = 0; i < M[d]-Q; i++) if (nin[i]) lin[nin_l++] = Q+i;
+          }
+
+        // Inverse transform along the THIRD, SECOND and FIRST directions, as in the full inverse transform
+        for (e = 2; e >= 0; e--)
+          {
+            // At least two elements are required
+            if ((k > lvlv[e]) || (M[e] < 2UL)) continue;
+
+            if (e == d)
+              {
+                // Remaining two directions, a with the smaller stride
+                const int a = (d == 0) ? 1 : 0, b = (d == 2) ? 1 : 2;
+
+                // Loop over the lines along dir, P lines at a time
+                #pragma omp for schedule(static)
+                for (j = 0; j < M[a]*M[b]; j += P)
+                  {
+                    // Number of lines in this panel
+                    np = (M[a]*M[b]-j < P) ? M[a]*M[b]-j : P;
+                    for (p = 0; p < np; p++) off[p] = SL[a]*((j+p)%M[a]) + SL[b]*((j+p)/M[a]);
 
-                    // Apply lifting stage 4
-                    V0[0] += lfc[3]*2*V1[0];
-                    for (i = 1; i < M; i++) V0[i] += lfc[3]*(V1[i]+V1[i-1UL]);
+                    for (unsigned long int iw = 0; iw < nwin; iw += 2UL)
+                      {
+                        // Window of pairs, lifted as a line of its own. Its ends are boundaries of the line only 
+                        // at the ends of the array, elsewhere they are two pairs away from the needed rows
+                        w0 = win[iw];
+                        w1 = win[iw+1UL];
+                        nw = w1-w0+1UL;
+                        nh = ((w1+1UL < M[d]-Q) ? w1+1UL : M[d]-Q) - w0;
+
+                        // Place the low-pass and high-pass rows of the window in a panel
+                        for (i = 0; i < nw; i++)
+                          for (p = 0; p < np; p++) V[i*P+p] = X[off[p]+SL[d]*(w0+i)];
+                        for (i = 0; i < nh; i++)
+                          for (p = 0; p < np; p++) V[(nw+i)*P+p] = X[off[p]+SL[d]*(Q+w0+i)];
+
+                        // Inverse lifting of all lines in the panel
+                        cdf97_inv_lines<T,WAV_PANEL>(nw+nh, V, V0, V1);
+
+                        // Keep the needed output rows
+                        for (r = 2UL*w0; r < 2UL*w0+nw+nh; r++) if (nout[r])
+                          for (p = 0; p < np; p++) Y[r*P+p] = V[(r-2UL*w0)*P+p];
+                      }
 
-                    // Concatenate low-pass and high-pass vectors
-                    for (i = 0; i < M; i++)
+                    // Substitute the needed output rows in the 3D array
+                    for (i = 0; i < nout_l; i++)
+                      for (p = 0; p < np; p++) X[off[p]+SL[d]*lout[i]] = Y[lout[i]*P+p];
+                  }
+              }
+            else
+              {
+                // Planes read by the lifting along dir if it follows, otherwise the needed output planes
+                const unsigned long int *lpl = (trd && (e > d)) ? lin : lout;
+                const unsigned long int npl = (trd && (e > d)) ? nin_l : nout_l;
+
+                // Remaining direction within the planes
+                const int f = 3-d-e;
+
+                // Loop over the lines along e in the planes, P lines at a time
+                #pragma omp for schedule(static)
+                for (j = 0; j < npl*M[f]; j += P)
+                  {
+                    // Number of lines in this panel
+                    np = (npl*M[f]-j < P) ? npl*M[f]-j : P;
+
+                    // Place data elements in a panel
+                    for (p = 0; p < np; p++)
                       {
-                        V[i] = V0[i]*scl;
-                        if (2UL*i+1UL<N) V[i+M] = V1[i]*pscl;
+                        off[p] = SL[d]*lpl[(j+p)/M[f]] + SL[f]*((j+p)%M[f]);
+                        for (i = 0; i < M[e]; i++) V[i*P+p] = X[off[p]+SL[e]*i];
                       }
 
+                    // Inverse lifting of all lines in the panel
+                    cdf97_inv_lines<T,WAV_PANEL>(M[e], V, V0, V1);
+
                     // Substitute the result in the 3D array
-                    for (i3 = 0; i3 < N3; i3++) X[i12+N1N2L*i3] = V[i3];
+                    for (p = 0; p < np; p++)
+                      for (i = 0; i < M[e]; i++) X[off[p]+SL[e]*i] = V[i*P+p];
                   }
+              }
+          }
+      }
+
+    // Deallocate panels
+    free(win);
+    free(lout);
+    free(lin);
+    free(Y);
+    free(V1);
+    free(V0);
+    free(V); 
+  }
+
+  free(need);
+}
 
-              // Deallocate arrays
-              free(V1);
-              free(V0);
-              free(V); 
-            }
 
-          // Assign the subset array extents for the next iteration
-          N1 = M1;
-          N2 = M2;
-          N3 = M3;
+
+/* Levels of the transform of a field streamed along the third direction. Level k (from 1) transforms the planes of 
+   extents ext[6*(k-1)] x ext[6*(k-1)+1], ext[6*(k-1)+2] of them, along the directions flagged in ext[6*(k-1)+3] to 
+   ext[6*(k-1)+5]; the planes of the next level are the low-pass blocks of the low-pass rows of this level along the 
+   third direction. Trailing levels that transform no direction are left out, but there is at least one level. ext 
+   must have room for 6*WAV_LVL_MAX entries. Returns the number of levels */
+int waveletcdf97_3d_stream_levels(int lvl1in, int lvl2in, int lvl3in, int N1in, int N2in, int N3in, unsigned long int *ext)
+{
+  const unsigned long int NL[3] = {(unsigned long int)(N1in), (unsigned long int)(N2in), (unsigned long int)(N3in)};
+  const int lvlv[3] = {lvl1in, lvl2in, lvl3in};
+
+  int nlev = 1;
+  for (int k = 1; k <= WAV_LVL_MAX; k++)
+    {
+      int ntr = 0;
+      for (int e = 0; e < 3; e++)
+        {
+          ext[6*(k-1)+e] = lvl_extent(NL[e], k-1 < lvlv[e] ? k-1 : lvlv[e]);
+          ext[6*(k-1)+3+e] = (k <= lvlv[e]) && (ext[6*(k-1)+e] > 1UL);
+          ntr += int(ext[6*(k-1)+3+e]);
         }
+      if (ntr > 0) nlev = k;
     }
-  else           
-    // Inverse transform
+  return nlev;
+}
+
+
+/* Working planes of one level of the streamed transform. A plane is transformed along the first two directions in 
+   W, the rows of the lifting along the third direction are held in rings of four low-pass rows V0 and four high-pass 
+   rows V1, row i in the slot i%4. The forward transform scales its output rows into Y0 and Y1. Every plane is 
+   rounded up to whole panels of WAV_PANEL elements, such that the lifting uses the same row operations as the 
+   transform of whole lines and gives the same coefficients */
+template <typename T>
+struct stream_level
+{
+  unsigned long int n1, n2, n3, na;
+  int t1, t2, t3;
+  unsigned long int nin, nout, nrow, ndone;
+  T *W, *V0, *V1, *Y0, *Y1;
+};
+
+/* Allocate the working planes of the levels */
+template <typename T>
+static stream_level<T> *stream_alloc(int nlev, const unsigned long int *ext)
+{
+  stream_level<T> *lev = (stream_level<T>*) calloc(nlev,sizeof(stream_level<T>));
+  for (int k = 0; k < nlev; k++)
     {
-      for (k = 1+lvl; k <= 0; k++)
+      stream_level<T> *L = lev+k;
+      L->n1 = ext[6*k];
+      L->n2 = ext[6*k+1];
+      L->n3 = ext[6*k+2];
+      L->t1 = int(ext[6*k+3]);
+      L->t2 = int(ext[6*k+4]);
+      L->t3 = int(ext[6*k+5]);
+      L->na = ((L->n1*L->n2+WAV_PANEL-1UL)/WAV_PANEL)*WAV_PANEL;
+      L->W = (T*) calloc(L->na,sizeof(T));
+      if (L->t3)
         {
-          unsigned long int pow2k = 1;
-          int kk;
-          for (kk = 1; kk <= -k; kk++) pow2k *= 2UL;
-          M1 = (N1/pow2k) + ( (N1%pow2k) > 0UL ? 1UL : 0UL );
-          M2 = (N2/pow2k) + ( (N2%pow2k) > 0UL ? 1UL : 0UL );
-          M3 = (N3/pow2k) + ( (N3%pow2k) > 0UL ? 1UL : 0UL );
-
-          // Inverse transform along the THIRD direction
-          // At least two elements are required
-          if (M3 > 1UL)
-            {         
-              // Array extents in the corresponding direction
-              M = M3;
-              Q = (M/2UL) + ( (M%2UL) > 0UL ? 1UL : 0UL );
-
-              // Allocate temporary vectors
-              V = (T*) malloc(M*sizeof(T));
-              V0 = (T*) malloc(Q*sizeof(T));
-              V1 = (T*) malloc(Q*sizeof(T));
-
-              // Loop over the remaining two directions
-              for (i2 = 0; i2 < M2; i2++)
-                for (i1 = 0; i1 < M1; i1++)
-                  {
-                    // Place data elements in a contiguous vector
-                    unsigned long int i12 = i1+N1L*i2;
-                    for (i3 = 0; i3 < M3; i3++) V[i3] = X[i12+N1N2L*i3];
+          L->V0 = (T*) calloc(4UL*L->na,sizeof(T));
+          L->V1 = (T*) calloc(4UL*L->na,sizeof(T));
+          L->Y0 = (T*) calloc(L->na,sizeof(T));
+          L->Y1 = (T*) calloc(L->na,sizeof(T));
+        }
+    }
+  return lev;
+}
 
-                    // Initialize low-pass and high-pass filtered vectors
-                    for (i = 0; i < Q; i++) V0[i] = V[i]*pscl;
-                    for (i = 0; i < M-Q; i++) V1[i] = V[i+Q]*scl;
-                    if (M%2UL) V1[Q-1UL] = 0; 
+/* Deallocate the working planes of the levels */
+template <typename T>
+static void stream_free(int nlev, stream_level<T> *lev)
+{
+  for (int k = 0; k < nlev; k++)
+    {
+      free(lev[k].W);
+      free(lev[k].V0);
+      free(lev[k].V1);
+      free(lev[k].Y0);
+      free(lev[k].Y1);
+    }
+  free(lev);
+}
 
-                    // Apply lifting stage 1
-                    V0[0] -= lfc[3]*2*V1[0];
-                    for (i = 1; i < Q; i++) V0[i] -= lfc[3]*(V1[i]+V1[i-1UL]);
+/* Copy the block of extents n1 x n2 from the corner of a plane X with m1 elements per line into the contiguous 
+   plane Y */
+template <typename T>
+static void stream_corner(unsigned long int m1, unsigned long int n1, unsigned long int n2, const T *X, T *Y)
+{
+  for (unsigned long int i2 = 0; i2 < n2; i2++) memcpy(Y+i2*n1, X+i2*m1, n1*sizeof(T));
+}
 
-                    // Apply lifting stage 2
-                    for (i = 0; i < Q-1UL; i++) V1[i] -= lfc[2]*(V0[i+1UL]+V0[i]);
-                    V1[Q-1UL] -= lfc[2]*2*V0[Q-1UL];
+/* Copy the contiguous plane Y of extents n1 x n2 into the corner of a plane X with m1 elements per line */
+template <typename T>
+static void stream_uncorner(unsigned long int m1, unsigned long int n1, unsigned long int n2, const T *Y, T *X)
+{
+  for (unsigned long int i2 = 0; i2 < n2; i2++) memcpy(X+i2*m1, Y+i2*n1, n1*sizeof(T));
+}
 
-                    // Apply lifting stage 3
-                    V0[0] -= lfc[1]*2*V1[0];
-                    for (i = 1; i < Q; i++) V0[i] -= lfc[1]*(V1[i]+V1[i-1UL]);
+/* Step i of the forward lifting along the third direction of a level with M low-pass rows, as in cdf97_fwd_lines: 
+   stages 1 and 2 at row i, stages 3 and 4 at row i-1 and, at the last row, stages 3 and 4 at row i. The low-pass row 
+   i+1 must be loaded, unless i is the last row */
+template <typename T>
+static void stream_fwd_lift(stream_level<T> *L, unsigned long int M, unsigned long int i)
+{
+  static const T lfc[4] = {T(cdf97_lfc[0]), T(cdf97_lfc[1]), T(cdf97_lfc[2]), T(cdf97_lfc[3])};
+  typedef lift_rows<T,WAV_PANEL> R;
+  const unsigned long int na = L->na;
+  const int last = (i+1UL == M);
 
-                    // Apply lifting stage 4
-                    for (i = 0; i < Q-1UL; i++) V1[i] -= lfc[0]*(V0[i+1UL]+V0[i]);
-                    V1[Q-1UL] -= lfc[0]*2*V0[Q-1UL];
+  // Rows i-2 to i+1 in the rings
+  T *l0 = L->V0+(i%4UL)*na, *lm = L->V0+((i+3UL)%4UL)*na, *lp = L->V0+((i+1UL)%4UL)*na;
+  T *h0 = L->V1+(i%4UL)*na, *hm = L->V1+((i+3UL)%4UL)*na, *hmm = L->V1+((i+2UL)%4UL)*na;
 
-                    // Concatenate low-pass and high-pass vectors
-                    for (i = 0; i < Q; i++)
-                      {
-                        V[2UL*i] = V0[i];
-                        if (2UL*i+1UL<M) V[2UL*i+1UL] = V1[i];
-                      }
+  #pragma omp parallel for schedule(static)
+  for (long int c = 0; c < long(na/WAV_PANEL); c++)
+    {
+      unsigned long int o = (unsigned long int)(c)*WAV_PANEL;
 
-                    // Substitute the result in the 3D array
-                    for (i3 = 0; i3 < M3; i3++) X[i12+N1N2L*i3] = V[i3];
-                  }
+      // Lifting stage 1 at row i
+      if (!last) R::pair(h0+o, lfc[0], lp+o, l0+o);
+      else R::single(h0+o, lfc[0]*2, l0+o);
 
-              // Deallocate arrays
-              free(V1);
-              free(V0);
-              free(V); 
-            }
+      // Lifting stage 2 at row i
+      if (i > 0UL) R::pair(l0+o, lfc[1], h0+o, hm+o);
+      else R::single(l0+o, lfc[1]*2, h0+o);
 
-          // Inverse transform along the SECOND direction
-          // At least two elements are required
-          if (M2 > 1UL)
-            {         
-              // Array extents in the corresponding direction
-              M = M2;
-              Q = (M/2UL) + ( (M%2UL) > 0UL ? 1UL : 0UL );
-
-              // Allocate temporary vectors
-              V = (T*) malloc(M*sizeof(T));
-              V0 = (T*) malloc(Q*sizeof(T));
-              V1 = (T*) malloc(Q*sizeof(T));
-
-              // Loop over the remaining two directions
-              for (i3 = 0; i3 < M3; i3++)
-                for (i1 = 0; i1 < M1; i1++)
-                  {
-                    // Place data elements in a contiguous vector
-                    unsigned long int i13 = i1+N1N2L*i3;
-                    for (i2 = 0; i2 < M2; i2++) V[i2] = X[N1L*i2+i13];
+      if (i > 0UL)
+        {
+          // Lifting stages 3 and 4 at row i-1
+          R::pair(hm+o, lfc[2], l0+o, lm+o);
+          if (i > 1UL) R::pair(lm+o, lfc[3], hm+o, hmm+o);
+          else R::single(lm+o, lfc[3]*2, hm+o);
+        }
 
-                    // Initialize low-pass and high-pass filtered vectors
-                    for (i = 0; i < Q; i++) V0[i] = V[i]*pscl;
-                    for (i = 0; i < M-Q; i++) V1[i] = V[i+Q]*scl;
-                    if (M%2UL) V1[Q-1UL] = 0; 
+      if (last)
+        {
+          // Lifting stages 3 and 4 at the last row
+          R::single(h0+o, lfc[2]*2, l0+o);
+          if (M > 1UL) R::pair(l0+o, lfc[3], h0+o, hm+o);
+          else R::single(l0+o, lfc[3]*2, h0+o);
+        }
+    }
+}
 
-                    // Apply lifting stage 1
-                    V0[0] -= lfc[3]*2*V1[0];
-                    for (i = 1; i < Q; i++) V0[i] -= lfc[3]*(V1[i]+V1[i-1UL]);
+/* Extrapolate the last high-pass row M-1 of an odd-sized level from the rows loaded before it, as in cdf97_fwd_lines */
+template <typename T>
+static void stream_fwd_extrap(stream_level<T> *L, unsigned long int M)
+{
+  static const T lfc[4] = {T(cdf97_lfc[0]), T(cdf97_lfc[1]), T(cdf97_lfc[2]), T(cdf97_lfc[3])};
+  typedef lift_rows<T,WAV_PANEL> R;
+  const unsigned long int na = L->na;
+  T ext[3];
+  ext[0] = -2*lfc[0]*lfc[1]*lfc[2]/(1+2*lfc[1]*lfc[2]);
+  ext[1] = -2*lfc[1]*lfc[2]/(1+2*lfc[1]*lfc[2]);
+  ext[2] = -2*(lfc[0]+lfc[2]+3*lfc[0]*lfc[1]*lfc[2])/(1+2*lfc[1]*lfc[2]);
+  T *h = L->V1+((M-1UL)%4UL)*na, *l = L->V0+((M-1UL)%4UL)*na;
+  T *lm = L->V0+((M-2UL)%4UL)*na, *hm = L->V1+((M-2UL)%4UL)*na;
+  for (unsigned long int o = 0; o < na; o += WAV_PANEL) R::extrap(h+o, lm+o, ext[0], hm+o, ext[1], l+o, ext[2]);
+}
 
-                    // Apply lifting stage 2
-                    for (i = 0; i < Q-1UL; i++) V1[i] -= lfc[2]*(V0[i+1UL]+V0[i]);
-                    V1[Q-1] -= lfc[2]*2*V0[Q-1];
+/* Pass the finished low-pass row i, and the high-pass row i if high is set, of level k to the sink, and the low-pass 
+   block of the low-pass row to the next level */
+template <typename T>
+static void stream_fwd_push(int nlev, stream_level<T> *lev, int k, void *ctx_out, void (*write_rows)(void *ctx, int k, unsigned long int i, const T *low, const T *high));
 
-                    // Apply lifting stage 3
-                    V0[0] -= lfc[1]*2*V1[0];
-                    for (i = 1; i < Q; i++) V0[i] -= lfc[1]*(V1[i]+V1[i-1UL]);
+template <typename T>
+static void stream_fwd_emit(int nlev, stream_level<T> *lev, int k, unsigned long int i, const T *low, const T *high, void *ctx_out, void (*write_rows)(void *ctx, int k, unsigned long int i, const T *low, const T *high))
+{
+  write_rows(ctx_out, k+1, i, low, high);
+  if (k+1 < nlev)
+    {
+      stream_level<T> *N = lev+k+1;
+      stream_corner(lev[k].n1, N->n1, N->n2, low, N->W);
+      stream_fwd_push(nlev, lev, k+1, ctx_out, write_rows);
+    }
+}
 
-                    // Apply lifting stage 4
-                    for (i = 0; i < Q-1UL; i++) V1[i] -= lfc[0]*(V0[i+1UL]+V0[i]);
-                    V1[Q-1UL] -= lfc[0]*2*V0[Q-1UL];
+/* Scale the finished rows i of the rings of level k into Y0 and Y1 and pass them on, the high-pass row only if the 
+   array extent is even or i is not the last row */
+template <typename T>
+static void stream_fwd_output(int nlev, stream_level<T> *lev, int k, unsigned long int i, void *ctx_out, void (*write_rows)(void *ctx, int k, unsigned long int i, const T *low, const T *high))
+{
+  static const T scl = T(cdf97_scl);
+  static const T pscl = T(1.0/cdf97_scl);
+  typedef lift_rows<T,WAV_PANEL> R;
+  stream_level<T> *L = lev+k;
+  const unsigned long int na = L->na;
+  const int high = (2UL*i+1UL < L->n3);
+  T *l = L->V0+(i%4UL)*na, *h = L->V1+(i%4UL)*na;
+  #pragma omp parallel for schedule(static)
+  for (long int c = 0; c < long(na/WAV_PANEL); c++)
+    {
+      unsigned long int o = (unsigned long int)(c)*WAV_PANEL;
+      R::scale(L->Y0+o, scl, l+o);
+      if (high) R::scale(L->Y1+o, pscl, h+o);
+    }
+  stream_fwd_emit(nlev, lev, k, i, L->Y0, high ? L->Y1 : (T*)(NULL), ctx_out, write_rows);
+}
 
-                    // Concatenate low-pass and high-pass vectors
-                    for (i = 0; i < Q; i++)
-                      {
-                        V[2UL*i] = V0[i];
-                        if (2UL*i+1UL<M) V[2UL*i+1UL] = V1[i];
-                      }
+/* Forward transform of the plane held in W of level k, the next plane of that level. The plane is transformed along 
+   the first two directions, then loaded in the rings and lifted along the third direction as far as the loaded rows 
+   allow; the rows that are finished are passed on */
+template <typename T>
+static void stream_fwd_push(int nlev, stream_level<T> *lev, int k, void *ctx_out, void (*write_rows)(void *ctx, int k, unsigned long int i, const T *low, const T *high))
+{
+  stream_level<T> *L = lev+k;
+  unsigned long int ip = L->nin++;
 
-                    // Substitute the result in the 3D array
-                    for (i2 = 0; i2 < M2; i2++) X[N1L*i2+i13] = V[i2];
-                  }
+  // Transform along the FIRST and SECOND directions
+  if (L->t1 || L->t2) waveletcdf97_3d(int(L->n1), int(L->n2), 1, L->t1, L->t2, 0, L->W);
 
-              // Deallocate arrays
-              free(V1);
-              free(V0);
-              free(V); 
-            }
+  // Without a transform along the THIRD direction, every plane is a low-pass row
+  if (!L->t3)
+    {
+      stream_fwd_emit(nlev, lev, k, ip, L->W, (T*)(NULL), ctx_out, write_rows);
+      return;
+    }
 
-          // Inverse transform along the FIRST direction
-          // At least two elements are required
-          if (M1 > 1UL)
-            {         
-              // Array extents in the corresponding direction
-              M = M1;
-              Q = (M/2UL) + ( (M%2UL) > 0UL ? 1UL : 0UL );
-
-              // Allocate temporary vectors
-              V = (T*) malloc(M*sizeof(T));
-              V0 = (T*) malloc(Q*sizeof(T));
-              V1 = (T*) malloc(Q*sizeof(T));
-
-              // Loop over the remaining two directions
-              for (i3 = 0; i3 < M3; i3++)
-                for (i2 = 0; i2 < M2; i2++)
-                  {
-                    // Place data elements in a contiguous vector
-                    unsigned long int i23 = N1L*i2+N1N2L*i3;
-                    for (i1 = 0; i1 < M1; i1++) V[i1] = X[i1+i23];
+  // Load the plane as the low-pass or high-pass row ip/2
+  const unsigned long int na = L->na;
+  const unsigned long int M = (L->n3/2UL) + ( (L->n3%2UL) > 0UL ? 1UL : 0UL );
+  unsigned long int i = ip/2UL;
+  memcpy((ip%2UL ? L->V1 : L->V0)+(i%4UL)*na, L->W, na*sizeof(T));
 
-                    // Initialize low-pass and high-pass filtered vectors
-                    for (i = 0; i < Q; i++) V0[i] = V[i]*pscl;
-                    for (i = 0; i < M-Q; i++) V1[i] = V[i+Q]*scl;
-                    if (M%2UL) V1[Q-1UL] = 0; 
+  // A new low-pass row lets the previous step run, the last high-pass row of an odd extent is extrapolated first 
+  // from the rows that are not lifted yet
+  if ((ip%2UL == 0UL) && (i > 0UL))
+    {
+      if (ip+1UL == L->n3) stream_fwd_extrap(L, M);
+      stream_fwd_lift(L, M, i-1UL);
+      if (i > 1UL) stream_fwd_output(nlev, lev, k, i-2UL, ctx_out, write_rows);
+    }
 
-                    // Apply lifting stage 1
-                    V0[0] -= lfc[3]*2*V1[0];
-                    for (i = 1; i < Q; i++) V0[i] -= lfc[3]*(V1[i]+V1[i-1UL]);
+  // The last plane finishes the lifting
+  if (ip+1UL == L->n3)
+    {
+      stream_fwd_lift(L, M, M-1UL);
+      if (M > 1UL) stream_fwd_output(nlev, lev, k, M-2UL, ctx_out, write_rows);
+      stream_fwd_output(nlev, lev, k, M-1UL, ctx_out, write_rows);
+    }
+}
 
-                    // Apply lifting stage 2
-                    for (i = 0; i < Q-1UL; i++) V1[i] -= lfc[2]*(V0[i+1UL]+V0[i]);
-                    V1[Q-1UL] -= lfc[2]*2*V0[Q-1UL];
 
-                    // Apply lifting stage 3
-                    V0[0] -= lfc[1]*2*V1[0];
-                    for (i = 1; i < Q; i++) V0[i] -= lfc[1]*(V1[i]+V1[i-1UL]);
+/* Forward three-dimensional wavelet transform using CDF9/7 wavelets of a field that is read one plane normal to the 
+   third direction at a time, with the depths of waveletcdf97_3d. Every plane is transformed along the first two 
+   directions as soon as it is read, the lifting along the third direction runs over a sliding window of four 
+   low-pass and four high-pass rows per level, and the low-pass rows feed the next level; the coefficients are the 
+   same as those of waveletcdf97_3d. The levels are described by waveletcdf97_3d_stream_levels. Row i of level k is 
+   passed to write_rows as soon as it is finished: low holds the low-pass row i and high the high-pass row i, or 
+   NULL if there is none, both with the extents of the planes of level k. Only the coefficients outside the low-pass 
+   block of the planes of level k+1 are final in low; the low-pass block is transformed further unless k is the last 
+   level. The working memory is about 11 planes of every level, at most 15 planes of the field */
+template <typename T>
+void waveletcdf97_3d_stream(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, void *ctx_in, void (*read_plane)(void *ctx, unsigned long int i3, T *plane), void *ctx_out, void (*write_rows)(void *ctx, int k, unsigned long int i, const T *low, const T *high))
+{
+  unsigned long int ext[6*WAV_LVL_MAX];
+  int nlev = waveletcdf97_3d_stream_levels(lvl1in, lvl2in, lvl3in, N1in, N2in, N3in, ext);
+  stream_level<T> *lev = stream_alloc<T>(nlev, ext);
 
-                    // Apply lifting stage 4
-                    for (i = 0; i < Q-1UL; i++) V1[i] -= lfc[0]*(V0[i+1UL]+V0[i]);
-                    V1[Q-1UL] -= lfc[0]*2*V0[Q-1UL];
+  for (unsigned long int i3 = 0; i3 < (unsigned long int)(N3in); i3++)
+    {
+      read_plane(ctx_in, i3, lev[0].W);
+      stream_fwd_push(nlev, lev, 0, ctx_out, write_rows);
+    }
 
-                    // Concatenate low-pass and high-pass vectors
-                    for (i = 0; i < Q; i++)
-                      {
-                        V[2UL*i] = V0[i];
-                        if (2UL*i+1UL<M) V[2UL*i+1UL] = V1[i];
-                      }
+  stream_free(nlev, lev);
+}
 
-                    // Substitute the result in the 3D array
-                    for (i1 = 0; i1 < M1; i1++) X[i1+i23] = V[i1];
-                  }
 
-              // Deallocate arrays
-              free(V1);
-              free(V0);
-              free(V); 
-            }
+/* Step i of the inverse lifting along the third direction of a level with Q low-pass rows, as in cdf97_inv_lines: 
+   stage 1 at row i, stages 2 and 3 at row i-1 and stage 4 at row i-2, and at the last row all remaining stages. The 
+   rows i are loaded and scaled first */
+template <typename T>
+static void stream_inv_lift(stream_level<T> *L, unsigned long int Q, unsigned long int i)
+{
+  static const T lfc[4] = {T(-cdf97_lfc[0]), T(-cdf97_lfc[1]), T(-cdf97_lfc[2]), T(-cdf97_lfc[3])};
+  static const T scl = T(cdf97_scl);
+  static const T pscl = T(1.0/cdf97_scl);
+  typedef lift_rows<T,WAV_PANEL> R;
+  const unsigned long int na = L->na;
+  const int last = (i+1UL == Q);
+  const int zhigh = (i+1UL == Q) && (L->n3%2UL);
+
+  // Rows i-2 to i in the rings
+  T *l0 = L->V0+(i%4UL)*na, *lm = L->V0+((i+3UL)%4UL)*na, *lmm = L->V0+((i+2UL)%4UL)*na;
+  T *h0 = L->V1+(i%4UL)*na, *hm = L->V1+((i+3UL)%4UL)*na, *hmm = L->V1+((i+2UL)%4UL)*na;
+
+  #pragma omp parallel for schedule(static)
+  for (long int c = 0; c < long(na/WAV_PANEL); c++)
+    {
+      unsigned long int o = (unsigned long int)(c)*WAV_PANEL;
+
+      // Scale the loaded rows, the high-pass row after the last one of an odd extent is zero
+      R::scale(l0+o, pscl, l0+o);
+      if (zhigh) R::zero(h0+o);
+      else R::scale(h0+o, scl, h0+o);
+
+      // Lifting stage 1 at row i
+      if (i > 0UL) R::pair(l0+o, lfc[3], h0+o, hm+o);
+      else R::single(l0+o, lfc[3]*2, h0+o);
+
+      if (i > 0UL)
+        {
+          // Lifting stages 2 and 3 at row i-1
+          R::pair(hm+o, lfc[2], l0+o, lm+o);
+          if (i > 1UL) R::pair(lm+o, lfc[1], hm+o, hmm+o);
+          else R::single(lm+o, lfc[1]*2, hm+o);
+        }
+
+      // Lifting stage 4 at row i-2
+      if (i > 1UL) R::pair(hmm+o, lfc[0], lm+o, lmm+o);
+
+      if (last)
+        {
+          // Lifting stages 2 and 3 at the last row, stage 4 at the last two rows
+          R::single(h0+o, lfc[2]*2, l0+o);
+          if (Q > 1UL) R::pair(l0+o, lfc[1], h0+o, hm+o);
+          else R::single(l0+o, lfc[1]*2, h0+o);
+          if (Q > 1UL) R::pair(hm+o, lfc[0], l0+o, lm+o);
+          R::single(h0+o, lfc[0]*2, l0+o);
+        }
+    }
+}
+
+/* Next plane of level k of the inverse transform, held in W. The low-pass and high-pass rows are read and lifted 
+   along the third direction as far as needed for the plane, the low-pass block of every low-pass row being the 
+   next plane of level k+1; the plane is then transformed along the second and first directions */
+template <typename T>
+static const T *stream_inv_pull(int nlev, stream_level<T> *lev, int k, void *ctx_in, void (*read_rows)(void *ctx, int k, unsigned long int i, T *low, T *high))
+{
+  stream_level<T> *L = lev+k;
+  unsigned long int iz = L->nout++;
+  const unsigned long int na = L->na;
+
+  if (!L->t3)
+    {
+      // Without a transform along the THIRD direction, every plane is a low-pass row
+      read_rows(ctx_in, k+1, iz, L->W, (T*)(NULL));
+      if (k+1 < nlev) stream_uncorner(L->n1, lev[k+1].n1, lev[k+1].n2, stream_inv_pull(nlev, lev, k+1, ctx_in, read_rows), L->W);
+    }
+  else
+    {
+      // Lift until the plane is finished, the pairs of rows up to i-2 are finished after step i
+      const unsigned long int Q = (L->n3/2UL) + ( (L->n3%2UL) > 0UL ? 1UL : 0UL );
+      while (L->ndone <= iz)
+        {
+          unsigned long int i = L->nrow++;
+          T *l0 = L->V0+(i%4UL)*na, *h0 = L->V1+(i%4UL)*na;
+          read_rows(ctx_in, k+1, i, l0, (i < L->n3-Q) ? h0 : (T*)(NULL));
+          if (k+1 < nlev) stream_uncorner(L->n1, lev[k+1].n1, lev[k+1].n2, stream_inv_pull(nlev, lev, k+1, ctx_in, read_rows), l0);
+          stream_inv_lift(L, Q, i);
+          L->ndone = (i+1UL == Q) ? L->n3 : (i > 1UL ? 2UL*(i-1UL) : 0UL);
         }
+      memcpy(L->W, (iz%2UL ? L->V1 : L->V0)+((iz/2UL)%4UL)*na, na*sizeof(T));
     }
+
+  // Inverse transform along the SECOND and FIRST directions
+  if (L->t1 || L->t2) waveletcdf97_3d(int(L->n1), int(L->n2), 1, -L->t1, -L->t2, 0, L->W);
+  return L->W;
 }
 
 
+/* Inverse of waveletcdf97_3d_stream: the field is reconstructed one plane normal to the third direction at a time, 
+   each plane being passed to write_plane as soon as it is finished. The rows of every level are requested from 
+   read_rows in increasing order of i, with the same meaning of k, i, low and high as in waveletcdf97_3d_stream; 
+   the low-pass block of the planes of level k+1 in low is overwritten and need not be filled unless k is the last 
+   level. The reconstructed field is the same as that of waveletcdf97_3d */
+template <typename T>
+void waveletcdf97_3d_stream_inv(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, void *ctx_in, void (*read_rows)(void *ctx, int k, unsigned long int i, T *low, T *high), void *ctx_out, void (*write_plane)(void *ctx, unsigned long int i3, const T *plane))
+{
+  unsigned long int ext[6*WAV_LVL_MAX];
+  int nlev = waveletcdf97_3d_stream_levels(lvl1in, lvl2in, lvl3in, N1in, N2in, N3in, ext);
+  stream_level<T> *lev = stream_alloc<T>(nlev, ext);
+
+  for (unsigned long int i3 = 0; i3 < (unsigned long int)(N3in); i3++)
+    write_plane(ctx_out, i3, stream_inv_pull(nlev, lev, 0, ctx_in, read_rows));
+
+  stream_free(nlev, lev);
+}
+
+
+
+/* Choose the transform depth in each direction. A level is admissible if the array extent is at least WAV_LVL_MINLEN 
+   and a probe on WAV_PANEL lines spread evenly over the array shows that its detail coefficients are small compared 
+   with the fluctuations of the low-pass band they are computed from. Every level amplifies the low-pass band, therefore 
+   the total number of levels is limited to WAV_LVL_SUM; they are given one at a time to the direction whose next 
+   admissible level compacts the energy best */
+template <typename T>
+void waveletcdf97_3d_levels(int N1in, int N2in, int N3in, const T *X, int *lvl)
+{
+  // Number of lines probed
+  const unsigned long int P = WAV_PANEL;
+
+  // Extents and strides of the three directions
+  const unsigned long int NL[3] = {(unsigned long int)(N1in), (unsigned long int)(N2in), (unsigned long int)(N3in)};
+  const unsigned long int SL[3] = {1UL, NL[0], NL[0]*NL[1]};
+
+  // Largest array extent, determines the size of the temporary panels
+  unsigned long int NmaxL = NL[0];
+  if (NL[1] > NmaxL) NmaxL = NL[1];
+  if (NL[2] > NmaxL) NmaxL = NL[2];
+
+  // Temporary panels
+  T *V = (T*) calloc(NmaxL*P,sizeof(T));
+  T *V0 = (T*) calloc((NmaxL/2UL+1UL)*P,sizeof(T));
+  T *V1 = (T*) calloc((NmaxL/2UL+1UL)*P,sizeof(T));
+
+  // Probe ratios of the admissible levels in each direction
+  double ratio[3][WAV_LVL_MAX];
+  int nadm[3];
+
+  for (int dir = 0; dir < 3; dir++)
+    {
+      // Extent and stride in the probed direction and in the remaining two directions
+      unsigned long int N = NL[dir], S = SL[dir];
+      unsigned long int Na = NL[dir == 0 ? 1 : 0], Sa = SL[dir == 0 ? 1 : 0];
+      unsigned long int Nb = NL[dir == 2 ? 1 : 2], Sb = SL[dir == 2 ? 1 : 2];
+
+      // Place the sample lines in a panel, unused lines are zero
+      unsigned long int nlines = Na*Nb;
+      unsigned long int np = (nlines < P) ? nlines : P;
+      for (unsigned long int i = 0; i < N*P; i++) V[i] = 0;
+      for (unsigned long int p = 0; p < np; p++)
+        {
+          unsigned long int t = (np > 1UL) ? (p*(nlines-1UL))/(np-1UL) : 0UL;
+          unsigned long int ioff = Sa*(t%Na)+Sb*(t/Na);
+          for (unsigned long int i = 0; i < N; i++) V[i*P+p] = X[ioff+S*i];
+        }
+
+      // Probe the levels one after another while they are admissible
+      unsigned long int n = N;
+      nadm[dir] = 0;
+      while ((nadm[dir] < WAV_LVL_MAX) && (n >= WAV_LVL_MINLEN))
+        {
+          // Low-pass filtered vector length
+          unsigned long int m = (n/2UL) + ( (n%2UL) > 0UL ? 1UL : 0UL );
+
+          // Mean absolute deviation of the lines from their mean values
+          double a = 0;
+          for (unsigned long int p = 0; p < np; p++)
+            {
+              double mean = 0;
+              for (unsigned long int i = 0; i < n; i++) mean += V[i*P+p];
+              mean /= n;
+              for (unsigned long int i = 0; i < n; i++) a += fabs(V[i*P+p]-mean);
+            }
+          a /= n*np;
+
+          // Mean absolute value of the detail coefficients of this level
+          cdf97_fwd_lines<T,WAV_PANEL>(n, V, V0, V1);
+          double h = 0;
+          for (unsigned long int i = m; i < n; i++)
+            for (unsigned long int p = 0; p < np; p++) h += fabs(V[i*P+p]);
+          h /= (n-m)*np;
+
+          // Stop if the detail is comparable with the fluctuations
+          if (!(h <= WAV_LVL_PROBE*a)) break;
+          ratio[dir][nadm[dir]] = (a > 0) ? h/a : 0;
+          nadm[dir]++;
+          n = m;
+        }
+    }
+
+  // Distribute the levels
+  for (int dir = 0; dir < 3; dir++) lvl[dir] = 0;
+  for (int k = 0; k < WAV_LVL_SUM; k++)
+    {
+      int best = -1;
+      for (int dir = 0; dir < 3; dir++)
+        if ((lvl[dir] < nadm[dir]) && ((best < 0) || (ratio[dir][lvl[dir]] < ratio[best][lvl[best]]))) best = dir;
+      if (best < 0) break;
+      lvl[best]++;
+    }
+
+  // Deallocate panels
+  free(V1);
+  free(V0);
+  free(V); 
+}
+
 
 /* Convert 3D index from physical space to wavelet space */
 void ind_p2w_3d( int lvlin, int N1in, int N2in, int N3in, int i1in, int i2in, int i3in, int *lvl, int *i1, int *i2, int *i3 )
+{
+  ind_p2w_3d( lvlin, lvlin, lvlin, N1in, N2in, N3in, i1in, i2in, i3in, lvl, i1, i2, i3 );
+}
+
+
+/* Convert 3D index from physical space to wavelet space with a separate transform depth in each direction */
+void ind_p2w_3d( int lvl1in, int lvl2in, int lvl3in, int N1in, int N2in, int N3in, int i1in, int i2in, int i3in, int *lvl, int *i1, int *i2, int *i3 )
 {
   // Indexes
   int k, M1, M2, M3;
 
+  // Total number of levels
+  int lvlin = lvl1in;
+  if (lvl2in > lvlin) lvlin = lvl2in;
+  if (lvl3in > lvlin) lvlin = lvl3in;
+
   // Initialize data size and level to input values
   int N1 = N1in;
   int N2 = N2in;
@@ -487,7 +1304,7 @@ void ind_p2w_3d( int lvlin, int N1in, int N2in, int N3in, int i1in, int i2in, in
 
   int chlvl = 0;
 
-  if (lvlin >= 0)   
+  if ((lvl1in >= 0) && (lvl2in >= 0) && (lvl3in >= 0))   
     // Forward transform
     {
       for (k = 1; k <= lvlin; k++)
@@ -499,7 +1316,7 @@ void ind_p2w_3d( int lvlin, int N1in, int N2in, int N3in, int i1in, int i2in, in
 
           // Transform along the FIRST direction
           // At least two elements are required
-          if (N1 > 1)
+          if ((k <= lvl1in) && (N1 > 1))
             {         
               // If the actual point index is inside the low-pass quadrant
               if ( (*i3 < N3) && (*i2 < N2) && (*i1 < N1) )
@@ -514,7 +1331,7 @@ void ind_p2w_3d( int lvlin, int N1in, int N2in, int N3in, int i1in, int i2in, in
 
           // Transform along the SECOND direction
           // At least two elements are required
-          if (N2 > 1)
+          if ((k <= lvl2in) && (N2 > 1))
             {         
               // If the actual point index is inside the low-pass quadrant
               if ( (*i3 < N3) && (*i2 < N2) && (*i1 < N1) )
@@ -529,7 +1346,7 @@ void ind_p2w_3d( int lvlin, int N1in, int N2in, int N3in, int i1in, int i2in, in
 
           // Transform along the THIRD direction
           // At least two elements are required
-          if (N3 > 1)
+          if ((k <= lvl3in) && (N3 > 1))
             {         
               // If the actual point index is inside the low-pass quadrant
               if ( (*i3 < N3) && (*i2 < N2) && (*i1 < N1) )
@@ -543,9 +1360,9 @@ void ind_p2w_3d( int lvlin, int N1in, int N2in, int N3in, int i1in, int i2in, in
             }
 
           // Assign the subset array extents for the next iteration
-          N1 = M1;
-          N2 = M2;
-          N3 = M3;
+          if (k <= lvl1in) N1 = M1;
+          if (k <= lvl2in) N2 = M2;
+          if (k <= lvl3in) N3 = M3;
 
           // Update the actual level
           if (chlvl) *lvl += 1;
@@ -553,5 +1370,113 @@ void ind_p2w_3d( int lvlin, int N1in, int N2in, int N3in, int i1in, int i2in, in
     }
 }
 
+/* Separable tables for the conversion of 3D indexes from physical space to wavelet space, for one direction 
+   with the transform depth lvlin and the extent Nin; nlvl is the largest depth of all directions. On output, 
+   lext[i] is the level at which the index i leaves the low-pass band of this direction (nlvl+1 if it never does), 
+   iw[l*Nin+i] is the wavelet space index if the 3D point leaves the low-pass quadrant at level l, l = 0...nlvl.
+   Returns the number of levels at which this direction is actually transformed. The wavelet space indexes of a 3D 
+   point are iw1[l*N1+i1], iw2[l*N2+i2], iw3[l*N3+i3] with l = min(lext1[i1],lext2[i2],lext3[i3],ntr), where ntr is 
+   the largest of the three return values. The level returned by ind_p2w_3d does not depend on the point: it is the 
+   largest depth of all directions if ntr > 0, and 0 otherwise */
+int ind_p2w_tab( int lvlin, int nlvl, int Nin, int *lext, int *iw )
+{
+  // Levels at which this direction is transformed, at least two elements are required, and their low-pass lengths
+  int M[WAV_LVL_MAX+1];
+  int ntr = 0;
+  int N = Nin;
+  while ((ntr < lvlin) && (N > 1))
+    {
+      M[++ntr] = (N/2) + ( (N%2) > 0 ? 1 : 0 );
+      N = M[ntr];
+    }
+
+  for (int i = 0; i < Nin; i++)
+    {
+      // The index leaves the low-pass band at the level where it is odd, after being halved at all previous levels
+      int e = 1;
+      while ((e <= ntr) && ((i >> (e-1)) % 2 == 0)) e++;
+      lext[i] = (e <= ntr) ? e : nlvl+1;
+
+      // Wavelet space index for all exit levels of the 3D point
+      for (int l = 0; l <= nlvl; l++)
+        {
+          int t = (l < ntr) ? l : ntr;
+          int v = (t > 0) ? (i >> (t-1)) : 0;
+          iw[l*Nin+i] = (t == 0) ? i : ( (v%2) ? v/2+M[t] : v/2 );
+        }
+    }
+
+  return ntr;
+}
+
+
+/* Boxes occupied by the subbands in wavelet space, coarsest first: the low-pass block, then the detail subbands of 
+   every level from the deepest one, those with one high-pass direction before those with two and three. Subband 
+   ib spans [box[6*ib], box[6*ib+1]) x [box[6*ib+2], box[6*ib+3]) x [box[6*ib+4], box[6*ib+5]), box must have room 
+   for 6*(1+7*WAV_LVL_MAX) entries. Returns the number of subbands */
+int subband_boxes( int lvl1in, int lvl2in, int lvl3in, int N1in, int N2in, int N3in, int *box )
+{
+  // Orientations, bit d set if high-pass in direction d
+  const int orient[7] = {1, 2, 4, 3, 5, 6, 1|2|4};
+
+  // Total number of levels
+  int lvl[3] = {lvl1in, lvl2in, lvl3in};
+  int lvlin = lvl1in;
+  if (lvl2in > lvlin) lvlin = lvl2in;
+  if (lvl3in > lvlin) lvlin = lvl3in;
+
+  // Array extents at every level, as in the forward transform
+  int N[3][WAV_LVL_MAX+1];
+  int Nin[3] = {N1in, N2in, N3in};
+  for (int d = 0; d < 3; d++)
+    for (int k = 0; k <= lvlin; k++)
+      N[d][k] = (int)(lvl_extent((unsigned long int)(Nin[d]), k < lvl[d] ? k : lvl[d]));
+
+  // Low-pass block
+  int nb = 0;
+  for (int d = 0; d < 3; d++)
+    {
+      box[2*d] = 0;
+      box[2*d+1] = N[d][lvlin];
+    }
+  nb++;
+
+  // Detail subbands, a direction that is not transformed at a level spans its full extent
+  for (int k = lvlin; k >= 1; k--)
+    for (int o = 0; o < 7; o++)
+      {
+        int valid = 1;
+        int *b = box + 6*nb;
+        for (int d = 0; d < 3; d++)
+          {
+            int tr = (k <= lvl[d]) && (N[d][k-1] > 1);
+            if (orient[o] & (1 << d))
+              {
+                valid &= tr;
+                b[2*d] = N[d][k];
+                b[2*d+1] = N[d][k-1];
+              }
+            else
+              {
+                b[2*d] = 0;
+                b[2*d+1] = tr ? N[d][k] : N[d][k-1];
+              }
+          }
+        if (valid) nb++;
+      }
+
+  return nb;
+}
+
 template void waveletcdf97_3d<float>(int N1in, int N2in, int N3in, int lvlin, float *X);
-template void waveletcdf97_3d<double>(int N1in, int N2in, int N3in, int lvlin, double *X);
\ No newline at end of file
+template void waveletcdf97_3d<float>(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, float *X);
+template void waveletcdf97_3d<double>(int N1in, int N2in, int N3in, int lvlin, double *X);
+template void waveletcdf97_3d<double>(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, double *X);
+template void waveletcdf97_3d_slices<float>(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, int dir, int nslc, const int *islc, float *X);
+template void waveletcdf97_3d_slices<double>(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, int dir, int nslc, const int *islc, double *X);
+template void waveletcdf97_3d_stream<float>(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, void *ctx_in, void (*read_plane)(void *ctx, unsigned long int i3, float *plane), void *ctx_out, void (*write_rows)(void *ctx, int k, unsigned long int i, const float *low, const float *high));
+template void waveletcdf97_3d_stream<double>(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, void *ctx_in, void (*read_plane)(void *ctx, unsigned long int i3, double *plane), void *ctx_out, void (*write_rows)(void *ctx, int k, unsigned long int i, const double *low, const double *high));
+template void waveletcdf97_3d_stream_inv<float>(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, void *ctx_in, void (*read_rows)(void *ctx, int k, unsigned long int i, float *low, float *high), void *ctx_out, void (*write_plane)(void *ctx, unsigned long int i3, const float *plane));
+template void waveletcdf97_3d_stream_inv<double>(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, void *ctx_in, void (*read_rows)(void *ctx, int k, unsigned long int i, double *low, double *high), void *ctx_out, void (*write_plane)(void *ctx, unsigned long int i3, const double *plane));
+template void waveletcdf97_3d_levels<float>(int N1in, int N2in, int N3in, const float *X, int *lvl);
+template void waveletcdf97_3d_levels<double>(int N1in, int N2in, int N3in, const double *X, int *lvl);
@@ -39,5 +39,43 @@
 template <typename T>
 void waveletcdf97_3d(int N1in, int N2in, int N3in, int lvlin, T *X);
 
+/* Three-dimensional wavelet transform using CDF9/7 wavelets with a separate depth in each direction; 
+   forward transform if all depths are non-negative, inverse transform if they are non-positive */
+template <typename T>
+void waveletcdf97_3d(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, T *X);
+
+/* Inverse three-dimensional wavelet transform using CDF9/7 wavelets that only reconstructs the planes normal to one 
+   direction at the given indexes, following the dependency cone of the lifting steps through the levels */
+template <typename T>
+void waveletcdf97_3d_slices(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, int dir, int nslc, const int *islc, T *X);
+
+/* Levels of the transform of a field streamed along the third direction, their plane extents and transformed 
+   directions */
+int waveletcdf97_3d_stream_levels(int lvl1in, int lvl2in, int lvl3in, int N1in, int N2in, int N3in, unsigned long int *ext);
+
+/* Forward three-dimensional wavelet transform using CDF9/7 wavelets of a field read one plane normal to the third 
+   direction at a time, lifted along the third direction over a sliding window of rows; the rows of coefficients of 
+   every level are passed on as soon as they are finished */
+template <typename T>
+void waveletcdf97_3d_stream(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, void *ctx_in, void (*read_plane)(void *ctx, unsigned long int i3, T *plane), void *ctx_out, void (*write_rows)(void *ctx, int k, unsigned long int i, const T *low, const T *high));
+
+/* Inverse of waveletcdf97_3d_stream, reconstructs the field one plane normal to the third direction at a time from 
+   the rows of coefficients of every level */
+template <typename T>
+void waveletcdf97_3d_stream_inv(int N1in, int N2in, int N3in, int lvl1in, int lvl2in, int lvl3in, void *ctx_in, void (*read_rows)(void *ctx, int k, unsigned long int i, T *low, T *high), void *ctx_out, void (*write_plane)(void *ctx, unsigned long int i3, const T *plane));
+
+/* Choose the transform depth in each direction from the array extents and an energy compaction probe */
+template <typename T>
+void waveletcdf97_3d_levels(int N1in, int N2in, int N3in, const T *X, int *lvl);
+
 /* Convert 3D index from physical space to wavelet space */
 void ind_p2w_3d(int lvlin, int N1in, int N2in, int N3in, int i1in, int i2in, int i3in, int *lvl, int *i1, int *i2, int *i3);
+
+/* Convert 3D index from physical space to wavelet space with a separate transform depth in each direction */
+void ind_p2w_3d(int lvl1in, int lvl2in, int lvl3in, int N1in, int N2in, int N3in, int i1in, int i2in, int i3in, int *lvl, int *i1, int *i2, int *i3);
+
+/* Separable tables for the conversion of 3D indexes from physical space to wavelet space, for one direction */
+int ind_p2w_tab(int lvlin, int nlvl, int Nin, int *lext, int *iw);
+
+/* Boxes occupied by the subbands in wavelet space, coarsest first */
+int subband_boxes(int lvl1in, int lvl2in, int lvl3in, int N1in, int N2in, int N3in, int *box);
@@ -0,0 +1,129 @@
+/*
+    brick_tol.cpp : This file is part of WaveRange CFD data compression utility
+
+    Copyright (C) 2017  Dmitry Kolomenskiy
+    Copyright (C) 2017  Ryo Onishi
+    Copyright (C) 2017  JAMSTEC
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Check that every region decoded from a bricked field meets the absolute tolerance returned by the bricked 
+    encoding subroutine, for all wavelet transform types, several tolerances and brick sizes, and that brick sizes 
+    below BRICK_SIZE_MIN are rejected
+*/
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <iostream>
+#include <exception>
+
+#include "../src/core/defs.h"
+#include "../src/core/wrappers.h"
+
+using namespace std;
+
+/* Test field of one of four kinds: smooth, smooth with noise, noise, discontinuous */
+static void test_field(int nx, int ny, int nz, int kind, double *fld)
+{
+    srand(7);
+    for (int jz = 0; jz < nz; jz++)
+      for (int jy = 0; jy < ny; jy++)
+        for (int jx = 0; jx < nx; jx++)
+          {
+            double s = sin(0.2*jx)*cos(0.13*jy)+0.3*sin(0.05*jz*jx);
+            double r = 2.0*rand()/double(RAND_MAX)-1.0;
+            double v = s;
+            if (kind == 1) v = s+0.01*r;
+            if (kind == 2) v = r;
+            if (kind == 3) v = ((jx > nx/2) ? 1.0 : -0.5)+0.1*s;
+            fld[jx+nx*(jy+ny*jz)] = v;
+          }
+}
+
+/* Largest error of a region decoded from the bricked data */
+static double region_error(int nx, int ny, int nz, const double *fld, int *rvec, unsigned long int ntot_enc, unsigned char *data_enc)
+{
+    int nr[3] = {rvec[1]-rvec[0]+1, rvec[3]-rvec[2]+1, rvec[5]-rvec[4]+1};
+    double *fld_r = new double[(unsigned long int)(nr[0])*nr[1]*nr[2]];
+    decoding_region(nx, ny, nz, rvec, fld_r, ntot_enc, data_enc);
+    double err = 0;
+    for (int kz = 0; kz < nr[2]; kz++)
+      for (int ky = 0; ky < nr[1]; ky++)
+        for (int kx = 0; kx < nr[0]; kx++)
+          err = fmax(err, fabs(fld_r[kx+nr[0]*(ky+nr[1]*kz)] - fld[(rvec[0]+kx)+nx*((rvec[2]+ky)+ny*(rvec[4]+kz))]));
+    delete [] fld_r;
+    return err;
+}
+
+int main()
+{
+    // Field size, not a multiple of most brick sizes
+    const int nx = 64, ny = 48, nz = 40;
+    unsigned long int ntot = (unsigned long int)(nx)*ny*nz;
+    double *fld = new double[ntot];
+
+    // Brick sizes, tolerances and regions: the whole field, one inside a brick and one across brick boundaries
+    const int nbs = 5;
+    const int bs[nbs] = {16, 20, 24, 32, 0};
+    const int ntol = 3;
+    const double tol[ntol] = {1e-2, 1e-4, 1e-6};
+    int rvec[3][6] = {{0, nx-1, 0, ny-1, 0, nz-1}, {3, 9, 2, 12, 1, 5}, {10, 57, 7, 40, 13, 37}};
+
+    int ncase = 0, nfail = 0;
+    double worst = 0;
+    for (int kind = 0; kind < 4; kind++)
+      {
+        test_field(nx, ny, nz, kind, fld);
+        for (int wt = WAV_TYPE_NONE; wt <= WAV_TYPE_CDF53; wt++)
+          for (int it = 0; it < ntol; it++)
+            for (int ib = 0; ib < nbs; ib++)
+              {
+                int bvec[3] = {bs[ib], bs[ib], bs[ib]};
+                unsigned long int ntot_enc_max, ntot_enc;
+                setup_wr_brick(nx, ny, nz, bvec, ntot_enc_max);
+                unsigned char *data_enc = new unsigned char[ntot_enc_max];
+                double tolabs;
+                encoding_wrap_brick(nx, ny, nz, fld, wt, bvec, tol[it], tolabs, ntot_enc, data_enc, ENC_BACKEND);
+                for (int ir = 0; ir < 3; ir++)
+                  {
+                    double err = region_error(nx, ny, nz, fld, rvec[ir], ntot_enc, data_enc);
+                    worst = fmax(worst, err/tolabs);
+                    ncase++;
+                    if (!(err <= tolabs))
+                      {
+                        nfail++;
+                        cout << "FAIL field " << kind << " wtflag " << wt << " tolrel " << tol[it] << " brick " << bs[ib] 
+                             << " region " << ir << ": error " << err << " > tolabs " << tolabs << endl;
+                      }
+                  }
+                delete [] data_enc;
+              }
+      }
+
+    // Too small bricks
+    int bsmall[3] = {BRICK_SIZE_MIN-1, 32, 32};
+    unsigned long int ntot_enc_max;
+    int rejected = 0;
+    try { setup_wr_brick(nx, ny, nz, bsmall, ntot_enc_max); } catch (std::exception &e) { rejected = 1; }
+    if (!rejected)
+      {
+        nfail++;
+        cout << "FAIL brick size " << BRICK_SIZE_MIN-1 << " is not rejected" << endl;
+      }
+
+    cout << "brick_tol: " << ncase-nfail << " of " << ncase << " regions within tolabs, largest error/tolabs " << worst << endl;
+    delete [] fld;
+    return (nfail > 0);
+}
@@ -0,0 +1,220 @@
+/*
+    prec_w.cpp : This file is part of WaveRange CFD data compression utility
+
+    Copyright (C) 2017  Dmitry Kolomenskiy
+    Copyright (C) 2017  Ryo Onishi
+    Copyright (C) 2017  JAMSTEC
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Check that the local precision map built from the separable index tables is identical, element by element, to 
+    the one built by converting the index of every element with ind_p2w_3d, as done before the tables were introduced
+*/
+
+// The subroutine under test is internal to the library
+#include "../src/core/wrappers.cpp"
+
+/* Reference conversion of a 3D index from physical space to wavelet space, a copy of ind_p2w_3d as it was when the 
+   local precision map was built element by element */
+static void ind_p2w_3d_ref( int lvl1in, int lvl2in, int lvl3in, int N1in, int N2in, int N3in, int i1in, int i2in, int i3in, int *lvl, int *i1, int *i2, int *i3 )
+{
+  // Indexes
+  int k, M1, M2, M3;
+
+  // Total number of levels
+  int lvlin = lvl1in;
+  if (lvl2in > lvlin) lvlin = lvl2in;
+  if (lvl3in > lvlin) lvlin = lvl3in;
+
+  // Initialize data size and level to input values
+  int N1 = N1in;
+  int N2 = N2in;
+  int N3 = N3in;
+  *lvl = 0;
+  *i1 = i1in;
+  *i2 = i2in;
+  *i3 = i3in;
+
+  int chlvl = 0;
+
+  if ((lvl1in >= 0) && (lvl2in >= 0) && (lvl3in >= 0))   
+    // Forward transform
+    {
+      for (k = 1; k <= lvlin; k++)
+        {
+          // Low-pass filtered vector length
+          M1 = (N1/2) + ( (N1%2) > 0 ? 1 : 0 );
+          M2 = (N2/2) + ( (N2%2) > 0 ? 1 : 0 );
+          M3 = (N3/2) + ( (N3%2) > 0 ? 1 : 0 );
+
+          // Transform along the FIRST direction
+          // At least two elements are required
+          if ((k <= lvl1in) && (N1 > 1))
+            {         
+              // If the actual point index is inside the low-pass quadrant
+              if ( (*i3 < N3) && (*i2 < N2) && (*i1 < N1) )
+                  {
+                    // Update the index
+                    if (*i1%2) *i1 = *i1/2+M1; else *i1 /= 2;
+
+                    // Update level flag
+                    chlvl = 1;
+                  }
+            }
+
+          // Transform along the SECOND direction
+          // At least two elements are required
+          if ((k <= lvl2in) && (N2 > 1))
+            {         
+              // If the actual point index is inside the low-pass quadrant
+              if ( (*i3 < N3) && (*i2 < N2) && (*i1 < N1) )
+                  {
+                    // Update the index
+                    if (*i2%2) *i2 = *i2/2+M2; else *i2 /= 2;
+
+                    // Update level flag
+                    chlvl = 1;
+                  }
+            }
+
+          // Transform along the THIRD direction
+          // At least two elements are required
+          if ((k <= lvl3in) && (N3 > 1))
+            {         
+              // If the actual point index is inside the low-pass quadrant
+              if ( (*i3 < N3) && (*i2 < N2) && (*i1 < N1) )
+                  {
+                    // Update the index
+                    if (*i3%2) *i3 = *i3/2+M3; else *i3 /= 2;
+
+                    // Update level flag
+                    chlvl = 1;
+                  }
+            }
+
+          // Assign the subset array extents for the next iteration
+          if (k <= lvl1in) N1 = M1;
+          if (k <= lvl2in) N2 = M2;
+          if (k <= lvl3in) N3 = M3;
+
+          // Update the actual level
+          if (chlvl) *lvl += 1;
+        }
+    }
+}
+
+/* Reference local precision, as computed before the tables were introduced */
+template <typename T>
+static T lcl_prec_ref(int nx, int ny, int nz, int jx, int jy, int jz, int mx, int my, int mz, const T *cutoffvec)
+{
+    // Cartesian coordinates of the local precision cutoff block
+    int kx = int(T(jx)/T(nx)*T(mx));
+    int ky = int(T(jy)/T(ny)*T(my));
+    int kz = int(T(jz)/T(nz)*T(mz));
+
+    // Evaluate the local precision
+    return cutoffvec[kx+mx*ky+mx*my*kz];
+}
+
+/* Compare the local precision maps for one field size, transform depths and cutoff block grid, return the number 
+   of differing elements */
+template <typename T>
+static unsigned long int check_prec_w(int nx, int ny, int nz, const int *lvlvec, int mx, int my, int mz)
+{
+    unsigned long int ntot = (unsigned long int)(nx)*(unsigned long int)(ny)*(unsigned long int)(nz);
+    int wlev = lvlvec[0];
+    if (lvlvec[1] > wlev) wlev = lvlvec[1];
+    if (lvlvec[2] > wlev) wlev = lvlvec[2];
+
+    // Local cutoffs of 1, 2, 3... times the smallest one
+    int mtot = mx*my*mz;
+    T *cutoffvec = new T[mtot];
+    for (int k = 0; k < mtot; k++) cutoffvec[k] = T(1e-3)*T(1+k%3);
+    T tolrel = cutoffvec[0];
+    T tolabs = T(0.37)*tolrel;
+
+    // Map under test
+    T *prec_w = new T[ntot];
+    local_precision(nx,ny,nz,lvlvec,wlev,mx,my,mz,cutoffvec,tolrel,tolabs,prec_w);
+
+    // Reference map, every element is written exactly once
+    T *prec_r = new T[ntot];
+    unsigned char *seen = new unsigned char[ntot];
+    memset(seen,0,ntot);
+    unsigned long int nerr = 0;
+    for (unsigned long int jp = 0; jp < ntot; jp++)
+      {
+        int l, jwx, jwy, jwz;
+        ind_p2w_3d_ref(lvlvec[0], lvlvec[1], lvlvec[2], nx, ny, nz, jp%nx, (jp/nx)%ny, jp/nx/ny, &l, &jwx, &jwy, &jwz);
+
+        // The library conversion has not changed either
+        int l1, jwx1, jwy1, jwz1;
+        ind_p2w_3d(lvlvec[0], lvlvec[1], lvlvec[2], nx, ny, nz, jp%nx, (jp/nx)%ny, jp/nx/ny, &l1, &jwx1, &jwy1, &jwz1);
+        if ((l1 != l) || (jwx1 != jwx) || (jwy1 != jwy) || (jwz1 != jwz)) nerr++;
+
+        T precmask = tolabs;
+        if (l <= LOC_CUTOFF_LVL) 
+          precmask = tolabs/tolrel * lcl_prec_ref(nx, ny, nz, jp%nx, (jp/nx)%ny, jp/nx/ny, mx, my, mz, cutoffvec);
+
+        unsigned long int jw = (unsigned long int)(jwx) + 
+                               (unsigned long int)(nx)*(unsigned long int)(jwy) +
+                               (unsigned long int)(nx)*(unsigned long int)(ny)*(unsigned long int)(jwz);
+        if (seen[jw]) nerr++;
+        seen[jw] = 1;
+        prec_r[jw] = precmask;
+      }
+    for (unsigned long int jw = 0; jw < ntot; jw++) if (!seen[jw] || (prec_w[jw] != prec_r[jw])) nerr++;
+
+    delete [] cutoffvec;
+    delete [] prec_w;
+    delete [] prec_r;
+    delete [] seen;
+    return nerr;
+}
+
+int main()
+{
+    // Field extents, including odd ones and single-element directions
+    const int nlen = 7;
+    const int len[nlen] = {1, 2, 3, 7, 16, 33, 40};
+
+    // Transform depths
+    const int nlvl = 6;
+    const int lvl[nlvl][3] = {{0,0,0}, {1,1,1}, {4,4,4}, {2,0,3}, {1,4,1}, {3,2,1}};
+
+    // Cutoff block grids
+    const int ngrid = 3;
+    const int grid[ngrid][3] = {{2,1,1}, {4,4,4}, {3,2,5}};
+
+    int ncase = 0, nfail = 0;
+    for (int ix = 0; ix < nlen; ix++)
+      for (int iy = 0; iy < nlen; iy++)
+        for (int iz = 0; iz < nlen; iz++)
+          for (int il = 0; il < nlvl; il++)
+            for (int ig = 0; ig < ngrid; ig++)
+              {
+                unsigned long int nerr = check_prec_w<double>(len[ix],len[iy],len[iz],lvl[il],grid[ig][0],grid[ig][1],grid[ig][2])
+                                       + check_prec_w<float>(len[ix],len[iy],len[iz],lvl[il],grid[ig][0],grid[ig][1],grid[ig][2]);
+                ncase++;
+                if (nerr)
+                  {
+                    nfail++;
+                    cout << "FAIL " << len[ix] << "x" << len[iy] << "x" << len[iz] << " lvl " << lvl[il][0] << "," << lvl[il][1] << "," 
+                         << lvl[il][2] << " grid " << grid[ig][0] << "x" << grid[ig][1] << "x" << grid[ig][2] << ": " << nerr << " elements differ" << endl;
+                  }
+              }
+
+    cout << "prec_w: " << ncase-nfail << " of " << ncase << " cases identical" << endl;
+    return (nfail > 0);
+}
@@ -0,0 +1,173 @@
+/*
+    stream_tol.cpp : This file is part of WaveRange CFD data compression utility
+
+    Copyright (C) 2017  Dmitry Kolomenskiy
+    Copyright (C) 2017  Ryo Onishi
+    Copyright (C) 2017  JAMSTEC
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Check that a field encoded in streaming mode is read once, plane by plane, and reconstructed within the relative
+    tolerance, with and without the wavelet transform, for several tolerances and memory budgets, and that the
+    CDF 5/3 transform is rejected
+*/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <exception>
+
+#include "../src/core/defs.h"
+#include "../src/core/wrappers.h"
+
+using namespace std;
+
+/* Test field of one of four kinds: smooth, smooth with noise, noise, discontinuous */
+static void test_field(int nx, int ny, int nz, int kind, double *fld)
+{
+    srand(7);
+    for (int jz = 0; jz < nz; jz++)
+      for (int jy = 0; jy < ny; jy++)
+        for (int jx = 0; jx < nx; jx++)
+          {
+            double s = sin(0.2*jx)*cos(0.13*jy)+0.3*sin(0.05*jz*jx);
+            double r = 2.0*rand()/double(RAND_MAX)-1.0;
+            double v = s;
+            if (kind == 1) v = s+0.01*r;
+            if (kind == 2) v = r;
+            if (kind == 3) v = ((jx > nx/2) ? 1.0 : -0.5)+0.1*s;
+            fld[jx+nx*(jy+ny*jz)] = v;
+          }
+}
+
+/* Field in memory, read in order, and the encoded stream in a memory buffer */
+struct source
+{
+    const double *fld;
+    unsigned long int pos;
+    int unordered;
+};
+struct buffer
+{
+    unsigned char *data;
+    unsigned long int len, pos, size;
+};
+
+static void read_fld(void *ctx, unsigned long int ioff, unsigned long int nelem, double *fld)
+{
+    source *s = (source*)ctx;
+    if (ioff != s->pos) s->unordered = 1;
+    memcpy(fld, s->fld+ioff, nelem*sizeof(double));
+    s->pos = ioff+nelem;
+}
+
+static void write_fld(void *ctx, unsigned long int ioff, unsigned long int nelem, const double *fld)
+{
+    memcpy((double*)(ctx)+ioff, fld, nelem*sizeof(double));
+}
+
+static void write_enc(void *ctx, const unsigned char *buf, unsigned long int len)
+{
+    buffer *b = (buffer*)ctx;
+    if (b->len+len > b->size)
+      {
+        unsigned long int size = 2UL*(b->len+len);
+        unsigned char *data = new unsigned char[size];
+        memcpy(data, b->data, b->len);
+        delete [] b->data;
+        b->data = data;
+        b->size = size;
+      }
+    memcpy(b->data+b->len, buf, len);
+    b->len += len;
+}
+
+static void read_enc(void *ctx, unsigned char *buf, unsigned long int len)
+{
+    buffer *b = (buffer*)ctx;
+    if (b->pos+len > b->len) throw std::exception();
+    memcpy(buf, b->data+b->pos, len);
+    b->pos += len;
+}
+
+int main()
+{
+    // Field size, odd along the streamed direction
+    const int nx = 64, ny = 48, nz = 41;
+    unsigned long int ntot = (unsigned long int)(nx)*ny*nz;
+    double *fld = new double[ntot];
+    double *fld_r = new double[ntot];
+
+    // Memory budgets: one plane per block, several planes per block, the whole field in one block
+    const int nmb = 3;
+    const unsigned long int mb[nmb] = {1UL, 1UL<<20, 1UL<<30};
+    const int ntol = 3;
+    const double tol[ntol] = {1e-2, 1e-4, 1e-6};
+
+    int ncase = 0, nfail = 0;
+    double worst = 0;
+    for (int kind = 0; kind < 4; kind++)
+      {
+        test_field(nx, ny, nz, kind, fld);
+        double maxabs = 0;
+        for (unsigned long int j = 0; j < ntot; j++) maxabs = fmax(maxabs, fabs(fld[j]));
+        for (int wt = WAV_TYPE_NONE; wt <= WAV_TYPE_CDF97; wt++)
+          for (int it = 0; it < ntol; it++)
+            for (int im = 0; im < nmb; im++)
+              {
+                source src = {fld, 0, 0};
+                buffer enc = {NULL, 0, 0, 0};
+                unsigned long int ntot_enc;
+                encoding_wrap_stream(nx, ny, nz, wt, tol[it], mb[im], &src, read_fld, &enc, write_enc, ntot_enc, ENC_BACKEND);
+                decoding_wrap_stream(nx, ny, nz, &enc, read_enc, fld_r, write_fld);
+                double err = 0;
+                for (unsigned long int j = 0; j < ntot; j++) err = fmax(err, fabs(fld_r[j]-fld[j]));
+                double tolabs = tol[it]*maxabs;
+                worst = fmax(worst, err/tolabs);
+                ncase++;
+                if (!(err <= tolabs) || src.unordered || (src.pos != ntot) || (ntot_enc != enc.len) || (enc.pos != enc.len))
+                  {
+                    nfail++;
+                    cout << "FAIL field " << kind << " wtflag " << wt << " tolrel " << tol[it] << " budget " << mb[im]
+                         << ": error " << err << " tolabs " << tolabs << ", " << src.pos << " of " << ntot << " elements read"
+                         << (src.unordered ? " out of order" : "") << ", " << enc.pos << " of " << enc.len << " bytes decoded" << endl;
+                  }
+                delete [] enc.data;
+              }
+      }
+
+    // The reversible transform is not streamed
+    int rejected = 0;
+    try
+      {
+        source src = {fld, 0, 0};
+        buffer enc = {NULL, 0, 0, 0};
+        unsigned long int ntot_enc;
+        encoding_wrap_stream(nx, ny, nz, WAV_TYPE_CDF53, tol[0], mb[0], &src, read_fld, &enc, write_enc, ntot_enc, ENC_BACKEND);
+        delete [] enc.data;
+      }
+    catch (std::exception &e) { rejected = 1; }
+    if (!rejected)
+      {
+        nfail++;
+        cout << "FAIL the CDF 5/3 transform is not rejected" << endl;
+      }
+
+    cout << "stream_tol: " << ncase-nfail << " of " << ncase << " streams within the tolerance, largest error/tolabs " << worst << endl;
+    delete [] fld;
+    delete [] fld_r;
+    return (nfail > 0);
+}